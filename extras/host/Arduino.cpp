@@ -0,0 +1,6 @@
+#include "Arduino.h"
+#include "Wire.h"
+
+unsigned long hostMicros = 0;
+Print Serial;
+TwoWire Wire;
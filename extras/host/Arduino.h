@@ -0,0 +1,61 @@
+// Arduino.h
+// Minimal stand-in for the Arduino core so that the library can be built and run on a desktop
+// (see README.md). Only what the library uses is provided.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <cstdlib>
+#include <stdio.h>
+
+#define PI          3.1415926535897932384626433832795
+#define HALF_PI     1.5707963267948966192313216916398
+#define TWO_PI      6.283185307179586476925286766559
+#define DEG_TO_RAD  0.017453292519943295769236907684886
+#define RAD_TO_DEG  57.295779513082320876798154814105
+
+#define PROGMEM
+#define pgm_read_byte(address)  (*(const uint8_t *)(address))
+#define pgm_read_word(address)  (*(const uint16_t *)(address))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+using std::abs;
+
+template <class T> T min(T a, T b) { return (a < b) ? a : b; }
+template <class T> T max(T a, T b) { return (a > b) ? a : b; }
+template <class T> T constrain(T value, T low, T high) { return (value < low) ? low : ((value > high) ? high : value); }
+
+// Print writes to the standard output; Serial is the only instance.
+class Print {
+  public:
+    void print(const char *text) { fputs(text, stdout); }
+    void print(long value) { printf("%ld", value); }
+    void print(unsigned long value) { printf("%lu", value); }
+    void print(int value) { print((long)value); }
+    void print(unsigned int value) { print((unsigned long)value); }
+    template <class T> void println(T value) { print(value); fputs("\n", stdout); }
+    size_t write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+    int availableForWrite() { return 64; }
+};
+
+extern Print Serial;
+
+// The clock is virtual: it only moves when the host program moves it, so that runs are repeatable
+// and can go much faster than real time.
+extern unsigned long hostMicros;
+
+inline unsigned long micros() { return hostMicros; }
+inline unsigned long millis() { return hostMicros / 1000; }
+
+inline void delayMicroseconds(unsigned int time) { hostMicros += time; }
+
+inline void hostSetMillis(unsigned long time) { hostMicros = time * 1000; }
+inline void hostAdvanceMillis(unsigned long time) { hostMicros += time * 1000; }
+
+#endif
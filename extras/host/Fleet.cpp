@@ -0,0 +1,701 @@
+// Fleet.cpp
+// Batch versions of the step height and kinematics solve, written once over a set of lane operations (8 floats
+// with AVX2, 4 with NEON, 1 without either), and a fleet of robots ticked on a pool of threads. See Fleet.h.
+
+#include "Fleet.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <float.h>
+#include <math.h>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "FixedPointMath.h"
+#include "Kinematics.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define FLEET_NEON
+#endif
+
+// Robots per task on the thread pool; 16 robots is 64 legs, a whole number of vectors either way
+#define FLEET_CHUNK_ROBOTS  16
+
+
+// ******** lanes ********
+// Every set of lanes has the same operations, so the kernels below are written once. Loads widen the SoA
+// integers to floats and stores narrow them back (with saturation), so the math is all done in float.
+
+struct FleetScalar {
+  typedef float F;
+  typedef bool M;
+  static const size_t lanes = 1;
+
+  static F set(float value) { return value; }
+  static F loadInt16(const int16_t *p) { return *p; }
+  static F loadUint16(const uint16_t *p) { return *p; }
+  static F loadUint8(const uint8_t *p) { return *p; }
+  static F loadFloat(const float *p) { return *p; }
+  static void storeInt16(int16_t *p, F value) { *p = (int16_t)constrain(value, (float)INT16_MIN, (float)INT16_MAX); }
+
+  static F add(F a, F b) { return a + b; }
+  static F sub(F a, F b) { return a - b; }
+  static F mul(F a, F b) { return a * b; }
+  static F div(F a, F b) { return a / b; }
+  static F min(F a, F b) { return (a < b) ? a : b; }
+  static F max(F a, F b) { return (a > b) ? a : b; }
+  static F sqrt(F a) { return sqrtf(a); }
+  static F abs(F a) { return fabsf(a); }
+  static F round(F a) { return rintf(a); }      // to nearest even, like lrintf()
+  static F truncate(F a) { return truncf(a); }  // like a conversion to an integer
+
+  static M less(F a, F b) { return a < b; }
+  static M greater(F a, F b) { return a > b; }
+  static M equal(F a, F b) { return a == b; }
+  static M either(M a, M b) { return a || b; }
+  static M both(M a, M b) { return a && b; }
+  static F select(M mask, F a, F b) { return mask ? a : b; }
+};
+
+#if defined(__AVX2__)
+
+struct FleetAvx2 {
+  typedef __m256 F;
+  typedef __m256 M;
+  static const size_t lanes = 8;
+
+  static F set(float value) { return _mm256_set1_ps(value); }
+  static F loadInt16(const int16_t *p) { return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)p))); }
+  static F loadUint16(const uint16_t *p) { return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p))); }
+  static F loadUint8(const uint8_t *p) { return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p))); }
+  static F loadFloat(const float *p) { return _mm256_loadu_ps(p); }
+  static void storeInt16(int16_t *p, F value) {
+    __m256i whole = _mm256_cvtps_epi32(value);
+    _mm_storeu_si128((__m128i *)p, _mm_packs_epi32(_mm256_castsi256_si128(whole), _mm256_extracti128_si256(whole, 1)));
+  }
+
+  static F add(F a, F b) { return _mm256_add_ps(a, b); }
+  static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+  static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+  static F div(F a, F b) { return _mm256_div_ps(a, b); }
+  static F min(F a, F b) { return _mm256_min_ps(a, b); }
+  static F max(F a, F b) { return _mm256_max_ps(a, b); }
+  static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+  static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+  static F round(F a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  static F truncate(F a) { return _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+
+  static M less(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static M greater(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static M equal(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static M either(M a, M b) { return _mm256_or_ps(a, b); }
+  static M both(M a, M b) { return _mm256_and_ps(a, b); }
+  static F select(M mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+};
+
+#elif defined(FLEET_NEON)
+
+struct FleetNeon {
+  typedef float32x4_t F;
+  typedef uint32x4_t M;
+  static const size_t lanes = 4;
+
+  static F set(float value) { return vdupq_n_f32(value); }
+  static F loadInt16(const int16_t *p) { return vcvtq_f32_s32(vmovl_s16(vld1_s16(p))); }
+  static F loadUint16(const uint16_t *p) { return vcvtq_f32_u32(vmovl_u16(vld1_u16(p))); }
+  static F loadUint8(const uint8_t *p) {
+    uint8_t bytes[8] = { p[0], p[1], p[2], p[3], 0, 0, 0, 0 };
+    return vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vld1_u8(bytes)))));
+  }
+  static F loadFloat(const float *p) { return vld1q_f32(p); }
+  static void storeInt16(int16_t *p, F value) { vst1_s16(p, vqmovn_s32(vcvtnq_s32_f32(value))); }
+
+  static F add(F a, F b) { return vaddq_f32(a, b); }
+  static F sub(F a, F b) { return vsubq_f32(a, b); }
+  static F mul(F a, F b) { return vmulq_f32(a, b); }
+  static F div(F a, F b) { return vdivq_f32(a, b); }
+  static F min(F a, F b) { return vminq_f32(a, b); }
+  static F max(F a, F b) { return vmaxq_f32(a, b); }
+  static F sqrt(F a) { return vsqrtq_f32(a); }
+  static F abs(F a) { return vabsq_f32(a); }
+  static F round(F a) { return vrndnq_f32(a); }
+  static F truncate(F a) { return vrndq_f32(a); }
+
+  static M less(F a, F b) { return vcltq_f32(a, b); }
+  static M greater(F a, F b) { return vcgtq_f32(a, b); }
+  static M equal(F a, F b) { return vceqq_f32(a, b); }
+  static M either(M a, M b) { return vorrq_u32(a, b); }
+  static M both(M a, M b) { return vandq_u32(a, b); }
+  static F select(M mask, F a, F b) { return vbslq_f32(mask, a, b); }
+};
+
+#endif
+
+
+// ******** math ********
+// There are no vector atan2f(), acosf() or cosf(), so the kernels use these instead, on every set of lanes
+// (including the scalar tail, so a leg solves the same whichever lanes it lands in)
+
+/*!
+ *    @brief  atan2() of y and x that are both >= 0 (and not both 0): the Cephes atanf() polynomial after
+ *            bringing the ratio down to tan(pi/8) or less. Good to about 1e-7 radians.
+ */
+template <class V>
+static inline typename V::F fleetAtan2(typename V::F y, typename V::F x) {
+  typedef typename V::F F;
+
+  F ratio = V::div(V::min(x, y), V::max(V::max(x, y), V::set(FLT_MIN)));   // 0 to 1
+
+  // atan(t) = pi/4 + atan((t - 1) / (t + 1))
+  typename V::M isReduced = V::greater(ratio, V::set(0.414213562f));
+  F u = V::select(isReduced, V::div(V::sub(ratio, V::set(1)), V::add(ratio, V::set(1))), ratio);
+  F uSquared = V::mul(u, u);
+
+  F polynomial = V::sub(V::mul(V::set(8.05374449538e-2f), uSquared), V::set(1.38776856032e-1f));
+  polynomial = V::add(V::mul(polynomial, uSquared), V::set(1.99777106478e-1f));
+  polynomial = V::sub(V::mul(polynomial, uSquared), V::set(3.33329491539e-1f));
+  F angle = V::add(V::mul(V::mul(polynomial, uSquared), u), u);
+  angle = V::add(angle, V::select(isReduced, V::set(PI_F / 4), V::set(0)));
+
+  return V::select(V::greater(y, x), V::sub(V::set(PI_F / 2), angle), angle);
+}
+
+/*!
+ *    @brief  acos() from the half angle: acos(c) = 2 * atan2(sqrt(1 - c), sqrt(1 + c)). c is limited to -1 to 1.
+ */
+template <class V>
+static inline typename V::F fleetAcos(typename V::F cosine) {
+  cosine = V::min(V::max(cosine, V::set(-1)), V::set(1));
+  typename V::F angle = fleetAtan2<V>(V::sqrt(V::sub(V::set(1), cosine)), V::sqrt(V::add(V::set(1), cosine)));
+  return V::add(angle, angle);
+}
+
+/*!
+ *    @brief  cos() of -3pi/2 to 3pi/2 (the step height curves stay within -pi/2 to pi/2): the Taylor series up to
+ *            x^12 after folding the angle into 0 to pi/2, which is good to under 1e-8.
+ */
+template <class V>
+static inline typename V::F fleetCos(typename V::F angle) {
+  typedef typename V::F F;
+
+  angle = V::abs(angle);
+  typename V::M isFolded = V::greater(angle, V::set(PI_F / 2));
+  angle = V::select(isFolded, V::sub(V::set(PI_F), angle), angle);   // cos(pi - a) = -cos(a)
+
+  F squared = V::mul(angle, angle);
+  F series = V::set(1.0f / 479001600);                                    // 1/12!
+  series = V::sub(V::set(1.0f / 3628800), V::mul(series, squared));       // 1/10!
+  series = V::sub(V::set(1.0f / 40320), V::mul(series, squared));         // 1/8!
+  series = V::sub(V::set(1.0f / 720), V::mul(series, squared));           // 1/6!
+  series = V::sub(V::set(1.0f / 24), V::mul(series, squared));            // 1/4!
+  series = V::sub(V::set(1.0f / 2), V::mul(series, squared));             // 1/2!
+  series = V::sub(V::set(1), V::mul(series, squared));
+
+  return V::select(isFolded, V::sub(V::set(0), series), series);
+}
+
+
+// ******** kernels ********
+
+/*!
+ *    @brief  Kinematics::solveFootPosition() for V::lanes legs from entry: solveYMove(), solveXMove() and
+ *            solveFtShldrLength() in the same order, with the branches turned into selects
+ */
+template <class V>
+static inline void fleetSolveLanes(const FleetFeet *feet, FleetAngles *angles, size_t entry) {
+  typedef typename V::F F;
+  typedef DefaultGeometry Geometry;
+
+  const F limb1 = V::set(Geometry::limb1);
+  const F limb1Squared = V::set((float)Geometry::limb1 * Geometry::limb1);
+  const F radToDeg = V::set(RAD_TO_DEG_F);
+
+  F inputX = V::loadInt16(feet->x + entry);
+  F inputY = V::add(V::loadInt16(feet->y + entry), limb1);   // 0 on the motor 1 axis, like setFootEndpoint()
+  F inputZ = V::loadInt16(feet->z + entry);
+
+  // ******** y-z plane (solveYMove) ********
+  F absY = V::abs(inputY);
+  F absZ = V::abs(inputZ);
+  F ftShldrSquared = V::max(V::add(V::mul(absZ, absZ), V::mul(absY, absY)), limb1Squared);
+  F ftShldrLength = V::sqrt(ftShldrSquared);
+  F yPlaneZ = V::sqrt(V::sub(ftShldrSquared, limb1Squared));
+
+  F theta = V::mul(fleetAtan2<V>(absY, absZ), radToDeg);
+  F alpha = V::mul(fleetAcos<V>(V::div(limb1, ftShldrLength)), radToDeg);
+  F angle1 = V::abs(V::select(V::less(inputY, V::set(0)), V::sub(V::set(90), V::sub(alpha, theta)),
+                                                           V::sub(V::set(90), V::add(theta, alpha))));
+  angle1 = V::select(V::less(inputY, limb1), V::sub(V::set(0), angle1), angle1);
+
+  // ******** x-z plane (solveXMove), which is given the y-z plane's z in whole mm ********
+  F planeZ = V::truncate(yPlaneZ);
+  planeZ = V::select(V::equal(planeZ, V::set(0)), V::set(1), planeZ);
+  F absX = V::abs(inputX);
+  F ftShldrLengthX = V::sqrt(V::add(V::mul(planeZ, planeZ), V::mul(absX, absX)));
+
+  F angle2 = V::mul(fleetAtan2<V>(absX, planeZ), radToDeg);
+  angle2 = V::select(V::greater(inputX, V::set(0)), V::sub(V::set(0), angle2), angle2);
+
+  // ******** foot-shoulder length (solveFtShldrLength) ********
+  F length = V::min(V::max(ftShldrLengthX, V::set(Geometry::shoulderFootMin)), V::set(Geometry::shoulderFootMax));
+  F cosine3 = V::div(V::sub(V::set(Geometry::kneeSidesSquared), V::mul(length, length)), V::set(Geometry::kneeSidesProduct));
+  F angle3 = V::mul(fleetAcos<V>(cosine3), radToDeg);
+  angle2 = V::add(angle2, V::div(V::sub(V::set(180), angle3), V::set(2)));
+
+  V::storeInt16(angles->angle1 + entry, V::round(angle1));
+  V::storeInt16(angles->angle2 + entry, V::round(angle2));
+  V::storeInt16(angles->angle3 + entry, V::round(angle3));
+}
+
+/*!
+ *    @brief  StepPlanner::_calculateStepHeight() for V::lanes legs from entry. Each leg is on one of the curves
+ *            (the swing, the first step's swing or the stance), so the angle and the amplitude are picked for it
+ *            and there is one cos() per leg.
+ */
+template <class V>
+static inline void fleetStepHeightLanes(const FleetSteps *steps, int16_t *heights, size_t entry) {
+  typedef typename V::F F;
+  typedef typename V::M M;
+
+  F legTick = V::loadUint16(steps->legTick + entry);
+  F legMode = V::loadUint8(steps->legMode + entry);
+  F robotHeight = V::loadInt16(steps->robotHeight + entry);
+  F amplitude = V::loadFloat(steps->amplitude + entry);
+  F drawBackAmplitude = V::loadFloat(steps->drawBackAmplitude + entry);
+  F swingTicks = V::loadUint16(steps->swingTicks + entry);
+  F stanceTicks = V::loadUint16(steps->stanceTicks + entry);
+
+  M isSwing = V::less(legTick, swingTicks);
+  M isStance = V::greater(legTick, V::sub(swingTicks, V::set(1)));   // the ticks are whole numbers
+  M isFirstStep = V::equal(legMode, V::set(FIRST_STEP));
+  M isFlat = V::either(V::equal(legMode, V::set(STANDING)), V::both(isFirstStep, isStance));   // the first step's stance is flat
+
+  // Both curves are centered on the origin of the swing or stance
+  F halfSwing = V::truncate(V::mul(swingTicks, V::set(0.5f)));
+  F swingPosition = V::sub(legTick, halfSwing);
+  F stancePosition = V::sub(V::add(swingTicks, V::truncate(V::mul(stanceTicks, V::set(0.5f)))), legTick);
+
+  F firstStepPosition = V::sub(swingPosition, V::mul(halfSwing, V::set(0.5f)));
+  F position = V::select(isSwing, V::select(isFirstStep, firstStepPosition, swingPosition), stancePosition);
+  F ticks = V::select(isSwing, V::select(isFirstStep, halfSwing, swingTicks), stanceTicks);
+
+  // The swing lifts the foot (z is down from the shoulder), the stance presses it down
+  F swingAmplitude = V::select(isFirstStep, V::mul(amplitude, V::set(0.5f)), amplitude);
+  F curveAmplitude = V::select(isSwing, V::sub(V::set(0), swingAmplitude), drawBackAmplitude);
+
+  F curve = V::round(V::mul(curveAmplitude, fleetCos<V>(V::div(V::mul(V::set(PI_F), position), ticks))));
+  V::storeInt16(heights + entry, V::select(isFlat, robotHeight, V::add(robotHeight, curve)));
+}
+
+/*!
+ *    @brief  Runs one of the kernels over the entries that fill whole vectors, from begin
+ *    @return The entry after the last one done
+ */
+template <class V>
+static size_t fleetSolveVectors(const FleetFeet *feet, FleetAngles *angles, size_t begin, size_t end) {
+  for (; begin + V::lanes <= end; begin += V::lanes)
+    fleetSolveLanes<V>(feet, angles, begin);
+  return begin;
+}
+
+template <class V>
+static size_t fleetStepHeightVectors(const FleetSteps *steps, int16_t *heights, size_t begin, size_t end) {
+  for (; begin + V::lanes <= end; begin += V::lanes)
+    fleetStepHeightLanes<V>(steps, heights, begin);
+  return begin;
+}
+
+#if defined(__AVX2__)
+typedef FleetAvx2 FleetLanes;
+#elif defined(FLEET_NEON)
+typedef FleetNeon FleetLanes;
+#else
+typedef FleetScalar FleetLanes;
+#endif
+
+void fleetSolveFootPositions(const FleetFeet *feet, FleetAngles *angles, size_t begin, size_t end) {
+  begin = fleetSolveVectors<FleetLanes>(feet, angles, begin, end);
+  fleetSolveVectors<FleetScalar>(feet, angles, begin, end);
+}
+
+void fleetStepHeights(const FleetSteps *steps, int16_t *heights, size_t begin, size_t end) {
+  begin = fleetStepHeightVectors<FleetLanes>(steps, heights, begin, end);
+  fleetStepHeightVectors<FleetScalar>(steps, heights, begin, end);
+}
+
+const char * fleetKernelName() {
+#if defined(__AVX2__)
+  return "AVX2";
+#elif defined(FLEET_NEON)
+  return "NEON";
+#else
+  return "scalar";
+#endif
+}
+
+
+// ******** thread pool ********
+
+// Runs the chunks of a task on a set of threads that are started once; the thread that calls run() works on
+// them too. A chunk is claimed by taking the next index, so faster threads just do more of them.
+class FleetThreadPool {
+
+  public:
+    typedef void (*Task)(void *context, size_t chunk);
+
+    FleetThreadPool(unsigned threads) {
+      _task = NULL;
+      _context = NULL;
+      _chunks = 0;
+      _nextChunk = 0;
+      _busyWorkers = 0;
+      _generation = 0;
+      _isStopping = false;
+      for (unsigned thread = 1; thread < threads; thread++)
+        _workers.push_back(std::thread(&FleetThreadPool::_work, this));
+    }
+
+    ~FleetThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isStopping = true;
+      }
+      _started.notify_all();
+      for (size_t worker = 0; worker < _workers.size(); worker++)
+        _workers[worker].join();
+    }
+
+    unsigned threadCount() {
+      return _workers.size() + 1;
+    }
+
+    // runs task(context, chunk) for every chunk from 0 to chunks - 1 and returns once they are all done
+    void run(Task task, void *context, size_t chunks) {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = task;
+        _context = context;
+        _chunks = chunks;
+        _nextChunk = 0;
+        _busyWorkers = _workers.size();
+        _generation++;
+      }
+      _started.notify_all();
+
+      _runChunks();
+
+      std::unique_lock<std::mutex> lock(_mutex);
+      _finished.wait(lock, [this] { return _busyWorkers == 0; });
+    }
+
+  private:
+    void _runChunks() {
+      for (size_t chunk = _nextChunk++; chunk < _chunks; chunk = _nextChunk++)
+        _task(_context, chunk);
+    }
+
+    void _work() {
+      uint64_t generation = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _started.wait(lock, [this, generation] { return _isStopping || (_generation != generation); });
+          if (_isStopping)
+            return;
+          generation = _generation;
+        }
+
+        _runChunks();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_busyWorkers == 0)
+          _finished.notify_one();
+      }
+    }
+
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _started;
+    std::condition_variable _finished;
+
+    Task _task;
+    void *_context;
+    size_t _chunks;
+    std::atomic<size_t> _nextChunk;
+    size_t _busyWorkers;      // workers that haven't finished the current task
+    uint64_t _generation;     // counts the tasks, so a worker knows there is a new one
+    bool _isStopping;
+};
+
+
+// ******** fleet ********
+
+Fleet::Fleet() {
+  _robots = NULL;
+  _robotCount = 0;
+  _pool = NULL;
+  memset(&_feet, 0, sizeof(_feet));
+  memset(&_angles, 0, sizeof(_angles));
+  memset(&_steps, 0, sizeof(_steps));
+}
+
+Fleet::~Fleet() {
+  _free();
+}
+
+void Fleet::_free() {
+  delete _pool;
+  delete[] _robots;
+  delete[] _feet.x;
+  delete[] _feet.y;
+  delete[] _feet.z;
+  delete[] _angles.angle1;
+  delete[] _angles.angle2;
+  delete[] _angles.angle3;
+  delete[] _steps.legTick;
+  delete[] _steps.legMode;
+  delete[] _steps.robotHeight;
+  delete[] _steps.amplitude;
+  delete[] _steps.drawBackAmplitude;
+  delete[] _steps.swingTicks;
+  delete[] _steps.stanceTicks;
+
+  _robots = NULL;
+  _robotCount = 0;
+  _pool = NULL;
+  memset(&_feet, 0, sizeof(_feet));
+  memset(&_angles, 0, sizeof(_angles));
+  memset(&_steps, 0, sizeof(_steps));
+}
+
+/*!
+ *    @brief  Sets up the robots, all standing, and the threads that tick them. This allocates everything the
+ *            fleet needs; tick() doesn't allocate.
+ *    @param  robotCount How many robots
+ *    @param  inputX The offset of the walk in x for every robot (see Quadruped::init())
+ *    @param  inputY The offset of the walk in y
+ *    @param  inputZ The height of the robots
+ *    @param  threads Threads to tick on, including the one that calls tick(); 0 for one per core
+ *    @return false if there are no robots
+ */
+bool Fleet::init(uint32_t robotCount, int16_t inputX, int16_t inputY, int16_t inputZ, unsigned threads) {
+  _free();
+  if (robotCount == 0)
+    return false;
+
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  size_t entries = (size_t)robotCount * ROBOT_LEG_COUNT;
+  _robotCount = robotCount;
+  _robots = new Robot[robotCount];
+  _feet.x = new int16_t[entries];
+  _feet.y = new int16_t[entries];
+  _feet.z = new int16_t[entries];
+  _angles.angle1 = new int16_t[entries];
+  _angles.angle2 = new int16_t[entries];
+  _angles.angle3 = new int16_t[entries];
+  _steps.legTick = new uint16_t[entries];
+  _steps.legMode = new uint8_t[entries];
+  _steps.robotHeight = new int16_t[entries];
+  _steps.amplitude = new float[entries];
+  _steps.drawBackAmplitude = new float[entries];
+  _steps.swingTicks = new uint16_t[entries];
+  _steps.stanceTicks = new uint16_t[entries];
+
+  for (uint32_t robot = 0; robot < robotCount; robot++) {
+    Robot *state = &_robots[robot];
+    StepPlanner::initGaitParameters(&state->gaitParameters, inputX, inputY, inputZ);
+    state->robotMode = STATIC_STANDING;
+    state->stepDirection.controlCoordinateX = 0;
+    state->stepDirection.controlCoordinateY = 0;
+    state->stepDirection.x = 0;
+    state->stepDirection.y = 0;
+    state->controlCoordinateX = 0;
+    state->controlCoordinateY = 0;
+    state->requestedGait = state->gaitParameters.gaitType;
+
+    // Standing where Quadruped::init() puts the feet
+    for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+      state->legs[leg].init((LegID)(leg + 1), &state->gaitParameters);
+
+      size_t entry = (size_t)robot * ROBOT_LEG_COUNT + leg;
+      _feet.x[entry] = inputX;
+      _feet.y[entry] = inputY;
+      _feet.z[entry] = inputZ;
+      _steps.legTick[entry] = 0;
+      _steps.legMode[entry] = STANDING;
+      _steps.robotHeight[entry] = inputZ;
+      _steps.amplitude[entry] = 0;
+      _steps.drawBackAmplitude[entry] = 0;
+      _steps.swingTicks[entry] = state->gaitParameters.timing.swingTicks;
+      _steps.stanceTicks[entry] = state->gaitParameters.timing.stanceTicks;
+    }
+  }
+  fleetSolveFootPositions(&_feet, &_angles, 0, entries);
+
+  _pool = new FleetThreadPool(threads);
+  return true;
+}
+
+uint32_t Fleet::robotCount() {
+  return _robotCount;
+}
+
+unsigned Fleet::threadCount() {
+  return (_pool != NULL) ? _pool->threadCount() : 0;
+}
+
+/*!
+ *    @brief  The same as Quadruped::walk()'s control coordinate; 0, 0 stops the robot (at each foot's origin)
+ */
+void Fleet::setControl(uint32_t robot, int16_t controlCoordinateX, int16_t controlCoordinateY) {
+  if (robot >= _robotCount)
+    return;
+  _robots[robot].controlCoordinateX = controlCoordinateX;
+  _robots[robot].controlCoordinateY = controlCoordinateY;
+}
+
+/*!
+ *    @brief  Changes a robot's gait; like Quadruped::setGait(), it waits until the robot is standing
+ */
+void Fleet::setGait(uint32_t robot, GaitType gaitType) {
+  if ((robot >= _robotCount) || (gaitType >= NUMBER_OF_GAITS))
+    return;
+  _robots[robot].requestedGait = gaitType;
+}
+
+/*!
+ *    @brief  Stages new parameters for one of a robot's gaits (see Quadruped::setGaitParameters())
+ *    @return false if the robot or the gait type doesn't exist
+ */
+bool Fleet::setGaitParameters(uint32_t robot, GaitType gaitType, const Gait *gait) {
+  if ((robot >= _robotCount) || (gaitType >= NUMBER_OF_GAITS))
+    return false;
+  StepPlanner::stageGait(&_robots[robot].gaitParameters, gaitType, gait);
+  return true;
+}
+
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+/*!
+ *    @brief  Sets the height of the ground under one of a robot's legs (see Quadruped::setGroundHeight())
+ */
+void Fleet::setGroundHeight(uint32_t robot, LegID leg, int16_t groundHeight) {
+  if ((robot >= _robotCount) || (leg < LEG_1) || (leg > LEG_4))
+    return;
+  _robots[robot].legs[leg - 1].setGroundHeight(groundHeight);
+}
+#endif
+
+/*!
+ *    @brief  Runs one control tick for every robot: the step planners one robot at a time, then the step heights
+ *            and the kinematics for all of the legs in a chunk at once. The chunks are split over the threads.
+ */
+void Fleet::tick() {
+  if (_pool == NULL)
+    return;
+  _pool->run(_tickChunk, this, (_robotCount + FLEET_CHUNK_ROBOTS - 1) / FLEET_CHUNK_ROBOTS);
+}
+
+void Fleet::_tickChunk(void *fleet, size_t chunk) {
+  Fleet *self = (Fleet *)fleet;
+  uint32_t first = chunk * FLEET_CHUNK_ROBOTS;
+  uint32_t last = std::min<uint32_t>(first + FLEET_CHUNK_ROBOTS, self->_robotCount);
+  self->_tickRobots(first, last);
+}
+
+void Fleet::_tickRobots(uint32_t first, uint32_t last) {
+  // Only the runs of robots that moved are solved; a robot that is standing still keeps its feet and angles
+  uint32_t runStart = first;
+  for (uint32_t robot = first; robot <= last; robot++) {
+    if ((robot < last) && _planRobot(robot))
+      continue;
+
+    if (robot > runStart) {
+      size_t begin = (size_t)runStart * ROBOT_LEG_COUNT;
+      size_t end = (size_t)robot * ROBOT_LEG_COUNT;
+      fleetStepHeights(&_steps, _feet.z, begin, end);
+      fleetSolveFootPositions(&_feet, &_angles, begin, end);
+    }
+    runStart = robot + 1;
+  }
+}
+
+/*!
+ *    @brief  Moves one robot's gait on by a tick, the way Quadruped's tick does (the same StepPlanner sequencing,
+ *            without the body pose), and fills in its legs' step height inputs; the heights and angles are left to
+ *            the kernels. A robot that is standing still doesn't move, so its entries stay as they are.
+ *    @return false if the robot is standing still, so its entries don't need solving
+ */
+bool Fleet::_planRobot(uint32_t robot) {
+  Robot *state = &_robots[robot];
+  GaitParameters *gaitParameters = &state->gaitParameters;
+
+  StepPlanner::applyGaitChanges(gaitParameters, state->legs, state->requestedGait, state->robotMode);
+  state->robotMode = StepPlanner::changeRobotMode(gaitParameters, state->legs, state->robotMode,
+                                                  state->controlCoordinateX, state->controlCoordinateY);
+
+  if (state->robotMode == STATIC_STANDING) {
+    StepPlanner::buildHeightTable(gaitParameters, GAIT_TABLE_BUILD_STEP);
+    return false;
+  }
+
+  // The legs' ticks are the ones they are updated for, before the body phase moves on
+  uint16_t bodyPhase = gaitParameters->bodyPhase;
+  StepPlanner::stepLegs(gaitParameters, state->legs, &state->stepDirection, state->controlCoordinateX,
+                        state->controlCoordinateY, &state->robotMode);
+
+  const GaitTiming *timing = &gaitParameters->timing;
+  const Gait *gait = &gaitParameters->gaits[gaitParameters->gaitType];
+
+  for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+    StepPlanner *planner = &state->legs[leg];
+
+    size_t entry = (size_t)robot * ROBOT_LEG_COUNT + leg;
+    uint16_t legTick = bodyPhase + timing->legOffsets[leg];
+    if (legTick >= timing->cycleTicks)
+      legTick -= timing->cycleTicks;
+
+    _feet.x[entry] = planner->dynamicFootPosition.x;
+    _feet.y[entry] = planner->dynamicFootPosition.y;
+    _steps.legTick[entry] = legTick;
+    _steps.legMode[entry] = planner->legMode();
+    _steps.robotHeight[entry] = planner->getStepHeight(0, STANDING);   // less the ground height with TERRAIN_ADAPTIVE_HEIGHT
+    _steps.amplitude[entry] = gait->amplitude;
+    _steps.drawBackAmplitude[entry] = gait->drawBackAmplitude;
+    _steps.swingTicks[entry] = timing->swingTicks;
+    _steps.stanceTicks[entry] = timing->stanceTicks;
+  }
+
+  // The planners' own heights are only a lookup once the table is built
+  StepPlanner::buildHeightTable(gaitParameters, GAIT_TABLE_BUILD_STEP);
+  return true;
+}
+
+const FleetFeet * Fleet::feet() {
+  return &_feet;
+}
+
+const FleetAngles * Fleet::angles() {
+  return &_angles;
+}
+
+ROBOT_MODE Fleet::robotMode(uint32_t robot) {
+  return (robot < _robotCount) ? _robots[robot].robotMode : STATIC_STANDING;
+}
+
+const GaitParameters * Fleet::gaitParameters(uint32_t robot) {
+  return (robot < _robotCount) ? &_robots[robot].gaitParameters : NULL;
+}
+
+const StepPlanner * Fleet::stepPlanner(uint32_t robot, LegID leg) {
+  if ((robot >= _robotCount) || (leg < LEG_1) || (leg > LEG_4))
+    return NULL;
+  return &_robots[robot].legs[leg - 1];
+}
@@ -0,0 +1,119 @@
+// Fleet.h
+// Batch gait planning and kinematics for many robots at once on a desktop or server, i.e. to simulate a fleet or
+// to check robots against a digital twin. Host only; see README.md for how to build it.
+
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "StepPlanner.h"
+#include "quadruped-config.h"
+
+// The batch functions work on SoA (structure of arrays) buffers with one entry per leg, indexed
+// robot * ROBOT_LEG_COUNT + (leg - 1). Any range of entries can be done at a time, so threads can split them.
+
+// Foot positions, in the coordinates of Kinematics::setFootEndpoint() (y = 0 under the shoulder)
+typedef struct {
+  int16_t *x;
+  int16_t *y;
+  int16_t *z;
+} FleetFeet;
+
+// Motor angles (degrees), as Kinematics::solveFootPosition() rounds them
+typedef struct {
+  int16_t *angle1;
+  int16_t *angle2;
+  int16_t *angle3;
+} FleetAngles;
+
+// What StepPlanner::getStepHeight() needs for each leg
+typedef struct {
+  uint16_t *legTick;            // where the leg is in the gait cycle (ticks)
+  uint8_t *legMode;             // LegMode
+  int16_t *robotHeight;         // the height the arcs are offset from (mm)
+  float *amplitude;             // of the leg's robot's gait
+  float *drawBackAmplitude;
+  uint16_t *swingTicks;         // of the leg's robot's gait timing
+  uint16_t *stanceTicks;
+} FleetSteps;
+
+// Kinematics::solveFootPosition() over the entries from begin up to end; the same float solve, so the angles only
+// differ where a result is within a rounding error of a half degree
+void fleetSolveFootPositions(const FleetFeet *feet, FleetAngles *angles, size_t begin, size_t end);
+
+// StepPlanner::getStepHeight() over the entries from begin up to end, calculated rather than looked up in the
+// height table; heights may be the same array as the feet's z
+void fleetStepHeights(const FleetSteps *steps, int16_t *heights, size_t begin, size_t end);
+
+// The instruction set the batch functions were built for: "AVX2", "NEON" or "scalar"
+const char * fleetKernelName();
+
+
+class FleetThreadPool;
+
+// A fleet of robots that are all run one control tick at a time. Each robot has the same gait state as a
+// Quadruped (its own GaitParameters and StepPlanners, so it walks exactly like one), but nothing is timed by
+// millis(): tick() runs one tick for every robot, spread over a pool of threads. The feet and angles of the
+// tick are left in SoA buffers.
+class Fleet {
+
+  public:
+    Fleet();
+    ~Fleet();
+
+    // every robot starts standing at inputX, inputY, inputZ (like Quadruped::init()); threads = 0 for one per core
+    bool init(uint32_t robotCount, int16_t inputX, int16_t inputY, int16_t inputZ, unsigned threads = 0);
+
+    uint32_t robotCount();
+    unsigned threadCount();
+
+    // Commands for a robot, taken at its next tick; call these between ticks
+    void setControl(uint32_t robot, int16_t controlCoordinateX, int16_t controlCoordinateY);
+    void setGait(uint32_t robot, GaitType gaitType);                            // waits till the robot stands
+    bool setGaitParameters(uint32_t robot, GaitType gaitType, const Gait *gait); // see Quadruped::setGaitParameters()
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+    void setGroundHeight(uint32_t robot, LegID leg, int16_t groundHeight);     // see Quadruped::setGroundHeight()
+#endif
+
+    // runs one control tick for every robot
+    void tick();
+
+    // The tick's results
+    const FleetFeet * feet();
+    const FleetAngles * angles();
+    ROBOT_MODE robotMode(uint32_t robot);
+
+    // a robot's gait state, i.e. to check it against a Quadruped
+    const GaitParameters * gaitParameters(uint32_t robot);
+    const StepPlanner * stepPlanner(uint32_t robot, LegID leg);
+
+  private:
+    typedef struct {
+      GaitParameters gaitParameters;
+      StepPlanner legs[ROBOT_LEG_COUNT];
+      ROBOT_MODE robotMode;
+      StepDirection stepDirection;
+      int16_t controlCoordinateX;
+      int16_t controlCoordinateY;
+      GaitType requestedGait;
+    } Robot;
+
+    void _free();
+    void _tickRobots(uint32_t first, uint32_t last);
+    bool _planRobot(uint32_t robot);
+    static void _tickChunk(void *fleet, size_t chunk);
+
+    Robot *_robots;
+    uint32_t _robotCount;
+
+    // SoA buffers, one entry per leg
+    FleetFeet _feet;
+    FleetAngles _angles;
+    FleetSteps _steps;
+
+    FleetThreadPool *_pool;
+};
+
+#endif
@@ -0,0 +1,76 @@
+// Ramp.h
+// Minimal stand-in for the Ramp interpolation library (linear ramps only) for desktop builds.
+
+#ifndef HOST_RAMP_H
+#define HOST_RAMP_H
+
+#include "Arduino.h"
+
+enum ramp_mode { NONE, LINEAR };
+enum loop_mode { ONCEFORWARD, LOOPFORWARD, FORTHANDBACK };
+
+template <class T> class _ramp {
+
+  public:
+    _ramp() : _origin(0), _target(0), _value(0), _start(0), _duration(0), _loop(ONCEFORWARD), _running(false) {};
+
+    T go(T value, unsigned long duration = 0, ramp_mode mode = LINEAR, loop_mode loop = ONCEFORWARD) {
+      (void)mode;
+      _origin = _value;
+      _target = value;
+      _start = millis();
+      _duration = duration;
+      _loop = loop;
+      _running = (duration > 0);
+      if (!_running)
+        _value = value;
+      return _value;
+    }
+
+    T update() {
+      if (!_running)
+        return _value;
+
+      unsigned long elapsed = millis() - _start;
+      float progress;
+
+      if (_loop == ONCEFORWARD) {
+        if (elapsed >= _duration) {
+          _value = _target;
+          _running = false;
+          return _value;
+        }
+        progress = (float)elapsed / _duration;
+      }
+      else if (_loop == LOOPFORWARD)
+        progress = (float)(elapsed % _duration) / _duration;
+      else {
+        unsigned long position = elapsed % (2 * _duration);
+        progress = (position < _duration) ? (float)position / _duration : 2.0f - (float)position / _duration;
+      }
+
+      _value = _origin + (T)((_target - _origin) * progress);
+      return _value;
+    }
+
+    bool isFinished() { return !_running; }
+    bool isRunning() { return _running; }
+    T getValue() { return _value; }
+    T getTarget() { return _target; }
+    T getOrigin() { return _origin; }
+
+  private:
+    T _origin;
+    T _target;
+    T _value;
+    unsigned long _start;
+    unsigned long _duration;
+    loop_mode _loop;
+    bool _running;
+
+};
+
+typedef _ramp<int> rampInt;
+typedef _ramp<float> rampFloat;
+
+#endif
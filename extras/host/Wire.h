@@ -0,0 +1,25 @@
+// Wire.h
+// Minimal stand-in for the Arduino I2C library for desktop builds. Nothing is sent anywhere; it counts the
+// transmissions and bytes so that the bus time of the servo output can be measured.
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire {
+  public:
+    TwoWire() : transmissionCount(0), byteCount(0) {};
+
+    void begin() {};
+    void beginTransmission(uint8_t address) { (void)address; transmissionCount++; byteCount++; }
+    size_t write(uint8_t data) { (void)data; byteCount++; return 1; }
+    uint8_t endTransmission() { return 0; }
+
+    unsigned long transmissionCount;
+    unsigned long byteCount;          // including the address byte of each transmission
+};
+
+extern TwoWire Wire;
+
+#endif
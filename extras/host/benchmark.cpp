@@ -0,0 +1,902 @@
+// benchmark.cpp
+// Desktop micro-benchmarks for the kinematics and gait hot paths. See README.md for how to build it.
+
+#include <chrono>
+#include <new>
+#include <stdio.h>
+
+#include "Quadruped.h"
+#include "KinematicsImpl.h"
+#include "PCA9685Driver.h"
+
+// ******** allocation counting ********
+
+static unsigned long allocations = 0;
+
+void * operator new(size_t size) {
+  allocations++;
+  void * memory = malloc(size);
+  if (memory == NULL)
+    throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void * memory) noexcept { free(memory); }
+void operator delete(void * memory, size_t) noexcept { free(memory); }
+
+
+// ******** timing ********
+
+typedef std::chrono::steady_clock Clock;
+
+static double nanosecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// Keeps results alive so that the compiler can't remove the work being measured
+static volatile int32_t sink;
+
+
+// ******** workspace regions ********
+
+// The workspace swept by the kinematics benchmarks (Kinematics::setFootEndpoint coordinates, mm)
+#define SWEEP_X_MIN   -40
+#define SWEEP_X_MAX   40
+#define SWEEP_Y_MIN   -40
+#define SWEEP_Y_MAX   40
+#define SWEEP_Z_MIN   SHOULDER_FOOT_MIN
+#define SWEEP_Z_MAX   SHOULDER_FOOT_MAX
+#define SWEEP_STEP    2
+
+// Regions: 3 bands of z, each split by whether the foot is inwards of the shoulder (y < 0, where
+// solveYMove() flips the sign of motor 1) or outwards
+#define Z_BANDS       3
+#define REGION_COUNT  (Z_BANDS * 2)
+
+// A smaller robot, built next to the one in quadruped-config.h to show that geometries can be mixed
+typedef RobotGeometry<30, 90, 90, 60, 170> SmallGeometry;
+
+// Latency histogram buckets (upper bounds in ns); the last bucket is everything above
+#define BUCKET_COUNT  7
+static const double BUCKET_LIMITS[BUCKET_COUNT - 1] = {50, 100, 200, 400, 800, 1600};
+
+typedef struct {
+  unsigned long count;
+  double total;
+  double minimum;
+  double maximum;
+  unsigned long buckets[BUCKET_COUNT];
+} Histogram;
+
+static uint8_t regionOf(int16_t inputY, int16_t inputZ) {
+  uint8_t band = ((inputZ - SWEEP_Z_MIN) * Z_BANDS) / (SWEEP_Z_MAX - SWEEP_Z_MIN + 1);
+  return band * 2 + ((inputY < 0) ? 0 : 1);
+}
+
+static void printRegionName(uint8_t region) {
+  int16_t bandHeight = (SWEEP_Z_MAX - SWEEP_Z_MIN + 1) / Z_BANDS;
+  int16_t bandMin = SWEEP_Z_MIN + (region / 2) * bandHeight;
+  int16_t bandMax = ((region / 2) == Z_BANDS - 1) ? SWEEP_Z_MAX : (bandMin + bandHeight - 1);
+  printf("  z %3d-%3d %-8s", bandMin, bandMax, (region % 2 == 0) ? "inwards" : "outwards");
+}
+
+static void addSample(Histogram *histogram, double nanoseconds) {
+  if (histogram->count == 0 || nanoseconds < histogram->minimum)
+    histogram->minimum = nanoseconds;
+  if (histogram->count == 0 || nanoseconds > histogram->maximum)
+    histogram->maximum = nanoseconds;
+  histogram->count++;
+  histogram->total += nanoseconds;
+
+  uint8_t bucket = 0;
+  while ((bucket < BUCKET_COUNT - 1) && (nanoseconds >= BUCKET_LIMITS[bucket]))
+    bucket++;
+  histogram->buckets[bucket]++;
+}
+
+
+// The angle walk() last sent out for a motor; with GAIT_LOOKAHEAD the motors are planned ahead of that
+static int16_t sentAngle(Quadruped *robot, const Motor motors[], uint8_t motor) {
+#if defined(GAIT_LOOKAHEAD)
+  (void)motors;
+  return robot->outputAngles()[motor];
+#else
+  (void)robot;
+  return motors[motor].angleDegrees;
+#endif
+}
+
+
+// ******** benchmarks ********
+
+/*!
+ *    @brief  Times Kinematics::solveFootPosition over the whole sweep, then times every point on its
+ *            own to build a latency histogram for each workspace region.
+ */
+static void benchmarkSolveFootPosition() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Kinematics kinematics;
+  kinematics.init(LEG_1, 0, 0, (SWEEP_Z_MIN + SWEEP_Z_MAX) / 2, motors);
+
+  const int repeats = 20;
+  unsigned long solves = 0;
+  unsigned long startAllocations = allocations;
+
+  Clock::time_point start = Clock::now();
+  for (int repeat = 0; repeat < repeats; repeat++)
+    for (int16_t inputX = SWEEP_X_MIN; inputX <= SWEEP_X_MAX; inputX += SWEEP_STEP)
+      for (int16_t inputY = SWEEP_Y_MIN; inputY <= SWEEP_Y_MAX; inputY += SWEEP_STEP)
+        for (int16_t inputZ = SWEEP_Z_MIN; inputZ <= SWEEP_Z_MAX; inputZ += SWEEP_STEP) {
+          int16_t angle1, angle2, angle3;
+          kinematics.solveFootPosition(inputX, inputY + LIMB_1, inputZ, &angle1, &angle2, &angle3);
+          sink += angle1 + angle2 + angle3;
+          solves++;
+        }
+  double elapsed = nanosecondsSince(start);
+
+  printf("Kinematics::solveFootPosition\n");
+  printf("  %.1f ns/solve over %lu solves, %lu allocations\n", elapsed / solves, solves, allocations - startAllocations);
+
+  // Per point timing includes reading the clock, so measure that and take it off
+  Clock::time_point overheadStart = Clock::now();
+  for (int sample = 0; sample < 100000; sample++) {
+    Clock::time_point sampleStart = Clock::now();
+    sink += (int32_t)nanosecondsSince(sampleStart);
+  }
+  double clockOverhead = nanosecondsSince(overheadStart) / 100000 / 2;
+
+  Histogram histograms[REGION_COUNT] = {};
+
+  for (int16_t inputX = SWEEP_X_MIN; inputX <= SWEEP_X_MAX; inputX += SWEEP_STEP)
+    for (int16_t inputY = SWEEP_Y_MIN; inputY <= SWEEP_Y_MAX; inputY += SWEEP_STEP)
+      for (int16_t inputZ = SWEEP_Z_MIN; inputZ <= SWEEP_Z_MAX; inputZ += SWEEP_STEP) {
+        int16_t angle1, angle2, angle3;
+        Clock::time_point sampleStart = Clock::now();
+        kinematics.solveFootPosition(inputX, inputY + LIMB_1, inputZ, &angle1, &angle2, &angle3);
+        double nanoseconds = nanosecondsSince(sampleStart) - clockOverhead;
+        sink += angle1 + angle2 + angle3;
+
+        addSample(&histograms[regionOf(inputY, inputZ)], (nanoseconds > 0) ? nanoseconds : 0);
+      }
+
+  printf("  latency by region (ns, clock overhead of %.1f ns removed):\n", clockOverhead);
+  printf("  %-19s %7s %7s %7s |", "region", "min", "mean", "max");
+  for (uint8_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+    char label[16];
+    if (bucket < BUCKET_COUNT - 1)
+      snprintf(label, sizeof(label), "<%.0f", BUCKET_LIMITS[bucket]);
+    else
+      snprintf(label, sizeof(label), ">=%.0f", BUCKET_LIMITS[bucket - 1]);
+    printf(" %6s", label);
+  }
+  printf("\n");
+
+  for (uint8_t region = 0; region < REGION_COUNT; region++) {
+    Histogram *histogram = &histograms[region];
+    printRegionName(region);
+    printf(" %7.1f %7.1f %7.1f |", histogram->minimum, histogram->total / histogram->count, histogram->maximum);
+    for (uint8_t bucket = 0; bucket < BUCKET_COUNT; bucket++)
+      printf(" %5.1f%%", (100.0 * histogram->buckets[bucket]) / histogram->count);
+    printf("\n");
+  }
+}
+
+/*!
+ *    @brief  Times Kinematics::checkReachability against the solve over a box much bigger than the workspace,
+ *            and checks that every position it moves an unreachable target to passes the test and that the
+ *            unreachable targets still solve to numbers.
+ */
+static void benchmarkCheckReachability() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Kinematics kinematics;
+  kinematics.init(LEG_1, 0, 0, (SWEEP_Z_MIN + SWEEP_Z_MAX) / 2, motors);
+
+  const int16_t limit = SHOULDER_FOOT_MAX + 20;
+  const int16_t step = 5;
+  unsigned long checks = 0;
+  unsigned long unreachable[FOOT_TOO_FAR + 1] = {};
+
+  Clock::time_point start = Clock::now();
+  for (int16_t inputX = -limit; inputX <= limit; inputX += step)
+    for (int16_t inputY = -limit; inputY <= limit; inputY += step)
+      for (int16_t inputZ = -limit; inputZ <= limit; inputZ += step) {
+        Reachability reachability = Kinematics::checkReachability(inputX, inputY, inputZ);
+        sink += reachability;
+        unreachable[reachability]++;
+        checks++;
+      }
+  double checkTime = nanosecondsSince(start) / checks;
+
+  unsigned long projections = 0;
+  unsigned long projectedUnreachable = 0;
+  unsigned long notANumber = 0;
+  float furthestMove = 0;
+  double projectTime = 0;
+  double solveTime = 0;
+
+  for (int16_t inputX = -limit; inputX <= limit; inputX += step)
+    for (int16_t inputY = -limit; inputY <= limit; inputY += step)
+      for (int16_t inputZ = -limit; inputZ <= limit; inputZ += step) {
+        if (Kinematics::checkReachability(inputX, inputY, inputZ) == FOOT_REACHABLE)
+          continue;
+
+        int16_t nearestX, nearestY, nearestZ;
+        Clock::time_point projectStart = Clock::now();
+        Kinematics::checkReachability(inputX, inputY, inputZ, &nearestX, &nearestY, &nearestZ);
+        projectTime += nanosecondsSince(projectStart);
+        projections++;
+
+        if (Kinematics::checkReachability(nearestX, nearestY, nearestZ) != FOOT_REACHABLE)
+          projectedUnreachable++;
+        float moveX = nearestX - inputX, moveY = nearestY - inputY, moveZ = nearestZ - inputZ;
+        float move = sqrt((moveX * moveX) + (moveY * moveY) + (moveZ * moveZ));
+        if (move > furthestMove)
+          furthestMove = move;
+
+        float angle1, angle2, angle3;
+        Clock::time_point solveStart = Clock::now();
+        kinematics.solveFootAngles(inputX, inputY + LIMB_1, inputZ, &angle1, &angle2, &angle3);
+        solveTime += nanosecondsSince(solveStart);
+        if (std::isnan(angle1) || std::isnan(angle2) || std::isnan(angle3))
+          notANumber++;
+      }
+
+  printf("Kinematics::checkReachability\n");
+  printf("  %.1f ns/check over %lu positions: %lu reachable, %lu inside LIMB_1, %lu too close, %lu too far\n",
+         checkTime, checks, unreachable[FOOT_REACHABLE], unreachable[FOOT_INSIDE_LIMB_1], unreachable[FOOT_TOO_CLOSE], unreachable[FOOT_TOO_FAR]);
+  printf("  unreachable: %.1f ns to find a reachable position (%lu not reachable, moved up to %.1f mm), %.1f ns to solve (%lu NaN angles)\n",
+         projectTime / projections, projectedUnreachable, furthestMove, solveTime / projections, notANumber);
+}
+
+/*!
+ *    @brief  Times Kinematics::updateDynamicFootPosition called every millisecond while the foot is stepped
+ *            around a loop, one millimetre or so every control tick like a walking foot, and finds how far the
+ *            dynamic angles fall behind.
+ */
+static void benchmarkUpdateDynamicFootPosition() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Kinematics kinematics;
+  hostSetMillis(0);
+  kinematics.init(LEG_1, 0, 0, 160, motors);
+
+  const unsigned long updates = 1000000;
+  const int16_t pathLength = 200;
+  static int16_t path[pathLength][3];
+  for (int16_t point = 0; point < pathLength; point++) {
+    float angle = (TWO_PI * point) / pathLength;
+    path[point][0] = lrint(30 * cos(angle));
+    path[point][1] = lrint(20 * sin(angle));
+    path[point][2] = lrint(160 + 20 * sin(2 * angle));
+  }
+
+  // The endpoints alone, so that their cost can be taken off
+  double elapsed[2];
+  int16_t maxLag = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    hostSetMillis(0);
+    Clock::time_point start = Clock::now();
+    for (unsigned long update = 0; update < updates; update++) {
+      if (update % (TIME_TO_UPDATE - 1) == 0) {
+        const int16_t *point = path[(update / (TIME_TO_UPDATE - 1)) % pathLength];
+        kinematics.setFootEndpoint(point[0], point[1], point[2]);
+      }
+      hostAdvanceMillis(1);
+      if (pass == 1) {
+        kinematics.updateDynamicFootPosition();
+        sink += motors[0].dynamicDegrees;
+      }
+    }
+    elapsed[pass] = nanosecondsSince(start);
+  }
+
+  // Lag over one more lap, now that the motors have caught up with the path
+  for (unsigned long update = 0; update < pathLength * (TIME_TO_UPDATE - 1); update++) {
+    if (update % (TIME_TO_UPDATE - 1) == 0) {
+      const int16_t *point = path[(update / (TIME_TO_UPDATE - 1)) % pathLength];
+      kinematics.setFootEndpoint(point[0], point[1], point[2]);
+    }
+    hostAdvanceMillis(1);
+    kinematics.updateDynamicFootPosition();
+    for (uint8_t motor = 0; motor < MOTORS_PER_LEG; motor++)
+      maxLag = max(maxLag, (int16_t)abs(motors[motor].dynamicDegrees - motors[motor].angleDegrees));
+  }
+
+#if defined(CARTESIAN_DYNAMIC_INTERPOLATION)
+  printf("Kinematics::updateDynamicFootPosition (cartesian)\n");
+#else
+  printf("Kinematics::updateDynamicFootPosition (joint space)\n");
+#endif
+  printf("  %.1f ns/update, dynamic angles up to %d degrees behind\n", (elapsed[1] - elapsed[0]) / updates, maxLag);
+}
+
+#if defined(DIFFERENTIAL_KINEMATICS)
+/*!
+ *    @brief  Times Kinematics::trackFootPosition against solveFootPosition on the same foot path; a
+ *            loop that moves about a millimetre per update like a walking foot does.
+ */
+static void benchmarkTrackFootPosition() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Kinematics kinematics;
+  kinematics.init(LEG_1, 0, 0, (SWEEP_Z_MIN + SWEEP_Z_MAX) / 2, motors);
+
+  const unsigned long solves = 1000000;
+  const int16_t pathLength = 200;
+  static int16_t path[pathLength][3];
+  for (int16_t point = 0; point < pathLength; point++) {
+    float angle = (TWO_PI * point) / pathLength;
+    path[point][0] = lrint(30 * cos(angle));
+    path[point][1] = lrint(20 * sin(angle)) + LIMB_1;
+    path[point][2] = lrint(160 + 20 * sin(2 * angle));
+  }
+
+  unsigned long differing = 0;
+  double elapsed[2];
+  for (int solve = 0; solve < 2; solve++) {
+    Clock::time_point start = Clock::now();
+    for (unsigned long update = 0; update < solves; update++) {
+      const int16_t *point = path[update % pathLength];
+      int16_t angle1, angle2, angle3;
+      if (solve == 0)
+        kinematics.trackFootPosition(point[0], point[1], point[2], &angle1, &angle2, &angle3);
+      else
+        kinematics.solveFootPosition(point[0], point[1], point[2], &angle1, &angle2, &angle3);
+      sink += angle1 + angle2 + angle3;
+    }
+    elapsed[solve] = nanosecondsSince(start);
+  }
+
+  for (int16_t point = 0; point < pathLength; point++) {
+    int16_t tracked[3], solved[3];
+    kinematics.trackFootPosition(path[point][0], path[point][1], path[point][2], &tracked[0], &tracked[1], &tracked[2]);
+    kinematics.solveFootPosition(path[point][0], path[point][1], path[point][2], &solved[0], &solved[1], &solved[2]);
+    for (uint8_t motor = 0; motor < 3; motor++)
+      differing += (abs(tracked[motor] - solved[motor]) > 1);
+  }
+
+  printf("Kinematics::trackFootPosition\n");
+  printf("  %.1f ns/solve (solveFootPosition on the same path: %.1f ns), %lu angles more than 1 degree off\n",
+    elapsed[0] / solves, elapsed[1] / solves, differing);
+}
+#endif
+
+/*!
+ *    @brief  Times solveFootPosition for a geometry over the sweep, with z covering that geometry's
+ *            foot-shoulder lengths. Every geometry gets its own copy of the solve with its limbs folded in.
+ *    @return ns per solve
+ */
+template <class Geometry>
+static double timeGeometry() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  BasicKinematics<Geometry> kinematics;
+  kinematics.init(LEG_1, 0, 0, (Geometry::shoulderFootMin + Geometry::shoulderFootMax) / 2, motors);
+
+  const int repeats = 20;
+  unsigned long solves = 0;
+
+  Clock::time_point start = Clock::now();
+  for (int repeat = 0; repeat < repeats; repeat++)
+    for (int16_t inputX = SWEEP_X_MIN; inputX <= SWEEP_X_MAX; inputX += SWEEP_STEP)
+      for (int16_t inputY = SWEEP_Y_MIN; inputY <= SWEEP_Y_MAX; inputY += SWEEP_STEP)
+        for (int16_t inputZ = Geometry::shoulderFootMin; inputZ <= Geometry::shoulderFootMax; inputZ += SWEEP_STEP) {
+          int16_t angle1, angle2, angle3;
+          kinematics.solveFootPosition(inputX, inputY + Geometry::limb1, inputZ, &angle1, &angle2, &angle3);
+          sink += angle1 + angle2 + angle3;
+          solves++;
+        }
+  return nanosecondsSince(start) / solves;
+}
+
+/*!
+ *    @brief  Solves with the configured robot and a smaller one in the same program
+ */
+static void benchmarkGeometries() {
+  unsigned long startAllocations = allocations;
+  double defaultTime = timeGeometry<DefaultGeometry>();
+  double smallTime = timeGeometry<SmallGeometry>();
+
+  printf("BasicKinematics<Geometry>\n");
+  printf("  %.1f ns/solve for quadruped-config.h, %.1f ns/solve for RobotGeometry<%d, %d, %d, %d, %d>, %lu allocations\n",
+         defaultTime, smallTime, SmallGeometry::limb1, SmallGeometry::limb2, SmallGeometry::limb3,
+         SmallGeometry::shoulderFootMin, SmallGeometry::shoulderFootMax, allocations - startAllocations);
+}
+
+/*!
+ *    @brief  Times one StepPlanner::update() tick for a walking leg
+ */
+static void benchmarkStepPlannerUpdate() {
+  GaitParameters gaitParameters;
+  StepPlanner::initGaitParameters(&gaitParameters, 0, 0, 160);
+
+  StepPlanner stepPlanner;
+  stepPlanner.init(LEG_1, &gaitParameters);
+
+  const unsigned long ticks = 1000000;
+  unsigned long startAllocations = allocations;
+
+  Clock::time_point start = Clock::now();
+  for (unsigned long tick = 0; tick < ticks; tick++) {
+    if (stepPlanner.footAtOrigin())
+      stepPlanner.setStepEndpoint(0, 50, WALKING);
+    stepPlanner.update();
+    StepPlanner::advanceBodyPhase(&gaitParameters);
+    sink += stepPlanner.dynamicFootPosition.z;
+  }
+  double elapsed = nanosecondsSince(start);
+
+  printf("StepPlanner::update\n");
+  printf("  %.1f ns/tick over %lu ticks, %lu allocations\n", elapsed / ticks, ticks, allocations - startAllocations);
+}
+
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+/*!
+ *    @brief  Walks a step planner over ground that changes height every few ticks (new input every tick, like a
+ *            contact sensor) and checks that the leg only takes a new ground height at the top of a swing, where
+ *            its foot is highest above the ground. The time per tick is in the update() benchmark.
+ */
+static void benchmarkTerrain() {
+  GaitParameters gaitParameters;
+  StepPlanner::initGaitParameters(&gaitParameters, 0, 0, 160);
+
+  StepPlanner stepPlanner;
+  stepPlanner.init(LEG_1, &gaitParameters);
+
+  const unsigned long ticks = 1000000;
+  const int16_t amplitude = lrintf(gaitParameters.gaits[gaitParameters.gaitType].amplitude);
+  unsigned long startAllocations = allocations;
+  unsigned long changes = 0;
+  unsigned long badChanges = 0;
+  int16_t groundHeight = 0;
+  int16_t takenHeight = 0;
+
+  srand(1);
+  for (unsigned long tick = 0; tick < ticks; tick++) {
+    if ((tick % 37) == 0)
+      groundHeight = (rand() % (2 * TERRAIN_MAX_HEIGHT + 1)) - TERRAIN_MAX_HEIGHT;
+
+    stepPlanner.setGroundHeight(groundHeight);
+    if (stepPlanner.footAtOrigin())
+      stepPlanner.setStepEndpoint(0, 50, WALKING);
+    stepPlanner.update();
+    StepPlanner::advanceBodyPhase(&gaitParameters);
+
+    if (stepPlanner.groundHeight() != takenHeight) {
+      takenHeight = stepPlanner.groundHeight();
+      changes++;
+      // the first step's swing only lifts half as high
+      int16_t lift = (160 - takenHeight) - lrintf(stepPlanner.dynamicFootPosition.z);
+      int16_t expectedLift = (stepPlanner.legMode() == FIRST_STEP) ? lrintf(amplitude * 0.5f) : amplitude;
+      if (lift != expectedLift)
+        badChanges++;
+    }
+    sink += stepPlanner.dynamicFootPosition.z;
+  }
+
+  printf("StepPlanner::update (TERRAIN_ADAPTIVE_HEIGHT)\n");
+  printf("  %lu ground changes taken over %lu ticks, %lu of them off the top of a swing, %lu allocations\n",
+    changes, ticks, badChanges, allocations - startAllocations);
+}
+#endif
+
+/*!
+ *    @brief  Times a full Quadruped::walk() tick (four step planner updates and four solves). The
+ *            virtual clock is moved one control period per call so that every call runs exactly one tick.
+ */
+static void benchmarkWalk() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Quadruped robot;
+
+  hostSetMillis(0);
+  robot.init(0, 0, 160, motors);
+
+  const unsigned long ticks = 200000;
+  unsigned long startAllocations = allocations;
+
+  Clock::time_point start = Clock::now();
+  for (unsigned long tick = 0; tick < ticks; tick++) {
+    hostAdvanceMillis(TIME_TO_UPDATE - 1);
+    robot.walk(0, 50);
+    sink += motors[0].angleDegrees;
+  }
+  double elapsed = nanosecondsSince(start);
+
+  printf("Quadruped::walk\n");
+  printf("  %.1f ns/tick over %lu ticks (%lu run by the scheduler), %lu allocations\n",
+    elapsed / ticks, ticks, (unsigned long)robot.scheduler()->tickCount, allocations - startAllocations);
+}
+
+/*!
+ *    @brief  Calls walk() every millisecond like a busy loop, changing direction every 1.7 s, and times the calls
+ *            that send a tick out separately from the ones in between. With GAIT_LOOKAHEAD the ticks are planned
+ *            in the calls in between, so the ones that send them out only copy a frame (unless one was needed
+ *            straight after a new command).
+ */
+static void benchmarkTickLatency() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Quadruped robot;
+
+  hostSetMillis(0);
+  robot.init(0, 0, 160, motors);
+
+  const int16_t directions[][2] = {{0, 50}, {30, 10}, {0, 0}, {-20, 40}};
+  const unsigned long milliseconds = 300000;
+  unsigned long startAllocations = allocations;
+  Histogram tickCalls = {};
+  Histogram otherCalls = {};
+
+  for (unsigned long millisecond = 1; millisecond <= milliseconds; millisecond++) {
+    hostAdvanceMillis(1);
+    const int16_t *direction = directions[(millisecond / 1700) % 4];
+
+    uint32_t ticks = robot.scheduler()->tickCount;
+    Clock::time_point start = Clock::now();
+    robot.walk(direction[0], direction[1]);
+    double nanoseconds = nanosecondsSince(start);
+
+    addSample((robot.scheduler()->tickCount != ticks) ? &tickCalls : &otherCalls, nanoseconds);
+    sink += motors[0].angleDegrees;
+  }
+
+  printf("Quadruped::walk (called every ms)\n");
+  printf("  calls with a tick due: %.1f ns mean, %.1f ns max; other calls: %.1f ns mean; %lu allocations\n",
+    tickCalls.total / tickCalls.count, tickCalls.maximum, otherCalls.total / otherCalls.count, allocations - startAllocations);
+#if defined(GAIT_LOOKAHEAD)
+  printf("  GAIT_LOOKAHEAD with %d frames: %lu of %lu ticks planned when they were due, %lu flushes\n", GAIT_LOOKAHEAD_FRAMES,
+    (unsigned long)robot.lookaheadUnderruns, tickCalls.count, (unsigned long)robot.lookaheadFlushes);
+#endif
+}
+
+/*!
+ *    @brief  Walks two robots side by side, calling walk() every millisecond like a busy loop. One of them has its
+ *            gait retuned (amplitude and periodHalf) every few hundred ticks with Quadruped::setGaitParameters.
+ *            This reports how long the new parameters wait to be swapped in and the time per walk() call. It also
+ *            compares the biggest motor angle change in one tick, so a foot that jumps at a swap shows up.
+ */
+static void benchmarkGaitTuning() {
+  Motor steadyMotors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Motor tunedMotors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Quadruped steadyRobot;
+  Quadruped tunedRobot;
+
+  hostSetMillis(0);
+  steadyRobot.init(0, 0, 160, steadyMotors);
+  tunedRobot.init(0, 0, 160, tunedMotors);
+
+  const unsigned long milliseconds = 300000;
+  const unsigned long retunePeriod = 1500;   // ms
+  unsigned long startAllocations = allocations;
+
+  int16_t steadyAngles[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  int16_t tunedAngles[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  int16_t steadyMaxChange = 0;
+  int16_t tunedMaxChange = 0;
+
+  unsigned long retunes = 0;
+  unsigned long stagedAt = 0;
+  unsigned long longestWait = 0;
+  double steadyTime = 0;
+  double tunedTime = 0;
+
+  for (unsigned long millisecond = 1; millisecond <= milliseconds; millisecond++) {
+    hostAdvanceMillis(1);
+
+    if ((millisecond % retunePeriod) == 0) {
+      Gait gait = *tunedRobot.getGait(TROT);
+      bool isBigger = (gait.amplitude == 20);
+      gait.amplitude = isBigger ? 30 : 20;
+      gait.drawBackAmplitude = gait.amplitude / DRAW_BACK_AMPLITUDE_REDUCTION;
+      gait.periodHalf = isBigger ? 60 : 80;
+      tunedRobot.setGaitParameters(TROT, &gait);
+      stagedAt = millisecond;
+      retunes++;
+    }
+
+    Clock::time_point start = Clock::now();
+    steadyRobot.walk(0, 50);
+    steadyTime += nanosecondsSince(start);
+
+    start = Clock::now();
+    bool wasPending = tunedRobot.isGaitParametersPending();
+    tunedRobot.walk(0, 50);
+    tunedTime += nanosecondsSince(start);
+
+    if (wasPending && !tunedRobot.isGaitParametersPending() && (millisecond - stagedAt > longestWait))
+      longestWait = millisecond - stagedAt;
+
+    // Skip the first step, where the feet move to where the gait starts
+    for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++) {
+      int16_t steadyChange = abs(sentAngle(&steadyRobot, steadyMotors, motor) - steadyAngles[motor]);
+      int16_t tunedChange = abs(sentAngle(&tunedRobot, tunedMotors, motor) - tunedAngles[motor]);
+      if ((millisecond > 100) && (steadyChange > steadyMaxChange))
+        steadyMaxChange = steadyChange;
+      if ((millisecond > 100) && (tunedChange > tunedMaxChange))
+        tunedMaxChange = tunedChange;
+      steadyAngles[motor] = sentAngle(&steadyRobot, steadyMotors, motor);
+      tunedAngles[motor] = sentAngle(&tunedRobot, tunedMotors, motor);
+    }
+  }
+
+  printf("Quadruped::setGaitParameters\n");
+  printf("  %lu retunes while walking, swapped in after at most %lu ms; %.1f ns/walk() call against %.1f ns untuned, %lu allocations\n",
+    retunes, longestWait, tunedTime / milliseconds, steadyTime / milliseconds, allocations - startAllocations);
+  printf("  biggest motor angle change in one tick: %d degrees (untuned %d)\n", tunedMaxChange, steadyMaxChange);
+}
+
+/*!
+ *    @brief  Records a walk (that stops at the end) with TrajectoryRecorder, then times playing it back through
+ *            Quadruped::walk() and checks that every tick gives the recorded angles.
+ */
+static void benchmarkTrajectory() {
+  const uint16_t walkingTicks = 1500;
+  const uint16_t ticks = 2000;
+  static uint8_t recording[UINT16_MAX];
+  static int16_t recordedAngles[ticks][TRAJECTORY_ANGLES];
+
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Quadruped robot;
+  TrajectoryRecorder recorder;
+
+  hostSetMillis(0);
+  robot.init(0, 0, 160, motors);
+  recorder.begin(recording, sizeof(recording));
+  robot.setTrajectoryRecorder(&recorder);
+  for (uint16_t tick = 0; tick < ticks; tick++) {
+    hostAdvanceMillis(TIME_TO_UPDATE - 1);
+    robot.walk(0, (tick < walkingTicks) ? 50 : 0);
+    for (uint8_t motor = 0; motor < TRAJECTORY_ANGLES; motor++)
+      recordedAngles[tick][motor] = motors[motor].angleDegrees;
+  }
+  robot.setTrajectoryRecorder(NULL);
+
+  TrajectoryPlayer player;
+  player.begin(recorder.data(), recorder.length());
+
+  const int repeats = 50;
+  unsigned long wrongAngles = 0;
+  unsigned long startAllocations = allocations;
+
+  Clock::time_point start = Clock::now();
+  for (int repeat = 0; repeat < repeats; repeat++) {
+    player.rewind();
+    robot.playTrajectory(&player);
+    for (uint16_t tick = 0; tick < ticks; tick++) {
+      hostAdvanceMillis(TIME_TO_UPDATE - 1);
+      robot.walk(0, 0);
+      for (uint8_t motor = 0; motor < TRAJECTORY_ANGLES; motor++)
+        wrongAngles += (motors[motor].angleDegrees != recordedAngles[tick][motor]);
+    }
+  }
+  double elapsed = nanosecondsSince(start);
+
+  printf("TrajectoryRecorder + TrajectoryPlayer\n");
+  printf("  %u frames in %u bytes (%.1f bytes/frame, %d raw), %.1f ns/tick playing back, %lu angles wrong, %lu allocations\n",
+    recorder.frameCount(), recorder.length(), (double)(recorder.length() - TRAJECTORY_HEADER_SIZE) / recorder.frameCount(),
+    (int)(TRAJECTORY_VALUES * sizeof(int16_t)), elapsed / (repeats * ticks), wrongAngles, allocations - startAllocations);
+}
+
+// Takes the pulse widths without sending them anywhere
+class NullServoDriver : public ServoDriver {
+  public:
+    void writePulseWidths(const uint8_t channels[], const uint16_t pulseWidths[], uint16_t changedMotors) {
+      sink += channels[0] + pulseWidths[0] + changedMotors;
+    }
+};
+
+/*!
+ *    @brief  Reads telemetry frames back out of a byte stream
+ *    @param  stream The bytes drained from a Telemetry
+ *    @param  length How many
+ *    @param  frames Output for how many frames were found
+ *    @param  badFrames Output for frames with a wrong checksum or the same tick as the frame before
+ */
+static void decodeTelemetry(const uint8_t *stream, size_t length, unsigned long *frames, unsigned long *badFrames) {
+  Telemetry sizes;
+  size_t position = 0;
+  uint16_t lastTick = 0;
+  while (position + 2 <= length) {
+    if (stream[position] != TELEMETRY_SYNC) {
+      position++;
+      continue;
+    }
+    sizes.setFields(stream[position + 1]);
+    size_t size = sizes.frameSize();
+    if (position + size > length)
+      break;
+
+    uint8_t checksum = 0;
+    for (size_t byte = position + 1; byte < position + size; byte++)
+      checksum ^= stream[byte];
+    uint16_t tick = stream[position + 2] | (stream[position + 3] << 8);
+    if ((checksum != 0) || ((*frames > 0) && ((uint16_t)(tick - lastTick) == 0)))
+      (*badFrames)++;
+
+    lastTick = tick;
+    (*frames)++;
+    position += size;
+  }
+}
+
+/*!
+ *    @brief  Times Telemetry::record() for a few field sets, and drains frames like a 115200 baud UART would
+ *            (about 35 bytes every 3 ms tick), checking that every frame that made it decodes
+ */
+static void benchmarkTelemetry() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Coordinate feet[ROBOT_LEG_COUNT] = {};
+  LegMode legModes[ROBOT_LEG_COUNT] = { STEPPING, STEPPING, FIRST_STEP, STANDING };
+  Scheduler scheduler;
+  scheduler.init(TIME_TO_UPDATE - 1);
+
+  static Telemetry telemetry;
+  unsigned long startAllocations = allocations;
+
+  printf("Telemetry\n");
+
+  const uint8_t fieldSets[] = { TELEMETRY_ALL_FIELDS, TELEMETRY_MODES | TELEMETRY_TIMING, TELEMETRY_ANGLES };
+  const char * const fieldNames[] = { "all fields", "modes + timing", "angles" };
+  const unsigned long frames = 200000;
+
+  for (uint8_t fieldSet = 0; fieldSet < sizeof(fieldSets); fieldSet++) {
+    telemetry.reset();
+    telemetry.setDecimation(1);
+    telemetry.setFields(fieldSets[fieldSet]);
+
+    uint8_t drained[TELEMETRY_BUFFER_SIZE];
+    double recordTime = 0;
+
+    for (unsigned long frame = 0; frame < frames; frame++) {
+      motors[frame % (ROBOT_LEG_COUNT * MOTORS_PER_LEG)].angleDegrees = frame & 0xFF;
+      feet[frame % ROBOT_LEG_COUNT].x = frame & 0x3F;
+
+      Clock::time_point start = Clock::now();
+      if (telemetry.tick())
+        telemetry.record(WALKING, legModes, feet, motors, 150, &scheduler);
+      recordTime += nanosecondsSince(start);
+
+      sink += telemetry.read(drained, sizeof(drained));
+    }
+
+    printf("  %-15s %2d bytes/frame, %.1f ns/tick\n", fieldNames[fieldSet], telemetry.frameSize(), recordTime / frames);
+  }
+
+  // A UART too slow for a frame every tick: frames are dropped whole, or decimated so they all fit
+  const unsigned long ticks = 20000;
+  const uint8_t uartBytesPerTick = 35;
+  static uint8_t stream[ticks * TELEMETRY_MAX_FRAME_SIZE];
+
+  for (uint8_t decimation = 1; decimation <= 2; decimation++) {
+    telemetry.reset();
+    telemetry.setDecimation(decimation);
+    telemetry.setFields(TELEMETRY_ALL_FIELDS);
+    size_t streamLength = 0;
+
+    for (unsigned long tick = 0; tick < ticks; tick++) {
+      if (telemetry.tick())
+        telemetry.record(WALKING, legModes, feet, motors, 150, &scheduler);
+      streamLength += telemetry.read(&stream[streamLength], uartBytesPerTick);
+    }
+    streamLength += telemetry.read(&stream[streamLength], TELEMETRY_BUFFER_SIZE);
+
+    unsigned long decoded = 0, badFrames = 0;
+    decodeTelemetry(stream, streamLength, &decoded, &badFrames);
+    printf("  every %d tick(s) over a %d byte/tick UART: %lu frames written, %lu dropped, %lu decoded (%lu bad)\n",
+           decimation, uartBytesPerTick, (unsigned long)telemetry.frameCount, (unsigned long)telemetry.droppedFrameCount, decoded, badFrames);
+  }
+  printf("  %lu allocations\n", allocations - startAllocations);
+}
+
+/*!
+ *    @brief  Times ServoOutput::update() alone when every motor has changed (the worst case)
+ */
+static void benchmarkServoOutputUpdate() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++) {
+    motors[motor].controlPin = motor;
+    motors[motor].applicationOffset = 90;
+    motors[motor].minPos = 10;
+    motors[motor].maxPos = 170;
+  }
+
+  NullServoDriver driver;
+  ServoOutput servoOutput;
+  servoOutput.init(motors, ROBOT_LEG_COUNT * MOTORS_PER_LEG, &driver);
+
+  const unsigned long updates = 1000000;
+  unsigned long startAllocations = allocations;
+
+  Clock::time_point start = Clock::now();
+  for (unsigned long update = 0; update < updates; update++) {
+    int16_t angle = (update % 2 == 0) ? -30 : 30;
+    for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++)
+      motors[motor].angleDegrees = angle + motor;
+    servoOutput.update(STATIC_DEGREES);
+  }
+  double elapsed = nanosecondsSince(start);
+
+  printf("ServoOutput::update (%s)\n",
+#if defined(SERVO_PULSE_TABLES)
+    "pulse tables"
+#else
+    "linear map"
+#endif
+  );
+  printf("  %.1f ns/update with all %d motors changed, %lu allocations\n",
+    elapsed / updates, ROBOT_LEG_COUNT * MOTORS_PER_LEG, allocations - startAllocations);
+}
+
+/*!
+ *    @brief  Measures the I2C traffic of writing the walking motor angles to a PCA9685 through ServoOutput,
+ *            against rewriting all 12 channels every tick with one transmission each.
+ */
+static void benchmarkServoOutput() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++)
+    motors[motor].controlPin = motor;
+
+  Quadruped robot;
+  PCA9685Driver driver;
+  ServoOutput servoOutput;
+
+  hostSetMillis(0);
+  robot.init(0, 0, 160, motors);
+  driver.init(0x40, 50, &Wire);
+  servoOutput.init(motors, ROBOT_LEG_COUNT * MOTORS_PER_LEG, &driver);
+  robot.setServoOutput(&servoOutput);
+
+  const unsigned long ticks = 200000;
+  unsigned long startBytes = Wire.byteCount;
+  unsigned long startTransmissions = Wire.transmissionCount;
+  unsigned long startAllocations = allocations;
+
+  Clock::time_point start = Clock::now();
+  for (unsigned long tick = 0; tick < ticks; tick++) {
+    hostAdvanceMillis(TIME_TO_UPDATE - 1);
+    robot.walk(0, 50);
+  }
+  double elapsed = nanosecondsSince(start);
+
+  // address + register + 4 bytes for each channel
+  const double allChannelsBytes = ROBOT_LEG_COUNT * MOTORS_PER_LEG * 6;
+
+  printf("ServoOutput + PCA9685Driver (walking)\n");
+  printf("  %.1f ns/tick including walk(), %lu allocations\n", elapsed / ticks, allocations - startAllocations);
+  printf("  %.2f motors, %.2f transmissions and %.1f I2C bytes per tick (%.0f bytes to rewrite every channel)\n",
+    (double)servoOutput.motorWriteCount / ticks, (double)(Wire.transmissionCount - startTransmissions) / ticks,
+    (double)(Wire.byteCount - startBytes) / ticks, allChannelsBytes);
+}
+
+
+int main() {
+  printf("Kinematics backend: ");
+#if defined(FIXED_POINT_KINEMATICS)
+  printf("fixed point");
+#else
+  printf("float");
+#endif
+#if defined(WORKSPACE_ANGLE_TABLE)
+  printf(" + workspace table");
+#endif
+#if defined(DIFFERENTIAL_KINEMATICS)
+  printf(" + differential setFootEndpoint");
+#endif
+  printf("\n\n");
+
+  benchmarkSolveFootPosition();
+  benchmarkCheckReachability();
+  benchmarkUpdateDynamicFootPosition();
+#if defined(DIFFERENTIAL_KINEMATICS)
+  benchmarkTrackFootPosition();
+#endif
+  benchmarkGeometries();
+  benchmarkStepPlannerUpdate();
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+  benchmarkTerrain();
+#endif
+  benchmarkWalk();
+  benchmarkTickLatency();
+  benchmarkGaitTuning();
+  benchmarkTelemetry();
+  benchmarkTrajectory();
+  benchmarkServoOutputUpdate();
+  benchmarkServoOutput();
+  return 0;
+}
@@ -0,0 +1,307 @@
+// fleetbench.cpp
+// Checks the batch kernels of Fleet.h against the library they stand in for, checks a fleet robot against a
+// Quadruped, then measures how many robots the fleet can tick at 1 kHz on 1 to all of the host's cores. See
+// README.md.
+//
+//   ./fleetbench [--threads count] [--ticks count]
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "Fleet.h"
+#include "Quadruped.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double nanosecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// Keeps results alive so that the compiler can't remove the work being measured
+static volatile int32_t sink;
+
+typedef struct {
+  unsigned threads;
+  unsigned long ticks;
+} Options;
+
+static Options options = { 0, 2000 };
+
+// The box the kinematics are checked over (setFootEndpoint() coordinates): all of the walking workspace and
+// a margin of unreachable positions around it
+#define CHECK_X_MIN   -80
+#define CHECK_X_MAX   80
+#define CHECK_Y_MIN   -80
+#define CHECK_Y_MAX   80
+#define CHECK_Z_MIN   60
+#define CHECK_Z_MAX   260
+
+
+// SoA buffers that free themselves
+typedef struct {
+  std::vector<int16_t> x, y, z, angle1, angle2, angle3;
+
+  void resize(size_t entries) {
+    x.resize(entries); y.resize(entries); z.resize(entries);
+    angle1.resize(entries); angle2.resize(entries); angle3.resize(entries);
+  }
+  FleetFeet feet() { FleetFeet feet = { x.data(), y.data(), z.data() }; return feet; }
+  FleetAngles angles() { FleetAngles angles = { angle1.data(), angle2.data(), angle3.data() }; return angles; }
+} LegBuffers;
+
+
+/*!
+ *    @brief  Solves every point of the check box with fleetSolveFootPositions() and with the float solve of
+ *            Kinematics (solveFootAngles(), rounded like solveFootPosition() does), and counts the angles that
+ *            differ. Then times both.
+ */
+static void checkSolveFootPositions() {
+  LegBuffers buffers;
+  for (int16_t z = CHECK_Z_MIN; z <= CHECK_Z_MAX; z++)
+    for (int16_t y = CHECK_Y_MIN; y <= CHECK_Y_MAX; y++)
+      for (int16_t x = CHECK_X_MIN; x <= CHECK_X_MAX; x++) {
+        buffers.x.push_back(x);
+        buffers.y.push_back(y);
+        buffers.z.push_back(z);
+      }
+  size_t points = buffers.x.size();
+  buffers.resize(points);
+  FleetFeet feet = buffers.feet();
+  FleetAngles angles = buffers.angles();
+
+  Clock::time_point start = Clock::now();
+  fleetSolveFootPositions(&feet, &angles, 0, points);
+  double batchTime = nanosecondsSince(start) / points;
+
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Kinematics kinematics;
+  kinematics.init(LEG_1, 0, 0, 160, motors);
+
+  unsigned long differences = 0;
+  int16_t maxDifference = 0;
+  start = Clock::now();
+  for (size_t point = 0; point < points; point++) {
+    float demandAngles[3];
+    kinematics.solveFootAngles(feet.x[point], feet.y[point] + LIMB_1, feet.z[point], &demandAngles[0], &demandAngles[1], &demandAngles[2]);
+    const int16_t batchAngles[3] = { angles.angle1[point], angles.angle2[point], angles.angle3[point] };
+
+    for (uint8_t motor = 0; motor < 3; motor++) {
+      int16_t difference = abs(lrintf(demandAngles[motor]) - batchAngles[motor]);
+      differences += (difference != 0);
+      maxDifference = std::max(maxDifference, difference);
+    }
+  }
+  double scalarTime = nanosecondsSince(start) / points;
+
+  printf("fleetSolveFootPositions (%s)\n", fleetKernelName());
+  printf("  %lu positions, %lu angles differ from Kinematics::solveFootAngles (by up to %d degrees)\n", (unsigned long)points, differences, maxDifference);
+  printf("  %.2f ns/leg batched, %.2f ns/leg for solveFootAngles\n", batchTime, scalarTime);
+}
+
+/*!
+ *    @brief  Works out every step height of every gait with fleetStepHeights() and with StepPlanner::getStepHeight()
+ *            (the height table, or calculated for a gait that doesn't fit in it), and counts the ones that differ
+ */
+static void checkStepHeights() {
+  GaitParameters gaitParameters;
+  StepPlanner planner;
+  StepPlanner::initGaitParameters(&gaitParameters, 0, 0, 160);
+  planner.init(LEG_1, &gaitParameters);
+
+  std::vector<uint16_t> legTicks;
+  std::vector<uint8_t> legModes;
+  std::vector<int16_t> robotHeights, expected;
+  std::vector<float> amplitudes, drawBackAmplitudes;
+  std::vector<uint16_t> swingTicks, stanceTicks;
+
+  // every gait, and the trot with a periodHalf too long for the table
+  for (uint8_t gait = 0; gait <= NUMBER_OF_GAITS; gait++) {
+    if (gait < NUMBER_OF_GAITS) {
+      planner.setGait((GaitType)gait);   // the planner is standing, so this takes
+    }
+    else {
+      Gait longTrot = gaitParameters.gaits[TROT];
+      longTrot.periodHalf = 2 * GAIT_TABLE_MAX_PERIOD_HALF;
+      StepPlanner::stageGait(&gaitParameters, TROT, &longTrot);
+      planner.setGait(TROT);
+      StepPlanner::swapStagedGait(&gaitParameters, true);
+    }
+
+    const Gait *parameters = &gaitParameters.gaits[gaitParameters.gaitType];
+    const GaitTiming *timing = &gaitParameters.timing;
+    for (uint16_t legTick = 0; legTick < timing->cycleTicks; legTick++) {
+      // the first step only ever joins at an origin, so its swing is the second half
+      for (uint8_t legMode = STANDING; legMode <= STEPPING; legMode++) {
+        if ((legMode == FIRST_STEP) && (legTick < timing->swingTicks / 2))
+          continue;
+        legTicks.push_back(legTick);
+        legModes.push_back(legMode);
+        robotHeights.push_back(gaitParameters.robotHeight);
+        amplitudes.push_back(parameters->amplitude);
+        drawBackAmplitudes.push_back(parameters->drawBackAmplitude);
+        swingTicks.push_back(timing->swingTicks);
+        stanceTicks.push_back(timing->stanceTicks);
+        expected.push_back(planner.getStepHeight(legTick, (LegMode)legMode));
+      }
+    }
+  }
+
+  size_t entries = legTicks.size();
+  std::vector<int16_t> heights(entries);
+  FleetSteps steps = { legTicks.data(), legModes.data(), robotHeights.data(), amplitudes.data(),
+                       drawBackAmplitudes.data(), swingTicks.data(), stanceTicks.data() };
+  fleetStepHeights(&steps, heights.data(), 0, entries);
+
+  unsigned long differences = 0;
+  for (size_t entry = 0; entry < entries; entry++)
+    differences += (heights[entry] != expected[entry]);
+
+  printf("fleetStepHeights (%s)\n", fleetKernelName());
+  printf("  %lu heights over %u gaits, %lu differ from StepPlanner::getStepHeight\n", (unsigned long)entries, NUMBER_OF_GAITS + 1, differences);
+}
+
+// The control coordinate for a tick: walking, turning, stopping and starting again
+static void controlFor(unsigned long tick, uint32_t robot, int16_t *controlCoordinateX, int16_t *controlCoordinateY) {
+  static const int16_t controls[][2] = { { 0, 50 }, { 30, 40 }, { -50, 0 }, { 0, 0 }, { 20, -20 }, { 0, 0 } };
+  const unsigned period = 700;   // ticks; long enough to stop in
+  unsigned index = ((tick / period) + robot) % (sizeof(controls) / sizeof(controls[0]));
+  *controlCoordinateX = controls[index][0];
+  *controlCoordinateY = controls[index][1];
+}
+
+/*!
+ *    @brief  Walks a Quadruped (with whichever options it was built with) next to robot 0 of a fleet, tick by tick,
+ *            and counts the feet and angles that differ. The fleet always solves in float, so with another kinematics
+ *            backend only the feet are expected to match exactly.
+ */
+static void checkFleetAgainstQuadruped() {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Quadruped robot;
+  hostSetMillis(0);
+  robot.init(0, 0, 160, motors);
+
+  Fleet fleet;
+  fleet.init(1, 0, 0, 160, 1);
+
+  const unsigned long ticks = 6000;
+  unsigned long footDifferences = 0;
+  unsigned long angleDifferences = 0;
+  int16_t maxAngleDifference = 0;
+
+  for (unsigned long tick = 0; tick < ticks; tick++) {
+    int16_t controlCoordinateX, controlCoordinateY;
+    controlFor(tick, 0, &controlCoordinateX, &controlCoordinateY);
+
+    hostAdvanceMillis(TIME_TO_UPDATE - 1);
+    robot.walk(controlCoordinateX, controlCoordinateY);
+#if defined(GAIT_LOOKAHEAD)
+    const int16_t *robotAngles = robot.outputAngles();
+#endif
+
+    fleet.setControl(0, controlCoordinateX, controlCoordinateY);
+    fleet.tick();
+
+    const FleetFeet *feet = fleet.feet();
+    const FleetAngles *angles = fleet.angles();
+    for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+      const int16_t fleetAngles[MOTORS_PER_LEG] = { angles->angle1[leg], angles->angle2[leg], angles->angle3[leg] };
+      for (uint8_t motor = 0; motor < MOTORS_PER_LEG; motor++) {
+#if defined(GAIT_LOOKAHEAD)
+        int16_t robotAngle = robotAngles[(leg * MOTORS_PER_LEG) + motor];
+#else
+        int16_t robotAngle = motors[(leg * MOTORS_PER_LEG) + motor].angleDegrees;
+#endif
+        int16_t difference = abs(robotAngle - fleetAngles[motor]);
+        angleDifferences += (difference != 0);
+        maxAngleDifference = std::max(maxAngleDifference, difference);
+      }
+
+      // the feet the fleet solves for are the ones the planner has (the Quadruped's aren't public)
+      const StepPlanner *planner = fleet.stepPlanner(0, (LegID)(leg + 1));
+      footDifferences += (feet->x[leg] != (int16_t)planner->dynamicFootPosition.x) ||
+                         (feet->y[leg] != (int16_t)planner->dynamicFootPosition.y) ||
+                         (feet->z[leg] != (int16_t)planner->dynamicFootPosition.z);
+    }
+  }
+
+  printf("Fleet against Quadruped\n");
+  printf("  %lu ticks: %lu feet differ from the step planners, %lu angles differ from Quadruped::walk (by up to %d degrees)\n",
+    ticks, footDifferences, angleDifferences, maxAngleDifference);
+}
+
+/*!
+ *    @brief  Ticks fleets of a few sizes on 1 to options.threads threads, every robot walking its own pattern
+ */
+static void benchmarkFleet() {
+  static const uint32_t robotCounts[] = { 64, 256, 1024 };
+  const double tickPeriod = 1e6;   // ns; 1 kHz
+
+  printf("Fleet::tick (%s, %u cores)\n", fleetKernelName(), std::max(1u, std::thread::hardware_concurrency()));
+  printf("  %7s %7s | %10s %10s | %14s %9s %s\n", "robots", "threads", "us/tick", "max us", "robot-ticks/s", "scaling", "1 kHz");
+
+  for (uint8_t size = 0; size < sizeof(robotCounts) / sizeof(robotCounts[0]); size++) {
+    uint32_t robotCount = robotCounts[size];
+    double singleThreadTime = 0;
+
+    for (unsigned threads = 1; threads <= options.threads; threads++) {
+      Fleet fleet;
+      fleet.init(robotCount, 0, 0, 160, threads);
+
+      double totalTime = 0;
+      double maxTime = 0;
+      for (unsigned long tick = 0; tick < options.ticks; tick++) {
+        for (uint32_t robot = 0; robot < robotCount; robot++) {
+          int16_t controlCoordinateX, controlCoordinateY;
+          controlFor(tick, robot, &controlCoordinateX, &controlCoordinateY);
+          fleet.setControl(robot, controlCoordinateX, controlCoordinateY);
+        }
+
+        Clock::time_point start = Clock::now();
+        fleet.tick();
+        double elapsed = nanosecondsSince(start);
+        totalTime += elapsed;
+        maxTime = std::max(maxTime, elapsed);
+        sink += fleet.angles()->angle2[tick % (robotCount * ROBOT_LEG_COUNT)];
+      }
+
+      double tickTime = totalTime / options.ticks;
+      if (threads == 1)
+        singleThreadTime = tickTime;
+      printf("  %7u %7u | %10.1f %10.1f | %14.0f %8.2fx %s\n", robotCount, threads, tickTime / 1000, maxTime / 1000,
+        robotCount * 1e9 / tickTime, singleThreadTime / tickTime, (maxTime < tickPeriod) ? "yes" : ((tickTime < tickPeriod) ? "mean only" : "no"));
+    }
+  }
+}
+
+static bool parseOptions(int argc, char **argv) {
+  for (int arg = 1; arg + 1 < argc; arg += 2) {
+    if (strcmp(argv[arg], "--threads") == 0)
+      options.threads = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "--ticks") == 0)
+      options.ticks = atol(argv[arg + 1]);
+    else
+      return false;
+  }
+  return (argc % 2 == 1) && (options.ticks > 0);
+}
+
+int main(int argc, char **argv) {
+  if (!parseOptions(argc, argv)) {
+    fprintf(stderr, "usage: %s [--threads count] [--ticks count]\n", argv[0]);
+    return 2;
+  }
+
+  if (options.threads == 0)
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+  checkSolveFootPositions();
+  checkStepHeights();
+  checkFleetAgainstQuadruped();
+  benchmarkFleet();
+  return 0;
+}
@@ -0,0 +1,367 @@
+// gaitsweep.cpp
+// Headless gait simulator: walks StepPlanner + Kinematics tick by tick (no clock, so it goes as fast as the host
+// can) for every combination of the gait settings in the sweep, split across all of the host's cores. Each run
+// reports the joint velocity and acceleration peaks, how often a foot was asked to go outside of
+// SHOULDER_FOOT_MIN/MAX and what it cost to compute. See README.md.
+//
+//   ./gaitsweep [--gait name] [--amplitude min:max:step] [--period-half min:max:step] [--draw-back min:max:step]
+//               [--tick min:max:step] [--cycles count] [--max-velocity degrees/s] [--threads count] [--best count]
+//               [--csv file]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "StepPlanner.h"
+#include "Kinematics.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static const char * const GAIT_NAMES[NUMBER_OF_GAITS] = { "trot", "pace", "bound", "walk", "crawl" };
+
+typedef struct {
+  float min;
+  float max;
+  float step;
+} Range;
+
+typedef struct {
+  GaitType gaitType;
+  float amplitude;          // Gait.amplitude (mm)
+  float periodHalf;         // Gait.periodHalf (ticks for a GAIT_POSITION_INCREMENT of 1)
+  float drawBackReduction;  // what DRAW_BACK_AMPLITUDE_REDUCTION would be; the gait's drawBackAmplitude is amplitude / this
+  float tickPeriod;         // TIME_TO_UPDATE - 1 (ms)
+} Config;
+
+typedef struct {
+  unsigned long ticks;            // walking, then stopping
+  unsigned long reachViolations;  // foot positions outside of SHOULDER_FOOT_MIN/MAX (counted for every leg)
+  unsigned long ticksToStand;     // from letting go of the controls to every leg standing
+  float peakVelocity;             // fastest that any motor moved while walking (degrees/s)
+  float peakAcceleration;         // degrees/s^2
+  float stopVelocity;             // fastest that any motor moved while stopping; a foot that stops in the air is put down
+  float speed;                    // how fast the body walks (mm/s)
+  double nanoseconds;             // time spent in the step planners and kinematics
+} Result;
+
+typedef struct {
+  int gait;           // -1 for all of them
+  Range amplitude;
+  Range periodHalf;
+  Range drawBack;
+  Range tick;
+  unsigned cycles;
+  float maxVelocity;
+  unsigned threads;
+  unsigned best;
+  const char *csvPath;
+} Options;
+
+static Options options = { TROT, { 10, 30, 2 }, { 40, 160, 8 }, { 1, 4, 1 }, { TIME_TO_UPDATE - 1, TIME_TO_UPDATE - 1, 1 },
+                           10, 1000.0 / MAX_SPEED_INVERSE, 0, 10, NULL };
+
+static std::vector<Config> configs;
+static std::vector<Result> results;
+static std::atomic<size_t> nextRun(0);
+
+
+/*!
+ *    @brief  A robot without the Quadruped around it: the gait parameters, step planners and kinematics of all
+ *            four legs, driven by the same steps as Quadruped::_tick().
+ */
+class GaitSimulation {
+
+  public:
+    void init(const Config *config) {
+      _tickSeconds = config->tickPeriod / 1000;
+
+      StepPlanner::initGaitParameters(&_gaitParameters, 0, 0, 160);
+      for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+        _stepPlanners[leg].init((LegID)(LEG_1 + leg), &_gaitParameters);
+        _kinematics[leg].init((LegID)(LEG_1 + leg), 0, 0, 160, _motors);
+      }
+
+      // The gait being swept replaces the built in one of its type; setGait() works out its timing
+      Gait *gait = &_gaitParameters.gaits[config->gaitType];
+      gait->amplitude = config->amplitude;
+      gait->periodHalf = config->periodHalf;
+      if (gait->drawBackAmplitude != 0)
+        gait->drawBackAmplitude = config->amplitude / config->drawBackReduction;
+      _stepPlanners[0].setGait(config->gaitType);
+
+      // Standing with no command yet, as in Quadruped::init(), so that the first setStepDirection() has something
+      // to compare
+      _robotMode = STATIC_STANDING;
+      _stepDirection.controlCoordinateX = 0;
+      _stepDirection.controlCoordinateY = 0;
+      _stepDirection.x = 0;
+      _stepDirection.y = 0;
+
+      for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++)
+        _velocities[motor] = 0;
+      _isMoving = false;
+      peakVelocity = 0;
+      peakAcceleration = 0;
+    }
+
+    // One tick of walking for the command, the way Quadruped's tick sequences the legs (0, 0 stops them); false
+    // once every leg is standing. The peaks of the motors are kept in peakVelocity and peakAcceleration.
+    bool tick(int16_t controlCoordinateX, int16_t controlCoordinateY, Result *result) {
+      Clock::time_point start = Clock::now();
+
+      _robotMode = StepPlanner::changeRobotMode(&_gaitParameters, _stepPlanners, _robotMode, controlCoordinateX, controlCoordinateY);
+      bool isStanding = StepPlanner::stepLegs(&_gaitParameters, _stepPlanners, &_stepDirection, controlCoordinateX,
+                                              controlCoordinateY, &_robotMode);
+
+      for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+        const Coordinate *foot = &_stepPlanners[leg].dynamicFootPosition;
+        _kinematics[leg].setFootEndpoint(foot->x, foot->y, foot->z);
+      }
+
+      result->nanoseconds += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+      result->ticks++;
+
+      // The motor angles are whole degrees, so they are solved again unrounded to find how fast they move
+      for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+        int16_t inputX = _stepPlanners[leg].dynamicFootPosition.x;
+        int16_t inputY = _stepPlanners[leg].dynamicFootPosition.y + LIMB_1;
+        int16_t inputZ = _stepPlanners[leg].dynamicFootPosition.z;
+        if (Kinematics::checkReachability(inputX, inputY - LIMB_1, inputZ) != FOOT_REACHABLE)
+          result->reachViolations++;
+
+        float angles[MOTORS_PER_LEG];
+        _kinematics[leg].solveFootAngles(inputX, inputY, inputZ, &angles[0], &angles[1], &angles[2]);
+
+        for (uint8_t legMotor = 0; legMotor < MOTORS_PER_LEG; legMotor++) {
+          uint8_t motor = leg * MOTORS_PER_LEG + legMotor;
+          if (!_isMoving) {
+            _angles[motor] = angles[legMotor];
+            continue;
+          }
+
+          float velocity = (angles[legMotor] - _angles[motor]) / _tickSeconds;
+          float acceleration = (velocity - _velocities[motor]) / _tickSeconds;
+          peakVelocity = std::max(peakVelocity, fabsf(velocity));
+          peakAcceleration = std::max(peakAcceleration, fabsf(acceleration));
+          _angles[motor] = angles[legMotor];
+          _velocities[motor] = velocity;
+        }
+      }
+      _isMoving = true;
+
+      return !isStanding;
+    }
+
+    const GaitTiming * timing() {
+      return &_gaitParameters.timing;
+    }
+
+    float peakVelocity;       // degrees/s
+    float peakAcceleration;   // degrees/s^2
+
+  private:
+    GaitParameters _gaitParameters;
+    StepPlanner _stepPlanners[ROBOT_LEG_COUNT];
+    Kinematics _kinematics[ROBOT_LEG_COUNT];
+    Motor _motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG];
+    StepDirection _stepDirection;
+    ROBOT_MODE _robotMode;
+
+    float _tickSeconds;
+    float _angles[ROBOT_LEG_COUNT * MOTORS_PER_LEG];       // unrounded, at the last tick (degrees)
+    float _velocities[ROBOT_LEG_COUNT * MOTORS_PER_LEG];   // degrees/s over the last tick
+    bool _isMoving;                                        // false until the first tick has set _angles
+};
+
+/*!
+ *    @brief  Walks forwards for options.cycles gait cycles from standing, then lets go of the controls and runs
+ *            until every leg has stopped (or for as long again)
+ */
+static void simulate(const Config *config, Result *result) {
+  GaitSimulation simulation;
+  simulation.init(config);
+
+  unsigned long walkingTicks = (unsigned long)options.cycles * simulation.timing()->cycleTicks;
+  for (unsigned long tick = 0; tick < walkingTicks; tick++)
+    simulation.tick(0, 50, result);
+  result->peakVelocity = simulation.peakVelocity;
+  result->peakAcceleration = simulation.peakAcceleration;
+
+  simulation.peakVelocity = 0;
+  result->ticksToStand = 0;
+  while (simulation.tick(0, 0, result) && (result->ticksToStand < walkingTicks))
+    result->ticksToStand++;
+  result->stopVelocity = simulation.peakVelocity;
+
+  // A foot on the ground draws back from periodHalf / 2 to -periodHalf / 2 over the stance; the body moves as fast
+  result->speed = config->periodHalf / (simulation.timing()->stanceTicks * config->tickPeriod / 1000);
+}
+
+static void sweepThread() {
+  for (size_t run = nextRun++; run < configs.size(); run = nextRun++)
+    simulate(&configs[run], &results[run]);
+}
+
+static bool parseRange(const char *text, Range *range) {
+  if (sscanf(text, "%f:%f:%f", &range->min, &range->max, &range->step) == 3)
+    return (range->step > 0) && (range->min <= range->max);
+  if (sscanf(text, "%f", &range->min) == 1) {
+    range->max = range->min;
+    range->step = 1;
+    return true;
+  }
+  return false;
+}
+
+static bool parseOptions(int argc, char **argv) {
+  bool isValid = (argc % 2 == 1);
+  for (int arg = 1; isValid && (arg + 1 < argc); arg += 2) {
+    if (strcmp(argv[arg], "--gait") == 0) {
+      options.gait = -2;
+      for (int gait = 0; gait < NUMBER_OF_GAITS; gait++)
+        if (strcmp(argv[arg + 1], GAIT_NAMES[gait]) == 0)
+          options.gait = gait;
+      if (strcmp(argv[arg + 1], "all") == 0)
+        options.gait = -1;
+      isValid = (options.gait != -2);
+    }
+    else if (strcmp(argv[arg], "--amplitude") == 0)
+      isValid = parseRange(argv[arg + 1], &options.amplitude);
+    else if (strcmp(argv[arg], "--period-half") == 0)
+      isValid = parseRange(argv[arg + 1], &options.periodHalf) && (options.periodHalf.min >= 2);
+    else if (strcmp(argv[arg], "--draw-back") == 0)
+      isValid = parseRange(argv[arg + 1], &options.drawBack) && (options.drawBack.min > 0);
+    else if (strcmp(argv[arg], "--tick") == 0)
+      isValid = parseRange(argv[arg + 1], &options.tick) && (options.tick.min > 0);
+    else if (strcmp(argv[arg], "--cycles") == 0)
+      options.cycles = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "--max-velocity") == 0)
+      options.maxVelocity = atof(argv[arg + 1]);
+    else if (strcmp(argv[arg], "--threads") == 0)
+      options.threads = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "--best") == 0)
+      options.best = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "--csv") == 0)
+      options.csvPath = argv[arg + 1];
+    else
+      isValid = false;
+  }
+  return isValid && (options.cycles > 0);
+}
+
+// Every combination of the swept settings
+static void buildConfigs() {
+  for (int gait = 0; gait < NUMBER_OF_GAITS; gait++) {
+    if ((options.gait >= 0) && (gait != options.gait))
+      continue;
+    // Steps along the ranges are counted so that float steps don't miss the end of a range
+    for (int amplitude = 0; options.amplitude.min + amplitude * options.amplitude.step <= options.amplitude.max + 1e-3; amplitude++)
+      for (int periodHalf = 0; options.periodHalf.min + periodHalf * options.periodHalf.step <= options.periodHalf.max + 1e-3; periodHalf++)
+        for (int drawBack = 0; options.drawBack.min + drawBack * options.drawBack.step <= options.drawBack.max + 1e-3; drawBack++)
+          for (int tick = 0; options.tick.min + tick * options.tick.step <= options.tick.max + 1e-3; tick++) {
+            Config config = { (GaitType)gait,
+                              options.amplitude.min + amplitude * options.amplitude.step,
+                              options.periodHalf.min + periodHalf * options.periodHalf.step,
+                              options.drawBack.min + drawBack * options.drawBack.step,
+                              options.tick.min + tick * options.tick.step };
+            configs.push_back(config);
+          }
+  }
+}
+
+static void printConfig(const Config *config, const Result *result) {
+  printf("  %-5s %6.1f %6.1f %6.2f %5.1f | %7.1f %8.0f %10.0f | %7lu %7lu %8.0f | %8.1f\n",
+    GAIT_NAMES[config->gaitType], config->amplitude, config->periodHalf, config->drawBackReduction, config->tickPeriod,
+    result->speed, result->peakVelocity, result->peakAcceleration, result->reachViolations,
+    result->ticksToStand, result->stopVelocity, result->nanoseconds / result->ticks);
+}
+
+
+int main(int argc, char **argv) {
+  if (!parseOptions(argc, argv)) {
+    fprintf(stderr, "usage: %s [--gait trot|pace|bound|walk|crawl|all] [--amplitude min:max:step] [--period-half min:max:step]\n"
+                    "       [--draw-back min:max:step] [--tick min:max:step] [--cycles count] [--max-velocity degrees/s]\n"
+                    "       [--threads count] [--best count] [--csv file]\n", argv[0]);
+    return 2;
+  }
+
+  if (options.threads == 0)
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+  FILE *csvFile = NULL;
+  if (options.csvPath != NULL) {
+    csvFile = fopen(options.csvPath, "w");
+    if (csvFile == NULL) {
+      perror(options.csvPath);
+      return 2;
+    }
+  }
+
+  buildConfigs();
+  results.assign(configs.size(), Result());
+
+  // Initialize one leg up front so that anything shared between legs (the workspace table) is built
+  // before the threads start
+  {
+    Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+    Kinematics kinematics;
+    kinematics.init(LEG_1, 0, 0, (SHOULDER_FOOT_MIN + SHOULDER_FOOT_MAX) / 2, motors);
+  }
+
+  std::vector<std::thread> threads;
+  Clock::time_point start = Clock::now();
+  for (unsigned thread = 0; thread < options.threads; thread++)
+    threads.push_back(std::thread(sweepThread));
+  for (unsigned thread = 0; thread < options.threads; thread++)
+    threads[thread].join();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  unsigned long ticks = 0;
+  double simulatedSeconds = 0;
+  std::vector<size_t> usable;
+  for (size_t run = 0; run < configs.size(); run++) {
+    ticks += results[run].ticks;
+    simulatedSeconds += results[run].ticks * configs[run].tickPeriod / 1000;
+    if ((results[run].reachViolations == 0) && (results[run].peakVelocity <= options.maxVelocity))
+      usable.push_back(run);
+  }
+
+  printf("%lu gait configurations (%lu ticks, %.0f s of walking) on %u threads in %.2f s, %.0fx real time\n",
+    (unsigned long)configs.size(), ticks, simulatedSeconds, options.threads, seconds, simulatedSeconds / seconds);
+  printf("%lu stay in reach with every motor under %.0f degrees/s while walking\n\n", (unsigned long)usable.size(), options.maxVelocity);
+
+  // The fastest walking of those first, then the gentlest on the motors
+  std::sort(usable.begin(), usable.end(), [](size_t a, size_t b) {
+    if (results[a].speed != results[b].speed)
+      return results[a].speed > results[b].speed;
+    return results[a].peakVelocity < results[b].peakVelocity;
+  });
+  if (usable.size() > options.best)
+    usable.resize(options.best);
+
+  if (!usable.empty()) {
+    printf("  %-5s %6s %6s %6s %5s | %7s %8s %10s | %7s %7s %8s | %8s\n", "gait", "amp", "period", "draw", "tick",
+      "mm/s", "deg/s", "deg/s^2", "reach", "stop", "deg/s", "ns/tick");
+    for (size_t best = 0; best < usable.size(); best++)
+      printConfig(&configs[usable[best]], &results[usable[best]]);
+  }
+
+  if (csvFile != NULL) {
+    fprintf(csvFile, "gait,amplitude,period_half,draw_back_reduction,tick_ms,speed_mm_s,peak_velocity_deg_s,"
+                     "peak_acceleration_deg_s2,reach_violations,ticks_to_stand,stop_velocity_deg_s,ns_per_tick\n");
+    for (size_t run = 0; run < configs.size(); run++) {
+      const Config *config = &configs[run];
+      const Result *result = &results[run];
+      fprintf(csvFile, "%s,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%lu,%lu,%.1f,%.1f\n", GAIT_NAMES[config->gaitType],
+        config->amplitude, config->periodHalf, config->drawBackReduction, config->tickPeriod, result->speed,
+        result->peakVelocity, result->peakAcceleration, result->reachViolations,
+        result->ticksToStand, result->stopVelocity, result->nanoseconds / result->ticks);
+    }
+    fclose(csvFile);
+  }
+
+  return 0;
+}
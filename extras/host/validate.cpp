@@ -0,0 +1,307 @@
+// validate.cpp
+// Sweeps the reachable workspace, solves every point with Kinematics::solveFootPosition (whichever backend
+// quadruped-config.h / DEFINES selects) and runs the angles back through the forward kinematics to see how
+// far off the foot ends up. The sweep is split across all of the host's cores. See README.md.
+//
+//   ./validate [--step mm] [--threads count] [--tolerance degrees] [--worst count] [--csv file]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Kinematics.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Regions: 3 bands of z, each split by whether the foot is inwards of the shoulder (y < 0, where
+// solveYMove() flips the sign of motor 1) or outwards
+#define Z_BANDS       3
+#define REGION_COUNT  (Z_BANDS * 2)
+
+typedef struct {
+  int16_t x;
+  int16_t y;      // Kinematics::setFootEndpoint coordinates, i.e. y = 0 under the shoulder
+  int16_t z;
+  int16_t angles[3];
+  float error;    // mm
+  float allowed;  // mm
+} Point;
+
+typedef struct {
+  unsigned long points;
+  unsigned long flagged;
+  double exactError;      // total round trip error of the unrounded solve (solveFootAngles)
+  double maxExactError;
+  double error;           // total round trip error of solveFootPosition
+  double maxError;
+  double nanoseconds;     // total solve time
+  double maxNanoseconds;
+} RegionResult;
+
+typedef struct {
+  RegionResult regions[REGION_COUNT];
+  std::vector<Point> worst;   // flagged points, worst first
+} SweepResult;
+
+typedef struct {
+  int16_t step;
+  unsigned threads;
+  float tolerance;
+  unsigned worst;
+  const char *csvPath;
+} Options;
+
+static Options options = { 2, 0, 1.0, 10, NULL };
+
+static std::atomic<int> nextSlice(0);
+static std::mutex csvMutex;
+static FILE *csvFile = NULL;
+static double clockOverhead = 0;
+
+
+static uint8_t regionOf(int16_t inputY, int16_t inputZ) {
+  uint8_t band = ((int32_t)inputZ * Z_BANDS) / (SHOULDER_FOOT_MAX + 1);
+  return (band * 2) + ((inputY < 0) ? 0 : 1);
+}
+
+static void printRegionName(uint8_t region) {
+  int16_t bandMin = ((region / 2) * (SHOULDER_FOOT_MAX + 1)) / Z_BANDS;
+  int16_t bandMax = (((region / 2) + 1) * (SHOULDER_FOOT_MAX + 1)) / Z_BANDS - 1;
+  printf("  z %3d-%3d %-8s", bandMin, bandMax, (region % 2 == 0) ? "inwards" : "outwards");
+}
+
+static bool worseThan(const Point &a, const Point &b) {
+  return (a.error - a.allowed) > (b.error - b.allowed);
+}
+
+static float distance(float x, float y, float z) {
+  return sqrt((x * x) + (y * y) + (z * z));
+}
+
+/*!
+ *    @brief  Solves one x-axis slice of the sweep. Every point is solved and timed, then checked with
+ *            the forward kinematics. A point is flagged when its error is more than an error of
+ *            options.tolerance degrees on every motor could explain (found with the Jacobian).
+ */
+static void sweepSlice(Kinematics *kinematics, int16_t inputX, SweepResult *result, std::string *csv) {
+  for (int16_t inputY = -SHOULDER_FOOT_MAX; inputY <= SHOULDER_FOOT_MAX; inputY += options.step)
+    for (int16_t inputZ = options.step; inputZ <= SHOULDER_FOOT_MAX; inputZ += options.step) {
+      if (Kinematics::checkReachability(inputX, inputY, inputZ) != FOOT_REACHABLE)
+        continue;
+      int16_t legY = inputY + LIMB_1;
+
+      Point point = { inputX, inputY, inputZ, {0, 0, 0}, 0, 0 };
+
+      Clock::time_point start = Clock::now();
+      kinematics->solveFootPosition(inputX, legY, inputZ, &point.angles[0], &point.angles[1], &point.angles[2]);
+      double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count() - clockOverhead;
+      if (nanoseconds < 0)
+        nanoseconds = 0;
+
+      float footX, footY, footZ;
+      kinematics->solveForwardKinematics(point.angles[0], point.angles[1], point.angles[2], &footX, &footY, &footZ);
+      point.error = distance(footX - inputX, footY - legY, footZ - inputZ);
+
+      // The unrounded solve, so that rounding can be told apart from wrong angles
+      float exactAngles[3];
+      kinematics->solveFootAngles(inputX, legY, inputZ, &exactAngles[0], &exactAngles[1], &exactAngles[2]);
+      kinematics->solveForwardKinematics(exactAngles[0], exactAngles[1], exactAngles[2], &footX, &footY, &footZ);
+      float exactError = distance(footX - inputX, footY - legY, footZ - inputZ);
+
+      // How far the foot could be off if every angle was off by the tolerance
+      float jacobian[3][3];
+      kinematics->solveJacobian(exactAngles[0], exactAngles[1], exactAngles[2], jacobian);
+      for (uint8_t motor = 0; motor < 3; motor++)
+        point.allowed += distance(jacobian[0][motor], jacobian[1][motor], jacobian[2][motor]);
+      point.allowed *= options.tolerance * DEG_TO_RAD;
+
+      // NaN errors count as wrong too
+      bool isFlagged = !(point.error <= point.allowed);
+      if (isnan(point.error))
+        point.error = INFINITY;
+      if (isnan(exactError))
+        exactError = INFINITY;
+
+      RegionResult *region = &result->regions[regionOf(inputY, inputZ)];
+      region->points++;
+      region->exactError += exactError;
+      region->maxExactError = std::max(region->maxExactError, (double)exactError);
+      region->error += point.error;
+      region->maxError = std::max(region->maxError, (double)point.error);
+      region->nanoseconds += nanoseconds;
+      region->maxNanoseconds = std::max(region->maxNanoseconds, nanoseconds);
+
+      if (isFlagged) {
+        region->flagged++;
+        result->worst.push_back(point);
+        if (result->worst.size() > 4 * options.worst) {
+          std::sort(result->worst.begin(), result->worst.end(), worseThan);
+          result->worst.resize(options.worst);
+        }
+      }
+
+      if (csv != NULL) {
+        char line[96];
+        snprintf(line, sizeof(line), "%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.1f\n", inputX, inputY, inputZ,
+          point.angles[0], point.angles[1], point.angles[2], point.error, exactError, nanoseconds);
+        csv->append(line);
+      }
+    }
+}
+
+static void sweepThread(SweepResult *result) {
+  Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+  Kinematics kinematics;
+  kinematics.init(LEG_1, 0, 0, (SHOULDER_FOOT_MIN + SHOULDER_FOOT_MAX) / 2, motors);
+
+  const int slices = (2 * SHOULDER_FOOT_MAX) / options.step + 1;
+  std::string csv;
+
+  for (int slice = nextSlice++; slice < slices; slice = nextSlice++) {
+    sweepSlice(&kinematics, -SHOULDER_FOOT_MAX + slice * options.step, result, (csvFile != NULL) ? &csv : NULL);
+
+    if (csvFile != NULL) {
+      std::lock_guard<std::mutex> lock(csvMutex);
+      fwrite(csv.data(), 1, csv.size(), csvFile);
+      csv.clear();
+    }
+  }
+}
+
+static bool parseOptions(int argc, char **argv) {
+  for (int arg = 1; arg + 1 < argc; arg += 2) {
+    if (strcmp(argv[arg], "--step") == 0)
+      options.step = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "--threads") == 0)
+      options.threads = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "--tolerance") == 0)
+      options.tolerance = atof(argv[arg + 1]);
+    else if (strcmp(argv[arg], "--worst") == 0)
+      options.worst = atoi(argv[arg + 1]);
+    else if (strcmp(argv[arg], "--csv") == 0)
+      options.csvPath = argv[arg + 1];
+    else
+      return false;
+  }
+  return (argc % 2 == 1) && (options.step > 0) && (options.worst > 0);
+}
+
+
+int main(int argc, char **argv) {
+  if (!parseOptions(argc, argv)) {
+    fprintf(stderr, "usage: %s [--step mm] [--threads count] [--tolerance degrees] [--worst count] [--csv file]\n", argv[0]);
+    return 2;
+  }
+
+  if (options.threads == 0)
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+  if (options.csvPath != NULL) {
+    csvFile = fopen(options.csvPath, "w");
+    if (csvFile == NULL) {
+      perror(options.csvPath);
+      return 2;
+    }
+    fprintf(csvFile, "x,y,z,angle1,angle2,angle3,error_mm,unrounded_error_mm,solve_ns\n");
+  }
+
+  // Per point timing includes reading the clock, so measure that and take it off
+  volatile double sink = 0;
+  Clock::time_point overheadStart = Clock::now();
+  for (int sample = 0; sample < 100000; sample++) {
+    Clock::time_point sampleStart = Clock::now();
+    sink = sink + std::chrono::duration<double, std::nano>(Clock::now() - sampleStart).count();
+  }
+  clockOverhead = std::chrono::duration<double, std::nano>(Clock::now() - overheadStart).count() / 100000 / 2;
+
+  // Initialize one leg up front so that anything shared between legs (the workspace table) is built
+  // before the threads start
+  {
+    Motor motors[ROBOT_LEG_COUNT * MOTORS_PER_LEG] = {};
+    Kinematics kinematics;
+    kinematics.init(LEG_1, 0, 0, (SHOULDER_FOOT_MIN + SHOULDER_FOOT_MAX) / 2, motors);
+  }
+
+  std::vector<SweepResult> results(options.threads);
+  std::vector<std::thread> threads;
+
+  Clock::time_point start = Clock::now();
+  for (unsigned thread = 0; thread < options.threads; thread++)
+    threads.push_back(std::thread(sweepThread, &results[thread]));
+  for (unsigned thread = 0; thread < options.threads; thread++)
+    threads[thread].join();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  if (csvFile != NULL)
+    fclose(csvFile);
+
+  // Merge the threads' results
+  SweepResult total = {};
+  for (unsigned thread = 0; thread < options.threads; thread++) {
+    for (uint8_t region = 0; region < REGION_COUNT; region++) {
+      RegionResult *from = &results[thread].regions[region];
+      RegionResult *to = &total.regions[region];
+      to->points += from->points;
+      to->flagged += from->flagged;
+      to->exactError += from->exactError;
+      to->maxExactError = std::max(to->maxExactError, from->maxExactError);
+      to->error += from->error;
+      to->maxError = std::max(to->maxError, from->maxError);
+      to->nanoseconds += from->nanoseconds;
+      to->maxNanoseconds = std::max(to->maxNanoseconds, from->maxNanoseconds);
+    }
+    total.worst.insert(total.worst.end(), results[thread].worst.begin(), results[thread].worst.end());
+  }
+  std::sort(total.worst.begin(), total.worst.end(), worseThan);
+  if (total.worst.size() > options.worst)
+    total.worst.resize(options.worst);
+
+  unsigned long points = 0;
+  unsigned long flagged = 0;
+  for (uint8_t region = 0; region < REGION_COUNT; region++) {
+    points += total.regions[region].points;
+    flagged += total.regions[region].flagged;
+  }
+
+  printf("Kinematics backend: ");
+#if defined(FIXED_POINT_KINEMATICS)
+  printf("fixed point");
+#else
+  printf("float");
+#endif
+#if defined(WORKSPACE_ANGLE_TABLE)
+  printf(" + workspace table");
+#endif
+  printf("\n");
+  printf("%lu reachable points (%d mm grid) on %u threads in %.2f s\n", points, options.step, options.threads, seconds);
+  printf("%lu points off by more than %.2f degrees per motor\n\n", flagged, options.tolerance);
+
+  printf("  %-19s %9s %9s | %-15s | %-15s | %s\n", "region", "points", "flagged", "error mm", "unrounded mm", "solve ns");
+  printf("  %-19s %9s %9s | %7s %7s | %7s %7s | %7s %7s\n", "", "", "", "mean", "max", "mean", "max", "mean", "max");
+  for (uint8_t region = 0; region < REGION_COUNT; region++) {
+    RegionResult *result = &total.regions[region];
+    if (result->points == 0)
+      continue;
+    printRegionName(region);
+    printf(" %9lu %9lu | %7.3f %7.3f | %7.3f %7.3f | %7.1f %7.1f\n", result->points, result->flagged,
+      result->error / result->points, result->maxError, result->exactError / result->points, result->maxExactError,
+      result->nanoseconds / result->points, result->maxNanoseconds);
+  }
+
+  if (!total.worst.empty()) {
+    printf("\nworst points (setFootEndpoint coordinates):\n");
+    printf("  %5s %5s %5s | %6s %6s %6s | %9s %9s\n", "x", "y", "z", "m1", "m2", "m3", "error mm", "allowed");
+    for (size_t worst = 0; worst < total.worst.size(); worst++) {
+      Point *point = &total.worst[worst];
+      printf("  %5d %5d %5d | %6d %6d %6d | %9.3f %9.3f\n", point->x, point->y, point->z,
+        point->angles[0], point->angles[1], point->angles[2], point->error, point->allowed);
+    }
+  }
+
+  return (flagged == 0) ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include "CommandQueue.h"
+
+// Keeps the command copy and the index update in order. A compiler barrier is enough on single core AVRs;
+// everything else gets a full memory barrier in case the two sides run on different cores.
+#if defined(__AVR__)
+  #define COMMAND_QUEUE_BARRIER()   asm volatile("" ::: "memory")
+#else
+  #define COMMAND_QUEUE_BARRIER()   __sync_synchronize()
+#endif
+
+#define COMMAND_QUEUE_MASK  (COMMAND_QUEUE_SIZE - 1)
+
+CommandQueue::CommandQueue(void) {
+  reset();
+};
+
+/*!
+ *    @brief  Empties the queue and clears the counters. Neither side may be using the queue at the time.
+ */
+void CommandQueue::reset() {
+  _head = 0;
+  _tail = 0;
+  droppedCount = 0;
+  maxLatency = 0;
+}
+
+/*!
+ *    @brief  Adds a command to the queue. Safe to call from an interrupt.
+ *    @param  command The command; it is copied
+ *    @return false if the queue was full and the command was dropped
+ */
+bool CommandQueue::push(const MotionCommand *command) {
+  uint8_t head = _head;
+  uint8_t next = (head + 1) & COMMAND_QUEUE_MASK;
+
+  if (next == _tail) {
+    droppedCount++;
+    return false;
+  }
+
+  _commands[head] = *command;
+
+  // the command has to be in the slot before the consumer can see it
+  COMMAND_QUEUE_BARRIER();
+  _head = next;
+  return true;
+}
+
+/*!
+ *    @brief  Pushes a velocity (control coordinate) command stamped with the current time
+ *    @param  controlCoordinateX x direction of the controller (joystick) coordinate
+ *    @param  controlCoordinateY y direction of the controller (joystick) coordinate
+ *    @return false if the queue was full
+ */
+bool CommandQueue::pushVelocity(int16_t controlCoordinateX, int16_t controlCoordinateY) {
+  MotionCommand command;
+  command.type = COMMAND_VELOCITY;
+  command.timestamp = millis();
+  command.velocity.x = controlCoordinateX;
+  command.velocity.y = controlCoordinateY;
+  return push(&command);
+}
+
+/*!
+ *    @brief  Pushes a gait change stamped with the current time
+ *    @param  gait The gait to switch to
+ *    @return false if the queue was full
+ */
+bool CommandQueue::pushGait(GaitType gait) {
+  MotionCommand command;
+  command.type = COMMAND_GAIT;
+  command.timestamp = millis();
+  command.gait = gait;
+  return push(&command);
+}
+
+/*!
+ *    @brief  Pushes a stand command stamped with the current time
+ *    @return false if the queue was full
+ */
+bool CommandQueue::pushStand() {
+  MotionCommand command;
+  command.type = COMMAND_STAND;
+  command.timestamp = millis();
+  return push(&command);
+}
+
+/*!
+ *    @brief  Takes the oldest command out of the queue
+ *    @param  command Output for the command
+ *    @return false if there were no commands
+ */
+bool CommandQueue::pop(MotionCommand *command) {
+  uint8_t tail = _tail;
+
+  if (tail == _head)
+    return false;
+
+  // the slot can't be read before the index that says it's full
+  COMMAND_QUEUE_BARRIER();
+  *command = _commands[tail];
+
+  // and the producer can't have the slot back until it's been read
+  COMMAND_QUEUE_BARRIER();
+  _tail = (tail + 1) & COMMAND_QUEUE_MASK;
+
+  unsigned long latency = millis() - command->timestamp;
+  if (latency > maxLatency)
+    maxLatency = latency;
+
+  return true;
+}
+
+/*!
+ *    @return true if there are no commands waiting
+ */
+bool CommandQueue::isEmpty() {
+  return _tail == _head;
+}
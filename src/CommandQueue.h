@@ -0,0 +1,63 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include "StepPlanner.h"
+#include "quadruped-config.h"
+
+#if (COMMAND_QUEUE_SIZE < 2) || (COMMAND_QUEUE_SIZE > 128) || ((COMMAND_QUEUE_SIZE & (COMMAND_QUEUE_SIZE - 1)) != 0)
+#error COMMAND_QUEUE_SIZE has to be a power of 2 from 2 to 128
+#endif
+
+typedef enum {
+  COMMAND_VELOCITY = 0,   // walk with this control coordinate (the same as what walk() takes)
+  COMMAND_GAIT,           // switch to another gait
+  COMMAND_STAND           // stop walking; the same as a velocity of 0, 0
+} CommandType;
+
+typedef struct {
+  CommandType type;
+  unsigned long timestamp;    // millis() when it was pushed
+  union {
+    struct {
+      int16_t x;
+      int16_t y;
+    } velocity;
+    GaitType gait;
+  };
+} MotionCommand;
+
+// Single producer, single consumer ring buffer of motion commands. One side (i.e. a radio interrupt) pushes
+// and the other (Quadruped, at the start of every control tick) pops; neither side ever waits or locks, and
+// there is no heap allocation. Only one of each is allowed; two interrupts pushing needs a lock around push().
+class CommandQueue {
+
+  public:
+    CommandQueue();
+
+    void reset();
+
+    // Producer side; false (and the command is dropped) if the queue is full
+    bool push(const MotionCommand *command);
+    bool pushVelocity(int16_t controlCoordinateX, int16_t controlCoordinateY);
+    bool pushGait(GaitType gait);
+    bool pushStand();
+
+    // Consumer side; false if the queue is empty
+    bool pop(MotionCommand *command);
+
+    bool isEmpty();
+
+    volatile uint16_t droppedCount;   // commands that didn't fit (written by the producer)
+    unsigned long maxLatency;         // most time (ms) from push() to pop() (written by the consumer)
+
+  private:
+    MotionCommand _commands[COMMAND_QUEUE_SIZE];
+
+    // Each index is only written by one side. They are single bytes so that reading one can't be torn.
+    volatile uint8_t _head;   // next slot to push into (producer)
+    volatile uint8_t _tail;   // next slot to pop from (consumer)
+
+};
+
+#endif
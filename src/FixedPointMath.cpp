@@ -0,0 +1,102 @@
+#include "FixedPointMath.h"
+
+// Number of linear segments in the arctangent table (over a ratio of 0 to 1)
+#define ATAN_TABLE_BITS     5
+#define ATAN_RATIO_SHIFT    16
+
+// atan(i / 32) in Q8 degrees for i = 0...32. Linear interpolation between entries
+// is accurate to well under 0.01 degrees.
+static const uint16_t ATAN_TABLE[(1 << ATAN_TABLE_BITS) + 1] PROGMEM = {
+  0, 458, 916, 1371, 1824, 2273, 2719, 3159, 3593, 4021, 4443,
+  4856, 5262, 5660, 6049, 6429, 6801, 7163, 7516, 7859, 8193,
+  8518, 8834, 9141, 9439, 9728, 10008, 10280, 10544, 10799, 11047,
+  11287, 11520
+};
+
+
+/*!
+ *    @brief  Integer square root. This is the standard bit by bit method, so it only needs shifts and adds
+ *    @param  value The number to take the square root of
+ *    @returns The square root of value, rounded down
+ */
+uint32_t fixedSqrt(uint32_t value) {
+  uint32_t root = 0;
+  uint32_t bit = (uint32_t)1 << 30;
+
+  while (bit > value)
+    bit >>= 2;
+
+  while (bit != 0) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+      root >>= 1;
+    bit >>= 2;
+  }
+  return root;
+}
+
+
+/*!
+ *    @brief  Arctangent of y/x using the lookup table. Only the first quadrant is
+ *            handled since all of the kinematics triangles have positive sides.
+ *    @param  y The opposite side of the triangle
+ *    @param  x The adjacent side of the triangle
+ *    @returns The angle in degrees (Q8), 0 to 90
+ */
+int32_t fixedAtan2Degrees(uint32_t y, uint32_t x) {
+  if (y == 0)
+    return 0;
+  if (x == 0)
+    return FIXED_ANGLE_90;
+
+  // Keep the ratio within 0-1 by using atan(y/x) = 90 - atan(x/y)
+  bool swapped = (y > x);
+  uint32_t ratio = swapped ? ((x << ATAN_RATIO_SHIFT) / y) : ((y << ATAN_RATIO_SHIFT) / x);
+
+  uint16_t index = ratio >> (ATAN_RATIO_SHIFT - ATAN_TABLE_BITS);
+  uint32_t fraction = ratio & (((uint32_t)1 << (ATAN_RATIO_SHIFT - ATAN_TABLE_BITS)) - 1);
+
+  int32_t angle = pgm_read_word(&ATAN_TABLE[index]);
+  if (fraction != 0) {
+    int32_t next = pgm_read_word(&ATAN_TABLE[index + 1]);
+    angle += ((next - angle) * (int32_t)fraction) >> (ATAN_RATIO_SHIFT - ATAN_TABLE_BITS);
+  }
+
+  return swapped ? (FIXED_ANGLE_90 - angle) : angle;
+}
+
+
+/*!
+ *    @brief  Rounds a Q8 angle to the nearest degree (halves away from zero)
+ *    @param  angle Angle in Q8 degrees
+ *    @returns The angle in whole degrees
+ */
+int16_t fixedAngleToDegrees(int32_t angle) {
+  if (angle < 0)
+    return -(int16_t)((-angle + (FIXED_ANGLE_ONE / 2)) >> FIXED_ANGLE_SHIFT);
+  return (int16_t)((angle + (FIXED_ANGLE_ONE / 2)) >> FIXED_ANGLE_SHIFT);
+}
+
+
+/*!
+ *    @brief  Approximate 1 / sqrt(value) from the bits of the float and two Newton steps, so that there is no
+ *            divide or sqrt. The result is within about 5 parts per million.
+ *    @param  value A positive number
+ *    @returns 1 / sqrt(value)
+ */
+float fastInverseSqrt(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bits = 0x5F3759DF - (bits >> 1);
+
+  float estimate;
+  memcpy(&estimate, &bits, sizeof(estimate));
+
+  float halfValue = 0.5f * value;
+  estimate = estimate * (1.5f - (halfValue * estimate * estimate));
+  estimate = estimate * (1.5f - (halfValue * estimate * estimate));
+  return estimate;
+}
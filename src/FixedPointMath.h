@@ -0,0 +1,30 @@
+#ifndef FIXED_POINT_MATH_H
+#define FIXED_POINT_MATH_H
+
+#include <Arduino.h>
+
+// Angles are handled in degrees as Q8 fixed point numbers i.e. 1 degree == 256
+#define FIXED_ANGLE_SHIFT   8
+#define FIXED_ANGLE_ONE     ((int32_t)1 << FIXED_ANGLE_SHIFT)
+#define FIXED_ANGLE_90      (90 * FIXED_ANGLE_ONE)
+#define FIXED_ANGLE_180     (180 * FIXED_ANGLE_ONE)
+
+// integer square root (rounded down)
+uint32_t fixedSqrt(uint32_t value);
+
+// arctangent of y/x in the first quadrant (y, x >= 0) as a Q8 angle in degrees
+int32_t fixedAtan2Degrees(uint32_t y, uint32_t x);
+
+// rounds a Q8 angle to the nearest whole degree
+int16_t fixedAngleToDegrees(int32_t angle);
+
+// 1 / sqrt(value) without a divide or sqrt, to about 5 parts per million
+float fastInverseSqrt(float value);
+
+// Single precision versions of Arduino's PI, DEG_TO_RAD and RAD_TO_DEG. Those are doubles, which turns the
+// float math around them into double math (done in software on boards with a single precision FPU).
+#define PI_F          3.14159265f
+#define DEG_TO_RAD_F  0.0174532925f
+#define RAD_TO_DEG_F  57.2957795f
+
+#endif
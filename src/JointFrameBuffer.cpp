@@ -0,0 +1,88 @@
+#include "JointFrameBuffer.h"
+
+#define JOINT_FRAME_INDEX   0x03
+#define JOINT_FRAME_FRESH   0x04    // set in _latest when the newest frame hasn't been read yet
+
+// Swaps the value of _latest. Single core AVRs only need the interrupts off for it (the buffer could be used
+// between an interrupt and the main loop there); everything else uses the compiler's atomics.
+static inline uint8_t exchangeLatest(uint8_t *latest, uint8_t value) {
+#if defined(__AVR__)
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t previous = *latest;
+  *latest = value;
+  SREG = oldSREG;
+  return previous;
+#else
+  return __atomic_exchange_n(latest, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static inline uint8_t loadLatest(uint8_t *latest) {
+#if defined(__AVR__)
+  return *(volatile uint8_t *)latest;
+#else
+  return __atomic_load_n(latest, __ATOMIC_ACQUIRE);
+#endif
+}
+
+JointFrameBuffer::JointFrameBuffer(void) {
+  reset();
+};
+
+/*!
+ *    @brief  Forgets all frames. Neither side may be using the buffer at the time.
+ */
+void JointFrameBuffer::reset() {
+  _writeIndex = 0;
+  _latest = 1;
+  _readIndex = 2;
+  _sequence = 0;
+  _lastRead = 0;
+
+  readCount = 0;
+  skippedCount = 0;
+  maxAge = 0;
+}
+
+/*!
+ *    @return The frame that the writer can fill in. It stays the same until publish() is called.
+ */
+JointFrame * JointFrameBuffer::writeFrame() {
+  return &_frames[_writeIndex];
+}
+
+/*!
+ *    @brief  Makes the frame from writeFrame() the newest one and gives the writer another to fill in
+ */
+void JointFrameBuffer::publish() {
+  JointFrame *frame = &_frames[_writeIndex];
+  frame->sequence = ++_sequence;
+  frame->timestamp = micros();
+
+  // Release: the frame is complete before the reader can swap it in
+  uint8_t previous = exchangeLatest(&_latest, _writeIndex | JOINT_FRAME_FRESH);
+  _writeIndex = previous & JOINT_FRAME_INDEX;
+}
+
+/*!
+ *    @return The newest frame (it stays valid until the next call), or NULL if there isn't a new one
+ */
+const JointFrame * JointFrameBuffer::readFrame() {
+  if (!(loadLatest(&_latest) & JOINT_FRAME_FRESH))
+    return NULL;
+
+  uint8_t previous = exchangeLatest(&_latest, _readIndex);
+  _readIndex = previous & JOINT_FRAME_INDEX;
+
+  const JointFrame *frame = &_frames[_readIndex];
+  readCount++;
+  skippedCount += frame->sequence - _lastRead - 1;
+  _lastRead = frame->sequence;
+
+  unsigned long age = micros() - frame->timestamp;
+  if (age > maxAge)
+    maxAge = age;
+
+  return frame;
+}
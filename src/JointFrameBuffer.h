@@ -0,0 +1,51 @@
+#ifndef JOINT_FRAME_BUFFER_H
+#define JOINT_FRAME_BUFFER_H
+
+#include <Arduino.h>
+#include "quadruped-config.h"
+
+#define JOINT_FRAME_ANGLES  (ROBOT_LEG_COUNT * MOTORS_PER_LEG)
+
+// One set of motor angles from the control loop
+typedef struct {
+  uint32_t sequence;        // counts up by one for every frame published
+  unsigned long timestamp;  // micros() when it was published
+  int16_t angles[JOINT_FRAME_ANGLES];   // the motor angleDegrees in motor list order
+} JointFrame;
+
+// Passes joint frames from one core to another without locks. There are three frames: the writer fills one,
+// the reader holds one, and the third is the newest finished frame. Publishing and reading each swap a frame
+// with the newest one in a single atomic exchange, so neither side ever waits and the reader always gets the
+// latest complete frame (frames that are published faster than they are read are skipped).
+// One writer and one reader only.
+class JointFrameBuffer {
+
+  public:
+    JointFrameBuffer();
+
+    void reset();
+
+    // Writer side: fill in the angles of writeFrame() then publish() it
+    JointFrame * writeFrame();
+    void publish();
+
+    // Reader side: the newest published frame, or NULL if nothing new has been published since the last call
+    const JointFrame * readFrame();
+
+    // Reader side counters
+    uint32_t readCount;       // frames handed out by readFrame()
+    uint32_t skippedCount;    // frames that were replaced by a newer one before they were read
+    unsigned long maxAge;     // most time (us) between a frame being published and read
+
+  private:
+    JointFrame _frames[3];
+
+    uint8_t _writeIndex;          // only used by the writer
+    uint8_t _readIndex;           // only used by the reader
+    uint8_t _latest;              // index of the newest finished frame, plus JOINT_FRAME_FRESH if it hasn't been read
+    uint32_t _sequence;           // the writer's frame counter
+    uint32_t _lastRead;           // sequence of the frame the reader has
+
+};
+
+#endif
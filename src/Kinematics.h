@@ -9,9 +9,14 @@
 #include <Arduino.h>
 
 #include "quadruped-config.h"
+#include "RobotGeometry.h"
 
 #include <Ramp.h>
 
+#if defined(WORKSPACE_ANGLE_TABLE)
+#include "WorkspaceTable.h"
+#endif
+
 typedef struct {
   uint8_t controlPin;
 
@@ -30,24 +35,95 @@ typedef struct {
                                 // sure that the angle is correct relative to the motor's zero.
 } Motor;
 
+// The last foot position that a leg was solved for. Used to skip solving the same position twice.
+typedef struct {
+  int16_t x;
+  int16_t y;
+  int16_t z;
+  bool isValid;
+} SolvedPosition;
+
+// The joint angles of a leg along with their sines and cosines. The differential solve (DIFFERENTIAL_KINEMATICS)
+// keeps these up to date by rotating them a little at a time, so it doesn't need to call sin() or cos().
+typedef struct {
+  float angle1;           // radians
+  float angle2;
+  float angle3;
+  float sin1, cos1;       // motor 1 angle
+  float sin3, cos3;       // motor 3 angle
+  float sinLeg, cosLeg;   // angle of the shoulder-foot line on the x-z plane: (180 - angle3)/2 - angle2
+  bool isValid;
+} JointState;
+
+// Where a motor is on its way to its angle when the dynamic position is moved in joint space (see
+// updateDynamicFootPosition()); Q16 degrees and Q16 degrees per millisecond
+typedef struct {
+  int32_t position;
+  int32_t velocity;
+} JointMotion;
 
-class Kinematics {
+
+// Solves the legs of a robot with the limbs of Geometry (a RobotGeometry), which are all compile time
+// constants. Use Kinematics for the robot in quadruped-config.h; for another robot include KinematicsImpl.h
+// and use BasicKinematics<RobotGeometry<...> >. Different geometries can be used in the same program.
+template <class Geometry>
+class BasicKinematics {
   
   private:
 
-    LegID _legID;
-    
+#if defined(FIXED_POINT_KINEMATICS)
+    static_assert(Geometry::fixedKneeSidesProduct <= 65535, "FIXED_POINT_KINEMATICS only supports limbs where 2 * LIMB_2 * LIMB_3 fits in 16 bits");
+#endif
+
     uint16_t _indexOfMotor(LegID leg, MotorID motor);
 
+    bool _checkSolvedPosition(SolvedPosition *solved, int16_t inputX, int16_t inputY, int16_t inputZ, uint8_t tolerance);
+
+    static Reachability _reachabilityOf(int32_t inputX, int32_t inputY, int32_t inputZ);
+
+    SolvedPosition _endpointSolved;   // last input to setFootEndpoint() that was solved
+
+#if defined(CARTESIAN_DYNAMIC_INTERPOLATION)
     rampInt dynamicX;
     rampInt dynamicY;
     rampInt dynamicZ;
 
-    Motor * _motors;  // list of ALL robot motors
+    SolvedPosition _dynamicSolved;    // last interpolated position solved by updateDynamicFootPosition()
+#else
+    JointMotion _jointMotion[MOTORS_PER_LEG];   // M1, M2, M3
+    unsigned long _lastDynamicUpdate;           // millis()
+
+    // moves one motor towards its angle for the time since the last update
+    void _stepJointMotion(JointMotion *motion, int16_t targetDegrees, uint16_t elapsed);
+#endif
+
+    void _setJointState(JointState *joints, float demandAngle1, float demandAngle2, float demandAngle3);
+
+    void _solveJointState(const JointState *joints, float *outputX, float *outputY, float *outputZ, float jacobian[3][3]);
+
+    bool _solveDampedLeastSquares(const float jacobian[3][3], float damping, const float delta[3], float angleDelta[3]);
+
+#if defined(DIFFERENTIAL_KINEMATICS)
+    JointState _trackedJoints;   // the angles that trackFootPosition() last moved the foot to
+
+    // moves _trackedJoints to the foot position with the full solve
+    void _resetTrackedJoints(int16_t inputX, int16_t inputY, int16_t inputZ);
+
+    // one differential step towards the foot position; false if it should be solved from scratch instead
+    bool _stepTrackedJoints(int16_t inputX, int16_t inputY, int16_t inputZ);
+
+    float _trackingDamping(const JointState *joints);
+#endif
+
+#if defined(WORKSPACE_ANGLE_TABLE)
+    static WorkspaceTable _workspaceTable;   // shared by all legs since the robot is symmetric
+#endif
+
+    Motor * _motors;  // this leg's motors (M1, M2, M3) in the list of ALL robot motors; index with [motor - 1]
 
   public:
   
-    Kinematics();
+    BasicKinematics();
 
     void init(LegID legID, int16_t inputX, int16_t inputY, int16_t inputZ, Motor legMotors[]);
 
@@ -60,15 +136,42 @@ class Kinematics {
     // calculates M1 angle offset to achieve y-axis movement
     void solveYMove(int16_t inputY, int16_t inputZ, float *demandAngle1, float *yPlaneZOutput);
 
+    // uses all positioning functions to find the (unrounded) angles that place the foot in 3d space
+    void solveFootAngles(int16_t inputX, int16_t inputY, int16_t inputZ, float *demandAngle1, float *demandAngle2, float *demandAngle3);
+
+    // integer test of whether a foot position (setFootEndpoint() coordinates) can be solved, without solving it;
+    // optionally finds a reachable position close to it
+    static Reachability checkReachability(int16_t inputX, int16_t inputY, int16_t inputZ, int16_t *nearestX = NULL, int16_t *nearestY = NULL, int16_t *nearestZ = NULL);
+
     // general kinematics function; uses all positioning functions to place foot in 3d space
     void solveFootPosition(int16_t inputX, int16_t inputY, int16_t inputZ, int16_t *motor1AngleP, int16_t *motor2AngleP, int16_t *motor3AngleP);
 
+    // forward kinematics: the opposite of solveFootAngles(); finds where the foot is for a set of motor angles
+    void solveForwardKinematics(float demandAngle1, float demandAngle2, float demandAngle3, float *outputX, float *outputY, float *outputZ);
+
+    // finds how the foot moves (mm per radian) for a small change in each motor angle (degrees)
+    void solveJacobian(float demandAngle1, float demandAngle2, float demandAngle3, float jacobian[3][3]);
+
+#if defined(DIFFERENTIAL_KINEMATICS)
+    // differential version of solveFootPosition; moves the angles that were solved last towards the new foot position
+    void trackFootPosition(int16_t inputX, int16_t inputY, int16_t inputZ, int16_t *motor1AngleP, int16_t *motor2AngleP, int16_t *motor3AngleP);
+
+    // motor speeds (degrees per second) that move the foot at the given velocity (mm per second) from where it was tracked to last
+    bool solveJointVelocities(float velocityX, float velocityY, float velocityZ, float *motor1Speed, float *motor2Speed, float *motor3Speed);
+#endif
+
     // This sets the foot endpoints for when you are updating the foot position dynamically. (Interpolating Foot position, not angle)
     void setFootEndpoint(int16_t inputX, int16_t inputY, int16_t inputZ);
 
-    // This solves for the dynamic foot position using the interpolated (dynamic) values. 
+    // This moves the dynamic motor angles (dynamicDegrees) towards the angles that were set last; call it every loop.
+    // In joint space by default, or by solving the interpolated foot position with CARTESIAN_DYNAMIC_INTERPOLATION.
     void updateDynamicFootPosition();
 
 };
 
+typedef BasicKinematics<DefaultGeometry> Kinematics;
+
+// Built once in Kinematics.cpp
+extern template class BasicKinematics<DefaultGeometry>;
+
 #endif
\ No newline at end of file
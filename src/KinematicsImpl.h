@@ -0,0 +1,1018 @@
+// KinematicsImpl.h
+// The member functions of BasicKinematics. Kinematics.cpp builds them for the robot in quadruped-config.h
+// (Kinematics); include this in one of your own files as well to build them for another RobotGeometry.
+
+
+#ifndef _KINEMATICS_IMPL_
+#define _KINEMATICS_IMPL_
+
+#include "Kinematics.h"
+
+#include <Arduino.h>
+
+#include "Profiler.h"
+#include "FixedPointMath.h"
+
+#if defined(FIXED_POINT_KINEMATICS)
+
+// Extra bits of precision (Q4) kept for the y-z plane length; alpha is sensitive to it
+#define FIXED_LENGTH_SHIFT  4
+
+#endif
+
+#if !defined(CARTESIAN_DYNAMIC_INTERPOLATION)
+
+// The joint space dynamic position is moved in Q16 degrees, with speeds per millisecond
+#define JOINT_MOTION_SHIFT          16
+#define JOINT_MOTION_ONE            ((int32_t)1 << JOINT_MOTION_SHIFT)
+#define JOINT_MOTION_MAX_SPEED      ((int32_t)(JOINT_MOTION_ONE / MAX_SPEED_INVERSE))
+#define JOINT_MOTION_ACCELERATION   ((int32_t)(((float)DYNAMIC_MAX_ACCELERATION * JOINT_MOTION_ONE) / 1000000))   // per ms^2
+
+// A longer gap between updates (i.e. the first one) is moved as if it was this long (ms), so it can't overflow
+#define JOINT_MOTION_MAX_ELAPSED    50
+
+static_assert(JOINT_MOTION_ACCELERATION > 0, "DYNAMIC_MAX_ACCELERATION is too small to be counted in Q16 degrees per ms^2");
+
+#endif
+
+
+/*!
+ *    @param  legID Leg number. Numbering follows the quadrants of a unit circle.
+ */
+template <class Geometry>
+BasicKinematics<Geometry>::BasicKinematics() {};
+
+#if defined(WORKSPACE_ANGLE_TABLE)
+template <class Geometry>
+WorkspaceTable BasicKinematics<Geometry>::_workspaceTable;
+#endif
+
+
+// *****************Private Functions*****************
+
+/*!
+ *    @brief  Returns the index of a motor in the motor list given
+ *            the leg it is in and the motor number of the leg 
+ *            you want.
+ *    @param  leg The leg that the motor is in. 
+ *    @param  motor The motor in the leg you are trying to access
+ *    @return The index of the motor
+ */
+template <class Geometry>
+uint16_t BasicKinematics<Geometry>::_indexOfMotor(LegID leg, MotorID motor) {
+  return ((leg - 1) * MOTORS_PER_LEG + motor) - 1;
+};
+
+
+/*!
+ *    @brief  Checks whether a foot position is within tolerance of the one that was solved last.
+ *            If it isn't, the position is remembered as the new solved one.
+ *    @param  solved The last solved position
+ *    @param  inputX x-axis coordinate
+ *    @param  inputY y-axis coordinate
+ *    @param  inputZ z-axis coordinate
+ *    @param  tolerance How far (mm) each axis can be from the solved position
+ *    @return true if the position has already been solved for
+ */
+template <class Geometry>
+bool BasicKinematics<Geometry>::_checkSolvedPosition(SolvedPosition *solved, int16_t inputX, int16_t inputY, int16_t inputZ, uint8_t tolerance) {
+  if (solved->isValid
+   && abs(inputX - solved->x) <= tolerance
+   && abs(inputY - solved->y) <= tolerance
+   && abs(inputZ - solved->z) <= tolerance)
+    return true;
+
+  solved->x = inputX;
+  solved->y = inputY;
+  solved->z = inputZ;
+  solved->isValid = true;
+  return false;
+};
+
+
+/*!
+ *    @brief  Integer squared distance test of whether a foot position can be solved
+ *    @param  inputX x-axis coordinate
+ *    @param  inputY y-axis coordinate, 0 on the motor 1 axis (like solveFootPosition())
+ *    @param  inputZ z-axis coordinate
+ *    @return FOOT_REACHABLE, or why it can't be solved
+ */
+template <class Geometry>
+Reachability BasicKinematics<Geometry>::_reachabilityOf(int32_t inputX, int32_t inputY, int32_t inputZ) {
+  uint32_t yzSquared = (uint32_t)(inputY * inputY) + (uint32_t)(inputZ * inputZ);
+  if (yzSquared < (uint32_t)Geometry::fixedLimb1Squared)
+    return FOOT_INSIDE_LIMB_1;
+
+  // The foot-shoulder length on the x-z plane, as solveYMove() and solveXMove() find it
+  uint32_t ftShldrSquared = (yzSquared - Geometry::fixedLimb1Squared) + (uint32_t)(inputX * inputX);
+  if (ftShldrSquared < (uint32_t)Geometry::shoulderFootMinSquared)
+    return FOOT_TOO_CLOSE;
+  if (ftShldrSquared > (uint32_t)Geometry::shoulderFootMaxSquared)
+    return FOOT_TOO_FAR;
+  return FOOT_REACHABLE;
+};
+
+
+/*!
+ *    @brief  Sets the joint angles and works out their sines and cosines.
+ *    @param  joints        The joint state to set
+ *    @param  demandAngle1  Motor 1 angle (degrees)
+ *    @param  demandAngle2  Motor 2 angle (degrees)
+ *    @param  demandAngle3  Motor 3 angle (degrees)
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::_setJointState(JointState *joints, float demandAngle1, float demandAngle2, float demandAngle3) {
+  joints->angle1 = demandAngle1 * DEG_TO_RAD_F;
+  joints->angle2 = demandAngle2 * DEG_TO_RAD_F;
+  joints->angle3 = demandAngle3 * DEG_TO_RAD_F;
+
+  float legAngle = ((PI_F - joints->angle3) * 0.5f) - joints->angle2;
+
+  joints->sin1 = sinf(joints->angle1);
+  joints->cos1 = cosf(joints->angle1);
+  joints->sin3 = sinf(joints->angle3);
+  joints->cos3 = cosf(joints->angle3);
+  joints->sinLeg = sinf(legAngle);
+  joints->cosLeg = cosf(legAngle);
+
+  joints->isValid = !(isnan(joints->angle1) || isnan(joints->angle2) || isnan(joints->angle3));
+};
+
+
+/*!
+ *    @brief  Forward kinematics: finds where the foot is for a set of joint angles, i.e. the reverse
+ *            of solveFootAngles(). Optionally also finds the Jacobian at those angles.
+ *    @param  joints    The joint angles
+ *    @param  outputX   x-axis coordinate of the foot (mm)
+ *    @param  outputY   y-axis coordinate of the foot (mm), with y = LIMB_1 under the shoulder like solveFootAngles()
+ *    @param  outputZ   z-axis coordinate of the foot (mm)
+ *    @param  jacobian  If it isn't NULL, jacobian[axis][motor] is set to how far the foot moves along the
+ *                      axis (mm) per radian of the motor
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::_solveJointState(const JointState *joints, float *outputX, float *outputY, float *outputZ, float jacobian[3][3]) {
+  // Law of Cosines for the foot-shoulder length, then split it into the x-axis and the z-axis on the y-z plane
+  float ftShldrLength = sqrtf(Geometry::kneeSidesSquared - (Geometry::kneeSidesProduct * joints->cos3));
+  float legX = ftShldrLength * joints->sinLeg;
+  float legZ = ftShldrLength * joints->cosLeg;    // yPlaneZOutput in solveYMove()
+
+  // Motor 1 rotates the leg and LIMB_1 on the y-z plane
+  *outputX = legX;
+  *outputY = (Geometry::limb1 * joints->cos1) + (legZ * joints->sin1);
+  *outputZ = (legZ * joints->cos1) - (Geometry::limb1 * joints->sin1);
+
+  if (jacobian == NULL)
+    return;
+
+  // Motor 2 only turns the leg on the x-z plane. Motor 3 changes the leg length and turns it by half its angle.
+  float lengthRate = (Geometry::limb2 * Geometry::limb3 * joints->sin3) / ftShldrLength;
+  float legZRate3 = (joints->cosLeg * lengthRate) + (legX / 2);
+
+  jacobian[0][0] = 0;
+  jacobian[0][1] = -legZ;
+  jacobian[0][2] = (joints->sinLeg * lengthRate) - (legZ / 2);
+
+  jacobian[1][0] = *outputZ;
+  jacobian[1][1] = joints->sin1 * legX;
+  jacobian[1][2] = joints->sin1 * legZRate3;
+
+  jacobian[2][0] = -*outputY;
+  jacobian[2][1] = joints->cos1 * legX;
+  jacobian[2][2] = joints->cos1 * legZRate3;
+};
+
+
+/*!
+ *    @brief  Damped least squares: finds the change in angles that best moves the foot by delta,
+ *            i.e. angleDelta = J^T * (J * J^T + damping * I)^-1 * delta
+ *    @param  jacobian    The Jacobian from _solveJointState()
+ *    @param  damping     The damping squared (mm^2). 0 is the plain inverse; more damping gives smaller,
+ *                        less accurate moves but stops the angles from jumping near a singularity.
+ *    @param  delta       How much the foot should move along each axis
+ *    @param  angleDelta  Output change for each motor angle
+ *    @return false if there is no solution
+ */
+template <class Geometry>
+bool BasicKinematics<Geometry>::_solveDampedLeastSquares(const float jacobian[3][3], float damping, const float delta[3], float angleDelta[3]) {
+  // J * J^T + damping * I is symmetric, so only 6 of the terms are needed
+  float product[3][3];
+  for (uint8_t row = 0; row < 3; row++) {
+    for (uint8_t column = row; column < 3; column++) {
+      product[row][column] = (jacobian[row][0] * jacobian[column][0])
+                           + (jacobian[row][1] * jacobian[column][1])
+                           + (jacobian[row][2] * jacobian[column][2]);
+    }
+    product[row][row] += damping;
+  }
+
+  // Cofactors (the inverse is also symmetric)
+  float inverse00 = (product[1][1] * product[2][2]) - (product[1][2] * product[1][2]);
+  float inverse01 = (product[0][2] * product[1][2]) - (product[0][1] * product[2][2]);
+  float inverse02 = (product[0][1] * product[1][2]) - (product[0][2] * product[1][1]);
+  float inverse11 = (product[0][0] * product[2][2]) - (product[0][2] * product[0][2]);
+  float inverse12 = (product[0][1] * product[0][2]) - (product[0][0] * product[1][2]);
+  float inverse22 = (product[0][0] * product[1][1]) - (product[0][1] * product[0][1]);
+
+  float determinant = (product[0][0] * inverse00) + (product[0][1] * inverse01) + (product[0][2] * inverse02);
+  if (!(determinant > 0))
+    return false;   // singular (J * J^T can't be negative)
+
+  float solved[3];
+  solved[0] = ((inverse00 * delta[0]) + (inverse01 * delta[1]) + (inverse02 * delta[2])) / determinant;
+  solved[1] = ((inverse01 * delta[0]) + (inverse11 * delta[1]) + (inverse12 * delta[2])) / determinant;
+  solved[2] = ((inverse02 * delta[0]) + (inverse12 * delta[1]) + (inverse22 * delta[2])) / determinant;
+
+  for (uint8_t motor = 0; motor < 3; motor++)
+    angleDelta[motor] = (jacobian[0][motor] * solved[0]) + (jacobian[1][motor] * solved[1]) + (jacobian[2][motor] * solved[2]);
+
+  return true;
+};
+
+#if defined(DIFFERENTIAL_KINEMATICS)
+
+/*!
+ *    @brief  Rotates a sine and cosine pair by a small angle without calling sin() or cos().
+ *            Uses the first terms of the Taylor series, which are very accurate for the few
+ *            degrees that a foot moves by between updates, and renormalizes the pair afterwards.
+ *    @param  sine    The sine to rotate
+ *    @param  cosine  The cosine to rotate
+ *    @param  angle   The angle to rotate by (radians)
+ */
+static inline void rotateSineCosine(float *sine, float *cosine, float angle) {
+  float angleSquared = angle * angle;
+  float sineDelta = angle * (1 - (angleSquared / 6));
+  float cosineDelta = 1 - (angleSquared / 2);
+
+  float rotatedSine = (*sine * cosineDelta) + (*cosine * sineDelta);
+  float rotatedCosine = (*cosine * cosineDelta) - (*sine * sineDelta);
+
+  // sine^2 + cosine^2 should be 1; one Newton step keeps the rounding errors from adding up
+  float normalize = (3 - ((rotatedSine * rotatedSine) + (rotatedCosine * rotatedCosine))) / 2;
+  *sine = rotatedSine * normalize;
+  *cosine = rotatedCosine * normalize;
+}
+
+
+/*!
+ *    @brief  Solves the foot position from scratch and starts tracking from there.
+ *    @param  inputX  x-axis coordinate
+ *    @param  inputY  y-axis coordinate
+ *    @param  inputZ  z-axis coordinate
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::_resetTrackedJoints(int16_t inputX, int16_t inputY, int16_t inputZ) {
+  float demandAngle1;
+  float demandAngle2;
+  float demandAngle3;
+
+  solveFootAngles(inputX, inputY, inputZ, &demandAngle1, &demandAngle2, &demandAngle3);
+  _setJointState(&_trackedJoints, demandAngle1, demandAngle2, demandAngle3);
+};
+
+
+/*!
+ *    @brief  How much the differential solve is damped. This ramps up from DIFFERENTIAL_IK_DAMPING_RANGE short
+ *            of the geometry's shoulderFootMax to DIFFERENTIAL_IK_DAMPING when the leg is straight, which is the singularity.
+ *    @param  joints  The joint angles
+ *    @return The damping squared (mm^2)
+ */
+template <class Geometry>
+float BasicKinematics<Geometry>::_trackingDamping(const JointState *joints) {
+  // Compare the squared foot-shoulder lengths so that no square root is needed
+  const float startSquared = (float)(Geometry::shoulderFootMax - DIFFERENTIAL_IK_DAMPING_RANGE) * (Geometry::shoulderFootMax - DIFFERENTIAL_IK_DAMPING_RANGE);
+  const float straightSquared = Geometry::straightSquared;
+
+  float ftShldrSquared = Geometry::kneeSidesSquared - (Geometry::kneeSidesProduct * joints->cos3);
+  if (ftShldrSquared <= startSquared)
+    return 0;
+
+  const float dampingLength = DIFFERENTIAL_IK_DAMPING;
+  float damping = dampingLength * dampingLength;
+  if (ftShldrSquared >= straightSquared)
+    return damping;
+
+  return damping * (ftShldrSquared - startSquared) / (straightSquared - startSquared);
+};
+
+
+/*!
+ *    @brief  Moves the tracked angles one damped least squares step towards the foot position and
+ *            checks how close that got.
+ *    @param  inputX  x-axis coordinate
+ *    @param  inputY  y-axis coordinate
+ *    @param  inputZ  z-axis coordinate
+ *    @return false if the foot moved too far or the step missed by more than DIFFERENTIAL_IK_MAX_ERROR
+ */
+template <class Geometry>
+bool BasicKinematics<Geometry>::_stepTrackedJoints(int16_t inputX, int16_t inputY, int16_t inputZ) {
+  float footX;
+  float footY;
+  float footZ;
+  float jacobian[3][3];
+
+  _solveJointState(&_trackedJoints, &footX, &footY, &footZ, jacobian);
+
+  float delta[3] = { inputX - footX, inputY - footY, inputZ - footZ };
+  for (uint8_t axis = 0; axis < 3; axis++) {
+    if (!(abs(delta[axis]) <= DIFFERENTIAL_IK_MAX_STEP))
+      return false;
+  }
+
+  float angleDelta[3];
+  if (!_solveDampedLeastSquares(jacobian, _trackingDamping(&_trackedJoints), delta, angleDelta))
+    return false;
+
+  _trackedJoints.angle1 += angleDelta[0];
+  _trackedJoints.angle2 += angleDelta[1];
+  _trackedJoints.angle3 += angleDelta[2];
+
+  rotateSineCosine(&_trackedJoints.sin1, &_trackedJoints.cos1, angleDelta[0]);
+  rotateSineCosine(&_trackedJoints.sin3, &_trackedJoints.cos3, angleDelta[2]);
+  rotateSineCosine(&_trackedJoints.sinLeg, &_trackedJoints.cosLeg, -angleDelta[1] - (angleDelta[2] / 2));
+
+  // How far off the step ended up
+  _solveJointState(&_trackedJoints, &footX, &footY, &footZ, NULL);
+
+  const float maxError = DIFFERENTIAL_IK_MAX_ERROR;
+  return (abs(inputX - footX) <= maxError)
+      && (abs(inputY - footY) <= maxError)
+      && (abs(inputZ - footZ) <= maxError);
+};
+
+#endif
+
+
+/*!
+ *    @brief  Initializes the motor angles given the default position. Also does setup
+ *    to integrate the external array of motors in the class.
+ *    @param  inputX startup x-axis coordinate
+ *    @param  inputY startup y-axis coordinate
+ *    @param  inputZ startup z-axis coordinate
+ *    @param  legMotors array of Motor variables for each motor
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::init(LegID legID, int16_t inputX, int16_t inputY, int16_t inputZ, Motor legMotors[]) {
+  // The motors for one leg are consecutive, so the index only needs to be found once
+  _motors = &legMotors[_indexOfMotor(legID, M1)];
+
+  // Set inputY = 0 to under the shoulder
+  inputY += Geometry::limb1;
+
+  // Solve for the initial foot position
+  solveFootPosition(inputX, inputY, inputZ, &_motors[M1 - 1].angleDegrees, &_motors[M2 - 1].angleDegrees, &_motors[M3 - 1].angleDegrees);
+
+  // Motor 1
+  _motors[M1 - 1].dynamicDegrees = _motors[M1 - 1].angleDegrees;
+  _motors[M1 - 1].previousDegrees = 360;    // 360 just needs to an angle that the motor can't be at... the motors can never achieve 360!
+
+  // Motor 2
+  _motors[M2 - 1].dynamicDegrees = _motors[M2 - 1].angleDegrees;
+  _motors[M2 - 1].previousDegrees = 360;    // 360 just needs to an angle that the motor can't be at... the motors can never achieve 360!
+
+  // Motor 3
+  _motors[M3 - 1].dynamicDegrees = _motors[M3 - 1].angleDegrees;
+  _motors[M3 - 1].previousDegrees = 360;    // 360 just needs to an angle that the motor can't be at... the motors can never achieve 360!
+
+#if defined(CARTESIAN_DYNAMIC_INTERPOLATION)
+  dynamicX.go(inputX);
+  dynamicY.go(inputY);
+  dynamicZ.go(inputZ);
+#else
+  for (uint8_t motor = 0; motor < MOTORS_PER_LEG; motor++) {
+    _jointMotion[motor].position = (int32_t)_motors[motor].angleDegrees * JOINT_MOTION_ONE;
+    _jointMotion[motor].velocity = 0;
+  }
+  _lastDynamicUpdate = millis();
+#endif
+
+  _endpointSolved.isValid = false;
+#if defined(CARTESIAN_DYNAMIC_INTERPOLATION)
+  _dynamicSolved.isValid = false;
+#endif
+
+#if defined(DIFFERENTIAL_KINEMATICS)
+  _trackedJoints.isValid = false;
+#endif
+
+#if defined(WORKSPACE_ANGLE_TABLE)
+  // The table is shared by all legs, so only the first leg to be initialized builds it
+  if (!_workspaceTable.isBuilt())
+    _workspaceTable.build(this);
+#endif
+}
+
+
+// *****************Public Functions*****************
+
+/*!
+ *    @brief  Checks whether a foot position can be solved, using only integer squared distances, so that
+ *            targets can be rejected (or moved) before paying for the solve. solveFootPosition() has no
+ *            answer for these: the angles are clamped or meaningless. Optionally finds a reachable position
+ *            close to the target. The workspace is the same all the way around the motor 1 axis, so that is
+ *            found on the same half plane through the axis, where the reachable positions are a ring.
+ *    @param  inputX x-axis coordinate
+ *    @param  inputY y-axis coordinate (0 under the shoulder, as for setFootEndpoint())
+ *    @param  inputZ z-axis coordinate
+ *    @param  nearestX Output for the x-axis coordinate of the reachable position, or NULL
+ *    @param  nearestY Output for its y-axis coordinate, or NULL
+ *    @param  nearestZ Output for its z-axis coordinate, or NULL
+ *    @return FOOT_REACHABLE, or why the position can't be solved
+ */
+template <class Geometry>
+Reachability BasicKinematics<Geometry>::checkReachability(int16_t inputX, int16_t inputY, int16_t inputZ, int16_t *nearestX, int16_t *nearestY, int16_t *nearestZ) {
+  int32_t shoulderY = (int32_t)inputY + Geometry::limb1;
+
+  Reachability reachability = _reachabilityOf(inputX, shoulderY, inputZ);
+  if ((nearestX == NULL) || (nearestY == NULL) || (nearestZ == NULL))
+    return reachability;
+
+  *nearestX = inputX;
+  *nearestY = inputY;
+  *nearestZ = inputZ;
+  if (reachability == FOOT_REACHABLE)
+    return reachability;
+
+  // On the half plane (x, distance from the motor 1 axis) the foot can reach
+  //   SHOULDER_FOOT_MIN^2 + LIMB_1^2 <= x^2 + axis^2 <= SHOULDER_FOOT_MAX^2 + LIMB_1^2, axis >= LIMB_1
+  // Each try aims a mm further inside, until the rounded position passes the test.
+  float axisDistance = sqrtf(((float)shoulderY * shoulderY) + ((float)inputZ * inputZ));
+
+  for (uint8_t margin = 1; margin <= 4; margin++) {
+    float footMin = Geometry::shoulderFootMin + margin;
+    float footMax = Geometry::shoulderFootMax - margin;
+    float axisMin = Geometry::limb1 + margin;
+
+    float x = inputX;
+    float axis = axisDistance;
+
+    if (axis >= axisMin) {
+      // Move it onto the ring, towards the shoulder
+      float ring = sqrtf((x * x) + (axis * axis));
+      float ringMin = sqrtf((footMin * footMin) + ((float)Geometry::limb1 * Geometry::limb1));
+      float ringMax = sqrtf((footMax * footMax) + ((float)Geometry::limb1 * Geometry::limb1));
+      float scale = 1;
+      if (ring < ringMin)
+        scale = ringMin / ring;
+      else if (ring > ringMax)
+        scale = ringMax / ring;
+      x *= scale;
+      axis *= scale;
+    }
+
+    if (axis < axisMin) {
+      // Onto the edge of the LIMB_1 cylinder, where only x sets the foot-shoulder length
+      float axisLengthSquared = (axisMin * axisMin) - ((float)Geometry::limb1 * Geometry::limb1);
+      float xMinSquared = (footMin * footMin) - axisLengthSquared;
+      float xMaxSquared = (footMax * footMax) - axisLengthSquared;
+      if (xMinSquared < 0)
+        xMinSquared = 0;
+
+      float absX = abs(x);
+      if (absX * absX < xMinSquared)
+        absX = sqrtf(xMinSquared);
+      else if (absX * absX > xMaxSquared)
+        absX = sqrtf(xMaxSquared);
+      x = (x < 0) ? -absX : absX;
+      axis = axisMin;
+    }
+
+    // Back around the axis to where the target was; straight down if it was on the axis
+    float y = 0;
+    float z = axis;
+    if (axisDistance > 0) {
+      y = (shoulderY * axis) / axisDistance;
+      z = (inputZ * axis) / axisDistance;
+    }
+
+    int16_t solvedX = lrintf(x);
+    int16_t solvedY = lrintf(y);
+    int16_t solvedZ = lrintf(z);
+    if (_reachabilityOf(solvedX, solvedY, solvedZ) == FOOT_REACHABLE) {
+      *nearestX = solvedX;
+      *nearestY = solvedY - Geometry::limb1;
+      *nearestZ = solvedZ;
+      return reachability;
+    }
+  }
+
+  // Under the shoulder, halfway between the limits
+  *nearestX = 0;
+  *nearestY = 0;
+  *nearestZ = (Geometry::shoulderFootMin + Geometry::shoulderFootMax) / 2;
+  return reachability;
+};
+
+
+/*!
+ *    @brief  Sets the desired foot endpoint in Cartesian coordinates (mm)
+ *    @param  inputX x-axis coordinate
+ *    @param  inputY y-axis coordinate
+ *    @param  inputZ z-axis coordinate
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::setFootEndpoint(int16_t inputX, int16_t inputY, int16_t inputZ) {
+
+  // Set inputY = 0 to under the shoulder
+  inputY += Geometry::limb1;
+
+  // The angles (and the ramps) are already set for this endpoint
+  if (_checkSolvedPosition(&_endpointSolved, inputX, inputY, inputZ, KINEMATICS_ENDPOINT_TOLERANCE))
+    return;
+
+#if defined(DIFFERENTIAL_KINEMATICS)
+  trackFootPosition(inputX, inputY, inputZ, &_motors[M1 - 1].angleDegrees, &_motors[M2 - 1].angleDegrees, &_motors[M3 - 1].angleDegrees);
+#else
+  solveFootPosition(inputX, inputY, inputZ, &_motors[M1 - 1].angleDegrees, &_motors[M2 - 1].angleDegrees, &_motors[M3 - 1].angleDegrees);
+#endif
+
+  // ******** Everything below is for DYNAMIC movement ********
+
+#if defined(CARTESIAN_DYNAMIC_INTERPOLATION)
+  uint16_t motor1AngleDelta = abs(_motors[M1 - 1].angleDegrees - _motors[M1 - 1].previousDegrees);
+  uint16_t motor2AngleDelta = abs(_motors[M2 - 1].angleDegrees - _motors[M2 - 1].previousDegrees);
+  uint16_t motor3AngleDelta = abs(_motors[M3 - 1].angleDegrees - _motors[M3 - 1].previousDegrees);
+  uint16_t demandTime = lrintf((float)MAX_SPEED_INVERSE * max(max(motor1AngleDelta, motor2AngleDelta), motor3AngleDelta));
+
+
+    // determine whether motor angles have been updated i.e. new end angle, and update final positions accordingly
+  if ((_motors[M1 - 1].previousDegrees != _motors[M1 - 1].angleDegrees)
+   || (_motors[M2 - 1].previousDegrees != _motors[M2 - 1].angleDegrees) 
+   || (_motors[M3 - 1].previousDegrees != _motors[M3 - 1].angleDegrees)) {
+     
+    _motors[M1 - 1].previousDegrees = _motors[M1 - 1].angleDegrees;
+    _motors[M2 - 1].previousDegrees = _motors[M2 - 1].angleDegrees;
+    _motors[M3 - 1].previousDegrees = _motors[M3 - 1].angleDegrees;
+
+    dynamicX.go(inputX, demandTime, LINEAR, ONCEFORWARD);
+    dynamicY.go(inputY, demandTime, LINEAR, ONCEFORWARD);
+    dynamicZ.go(inputZ, demandTime, LINEAR, ONCEFORWARD);
+
+    // a ramp without any time is finished straight away, so make sure its end position still gets solved
+    _dynamicSolved.isValid = false;
+  }
+#else
+  // updateDynamicFootPosition() moves the motors from where they are now, so there is nothing to set up
+  _motors[M1 - 1].previousDegrees = _motors[M1 - 1].angleDegrees;
+  _motors[M2 - 1].previousDegrees = _motors[M2 - 1].angleDegrees;
+  _motors[M3 - 1].previousDegrees = _motors[M3 - 1].angleDegrees;
+#endif
+}
+
+#if defined(CARTESIAN_DYNAMIC_INTERPOLATION)
+
+/*!
+ *    @brief  Recalculates the foot position based on the interpolated axis
+ *    @returns void
+*/
+template <class Geometry>
+void BasicKinematics<Geometry>::updateDynamicFootPosition() {
+
+  // Once the ramps are done the foot stays at the position that was solved last
+  if (_dynamicSolved.isValid && dynamicX.isFinished() && dynamicY.isFinished() && dynamicZ.isFinished())
+    return;
+
+  int16_t inputX = dynamicX.update();
+  int16_t inputY = dynamicY.update();
+  int16_t inputZ = dynamicZ.update();
+
+  // The interpolated position only changes every few updates when the ramps are slow
+  if (_checkSolvedPosition(&_dynamicSolved, inputX, inputY, inputZ, 0))
+    return;
+
+  solveFootPosition(inputX, inputY, inputZ, &_motors[M1 - 1].dynamicDegrees, &_motors[M2 - 1].dynamicDegrees, &_motors[M3 - 1].dynamicDegrees);
+
+}
+
+#else
+
+/*!
+ *    @brief  Moves one motor towards its angle like a servo with limited speed and torque would: it speeds up by
+ *            DYNAMIC_MAX_ACCELERATION to the MAX_SPEED_INVERSE speed, and slows down in time to stop at the angle
+ *            (v^2 / 2a from it). A motor that gets there carries on at the speed it arrived with, so it keeps up
+ *            with an angle that moves a little every tick.
+ *    @param  motion        The motor's position and speed
+ *    @param  targetDegrees The angle to move to
+ *    @param  elapsed       Time since the last update (ms)
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::_stepJointMotion(JointMotion *motion, int16_t targetDegrees, uint16_t elapsed) {
+  int32_t distance = (int32_t)targetDegrees * JOINT_MOTION_ONE - motion->position;
+  if ((distance == 0) && (motion->velocity == 0))
+    return;
+
+  // Work in the direction of the target so that both directions are the same
+  int8_t direction = (distance >= 0) ? 1 : -1;
+  distance *= direction;
+  int32_t speed = motion->velocity * direction;
+  int32_t speedChange = JOINT_MOTION_ACCELERATION * elapsed;
+
+  if ((speed > 0) && ((uint32_t)speed * speed / (2 * JOINT_MOTION_ACCELERATION) >= (uint32_t)distance)) {
+    speed -= speedChange;
+    if (speed < 0)
+      speed = 0;
+  }
+  else {
+    speed += speedChange;
+    if (speed > JOINT_MOTION_MAX_SPEED)
+      speed = JOINT_MOTION_MAX_SPEED;
+  }
+
+  int32_t step = speed * elapsed;
+  if (step >= distance) {
+    motion->position = (int32_t)targetDegrees * JOINT_MOTION_ONE;
+    motion->velocity = (distance / elapsed) * direction;
+  }
+  else {
+    motion->position += step * direction;
+    motion->velocity = speed * direction;
+  }
+}
+
+/*!
+ *    @brief  Moves the dynamic angles (dynamicDegrees) of the motors towards the angles that were set last
+ *            (angleDegrees) in joint space, for the time since the last call. Nothing is solved.
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::updateDynamicFootPosition() {
+  unsigned long now = millis();
+  unsigned long elapsed = now - _lastDynamicUpdate;
+  if (elapsed == 0)
+    return;
+  _lastDynamicUpdate = now;
+
+  if (elapsed > JOINT_MOTION_MAX_ELAPSED)
+    elapsed = JOINT_MOTION_MAX_ELAPSED;
+
+  for (uint8_t motor = 0; motor < MOTORS_PER_LEG; motor++) {
+    _stepJointMotion(&_jointMotion[motor], _motors[motor].angleDegrees, elapsed);
+    _motors[motor].dynamicDegrees = (_jointMotion[motor].position + (JOINT_MOTION_ONE / 2)) >> JOINT_MOTION_SHIFT;
+  }
+}
+
+#endif
+
+/*!
+ *    @brief  Solves the angles needed to achieve a defined foot-to-shoulder length
+ *    @param  demandFtShldr Desired foot-should length
+ *    @param  demandAngle2  Angle to hold the output for motor 2
+ *    @param  demandAngle3  Angle to hold the output for motor 2
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::solveFtShldrLength(float demandFtShldr, float *demandAngle2, float *demandAngle3) {
+  PROFILE_START(PROFILE_SOLVE_FT_SHLDR_LENGTH);
+
+  float _demandFtShldrLength = demandFtShldr;
+  if (_demandFtShldrLength > Geometry::shoulderFootMax) 
+    _demandFtShldrLength = Geometry::shoulderFootMax;
+  else if (_demandFtShldrLength < Geometry::shoulderFootMin)
+    _demandFtShldrLength = Geometry::shoulderFootMin;
+
+  // Use the Law of Cosines to solve for the angles of motor 3 and convert to degrees
+  float _demandAngle3 = acosf( (Geometry::kneeSidesSquared - (_demandFtShldrLength * _demandFtShldrLength)) / Geometry::kneeSidesProduct ); // demand angle for position 3 (operated by M3)
+  _demandAngle3 *= RAD_TO_DEG_F;   //convert to degrees
+
+  // Use demandAngle3 to calculate for demandAngle2 (angle for M2)
+  float _demandAngle2 = ((180 - _demandAngle3) / 2 );
+
+  *demandAngle2 += _demandAngle2;
+  *demandAngle3 += _demandAngle3;
+
+  PROFILE_END(PROFILE_SOLVE_FT_SHLDR_LENGTH);
+};
+
+
+/*!
+ *    @brief  Solves the angles needed to achieve a specified x-axis movement
+ *    @param  inputX        The desired x-axis coordinate (mmm)
+ *    @param  inputZ        The desired z-axis coordinate (mm)
+ *    @param  demandAngle2  Angle to hold the output for motor 2
+ *    @param  demandFtShldrLength   Outputted foot shoulder length
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::solveXMove(int16_t inputX, int16_t inputZ, float *demandAngle2, float *demandFtShldrLength) {
+  PROFILE_START(PROFILE_SOLVE_X_MOVE);
+
+  if (inputZ == 0)
+    inputZ = 1;   // you can never divide by 0!
+
+  float absX = abs(inputX);
+  float absZ = abs(inputZ);
+  *demandFtShldrLength = sqrtf((absZ * absZ) + (absX * absX));
+
+  *demandAngle2 = atan2f(absX, absZ) * RAD_TO_DEG_F;
+
+  if (inputX > 0)
+    *demandAngle2 *= -1;            // change later: make it negative if inputX is in the negative direction and parse it later
+
+  PROFILE_END(PROFILE_SOLVE_X_MOVE);
+};
+
+
+/*!
+ *    @brief  Solves the angles needed to achieve a specified y-axis movement
+ *    @param  inputY        The desired y-axis coordinate (mmm)
+ *    @param  inputZ        The desired z-axis coordinate (mm)
+ *    @param  demandAngle2  Angle to hold the output for motor 1
+ *    @param  yPlaneZOutput The desired z-axis coordinate on the z-y plane.
+ *    When you shift the entire leg via a y-axis change, then the distance from
+ *    the foot to the shoulder on the x-z plane changes than that on the y-z plane.
+ *    This must be considered. Ideally, this output should be passed to all other 
+ *    calculations as the z-axis coordinate. 
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::solveYMove(int16_t inputY, int16_t inputZ, float *demandAngle1, float *yPlaneZOutput) {
+  PROFILE_START(PROFILE_SOLVE_Y_MOVE);
+
+  const float limb1Squared = (float)Geometry::limb1 * Geometry::limb1;
+
+  float absY = abs(inputY);
+  float absZ = abs(inputZ);
+  float demandFtShldrSquared = (absZ * absZ) + (absY * absY); // foot-shoulder distance on y-z plane (L1 in diagram), squared
+  if (demandFtShldrSquared < limb1Squared)
+    demandFtShldrSquared = limb1Squared;   // the foot is inside of LIMB_1; there is no solution (see checkReachability())
+  float demandFtShldrLength = sqrtf(demandFtShldrSquared);
+  *yPlaneZOutput = sqrtf(demandFtShldrSquared - limb1Squared);
+
+  // Here, theta is the angle closest to the axis of rotation in the triangle relating inputY and inputZ
+  // Alpha is the angle closest to the axis of rotation in the triangle relating leg length output to LIMB_1 length
+  float theta = atan2f(absY, absZ) * RAD_TO_DEG_F;   // 0 on the motor 1 axis
+  float alpha = acosf(Geometry::limb1 / demandFtShldrLength) * RAD_TO_DEG_F;
+  if (inputY >= 0) {
+    *demandAngle1 += (float)abs((float)90 - (theta + alpha));
+  }
+  else if (inputY < 0) {
+    *demandAngle1 += (float)abs((float)90 - (alpha - theta));   // since both triangles (refer to drawings) have the same hypotenuse, alpha > theta for all inputY
+  }
+
+
+  // NEGATIVE signifies a direction: the foot is moving TOWARDS THE ROBOT
+  // POSITIVE signifies AWAY FROM ROBOT
+  if (inputY < Geometry::limb1)
+    *demandAngle1 *= -1;
+
+  PROFILE_END(PROFILE_SOLVE_Y_MOVE);
+}
+
+
+/*!
+ *    @brief  Calculates all the angles for an x-y-z coordinate foot position without
+ *            rounding them. This is the floating point solve used by solveFootPosition().
+ *    @param  inputX        The desired x-axis coordinate (mmm) 
+ *    @param  inputY        The desired y-axis coordinate (mm)
+ *    @param  inputZ        The desired z-axis coordinate (mm)
+ *    @param  demandAngle1  The motor 1 angle output (degrees)
+ *    @param  demandAngle2  The motor 2 angle output (degrees)
+ *    @param  demandAngle3  The motor 3 angle output (degrees)
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::solveFootAngles(int16_t inputX, int16_t inputY, int16_t inputZ, float *demandAngle1, float *demandAngle2, float *demandAngle3) {
+  *demandAngle1 = 0;
+  *demandAngle2 = 0;
+  *demandAngle3 = 0;
+
+  float yPlaneZOutput = 0;  // this is the foot-shoulder distance on the y-z plane (L1 in diagram), and the distance the leg must stretch to achieve the desired y movement on the y-z plane. 
+  float demandFtShldrLength = 0;  // this is the foot-should distance on the x-z plane and the final calculated length
+
+  solveYMove(inputY, inputZ, demandAngle1, &yPlaneZOutput);
+
+  solveXMove(inputX, yPlaneZOutput, demandAngle2, &demandFtShldrLength);
+
+  solveFtShldrLength(demandFtShldrLength, demandAngle2, demandAngle3);
+};
+
+
+/*!
+ *    @brief  Overall kinematics function that calculates all the angles for an x-y-z 
+      coordinate foot position. 
+ *    @param  inputX        The desired x-axis coordinate (mmm) 
+ *    @param  inputY        The desired y-axis coordinate (mm)
+ *    @param  inputZ        The desired z-axis coordinate (mm)
+ *    @param  motor1AngleP  The motor 1 angle output
+ *    @param  motor2AngleP  The motor 2 angle output
+ *    @param  motor3AngleP  The motor 3 angle output
+ */
+#if !defined(FIXED_POINT_KINEMATICS)
+
+template <class Geometry>
+void BasicKinematics<Geometry>::solveFootPosition(int16_t inputX, int16_t inputY, int16_t inputZ, int16_t *motor1AngleP, int16_t *motor2AngleP, int16_t *motor3AngleP) {
+
+#if defined(WORKSPACE_ANGLE_TABLE)
+  if (_workspaceTable.lookup(inputX, inputY - Geometry::limb1, inputZ, motor1AngleP, motor2AngleP, motor3AngleP))
+    return;
+#endif
+
+  float demandAngle1;
+  float demandAngle2;
+  float demandAngle3;
+
+  solveFootAngles(inputX, inputY, inputZ, &demandAngle1, &demandAngle2, &demandAngle3);
+
+  // Round off demand angles
+  demandAngle1 = lrintf(demandAngle1);
+  demandAngle2 = lrintf(demandAngle2);
+  demandAngle3 = lrintf(demandAngle3);
+
+
+  // Set live motor angles to the newly calculated ones
+
+  //motor 1: 
+  *motor1AngleP = demandAngle1; // In degrees!
+
+  // motor 2:
+  *motor2AngleP = demandAngle2; // In degrees!
+
+  // motor 3:
+  *motor3AngleP = demandAngle3; // In degrees!
+};
+
+#else
+
+/*!
+ *    @brief  Overall kinematics function, fixed point version (FIXED_POINT_KINEMATICS). This
+ *            follows the same steps as solveYMove(), solveXMove() and solveFtShldrLength() but
+ *            uses integer math and the arctangent table. The inverse cosines are found with
+ *            acos(a/c) = atan(b/a) since the missing side of each triangle is an integer square root.
+ *    @param  inputX        The desired x-axis coordinate (mmm)
+ *    @param  inputY        The desired y-axis coordinate (mm)
+ *    @param  inputZ        The desired z-axis coordinate (mm)
+ *    @param  motor1AngleP  The motor 1 angle output
+ *    @param  motor2AngleP  The motor 2 angle output
+ *    @param  motor3AngleP  The motor 3 angle output
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::solveFootPosition(int16_t inputX, int16_t inputY, int16_t inputZ, int16_t *motor1AngleP, int16_t *motor2AngleP, int16_t *motor3AngleP) {
+
+#if defined(WORKSPACE_ANGLE_TABLE)
+  if (_workspaceTable.lookup(inputX, inputY - Geometry::limb1, inputZ, motor1AngleP, motor2AngleP, motor3AngleP))
+    return;
+#endif
+
+  int32_t absX = abs(inputX);
+  int32_t absY = abs(inputY);
+  int32_t absZ = abs(inputZ);
+
+  // ******** y-z plane (see solveYMove) ********
+
+  int32_t yPlaneZSquared = (absY * absY) + (absZ * absZ) - Geometry::fixedLimb1Squared;
+  if (yPlaneZSquared < 0)
+    yPlaneZSquared = 0;   // the foot is inside of LIMB_1; there is no solution
+
+  uint32_t yPlaneZFine = fixedSqrt((uint32_t)yPlaneZSquared << (2 * FIXED_LENGTH_SHIFT));
+  int32_t yPlaneZOutput = yPlaneZFine >> FIXED_LENGTH_SHIFT;   // whole mm, same as what solveXMove() is given
+
+  int32_t theta = fixedAtan2Degrees(absY, absZ);
+  int32_t alpha = fixedAtan2Degrees(yPlaneZFine, (uint32_t)Geometry::limb1 << FIXED_LENGTH_SHIFT);
+
+  int32_t demandAngle1;
+  if (inputY >= 0)
+    demandAngle1 = FIXED_ANGLE_90 - (theta + alpha);
+  else
+    demandAngle1 = FIXED_ANGLE_90 - (alpha - theta);
+  if (demandAngle1 < 0)
+    demandAngle1 = -demandAngle1;
+
+  if (inputY < Geometry::limb1)
+    demandAngle1 = -demandAngle1;
+
+  // ******** x-z plane (see solveXMove) ********
+
+  if (yPlaneZOutput == 0)
+    yPlaneZOutput = 1;   // you can never divide by 0!
+
+  int32_t demandAngle2 = fixedAtan2Degrees(absX, yPlaneZOutput);
+  if (inputX > 0)
+    demandAngle2 = -demandAngle2;
+
+  int32_t demandFtShldrSquared = (absX * absX) + (yPlaneZOutput * yPlaneZOutput);
+
+  // ******** foot-shoulder length (see solveFtShldrLength) ********
+
+  // Law of Cosines: cos(angle3) = kneeCosine / FIXED_KNEE_SIDES_PRODUCT
+  int32_t kneeCosine = Geometry::fixedKneeSidesSquared - demandFtShldrSquared;
+  if (kneeCosine > Geometry::fixedKneeSidesProduct)
+    kneeCosine = Geometry::fixedKneeSidesProduct;
+  else if (kneeCosine < -Geometry::fixedKneeSidesProduct)
+    kneeCosine = -Geometry::fixedKneeSidesProduct;
+
+  uint32_t kneeSine = fixedSqrt((uint32_t)Geometry::fixedKneeSidesProduct * Geometry::fixedKneeSidesProduct - (uint32_t)(kneeCosine * kneeCosine));
+
+  int32_t demandAngle3;
+  if (kneeCosine >= 0)
+    demandAngle3 = fixedAtan2Degrees(kneeSine, kneeCosine);
+  else
+    demandAngle3 = FIXED_ANGLE_180 - fixedAtan2Degrees(kneeSine, -kneeCosine);
+
+  demandAngle2 += (FIXED_ANGLE_180 - demandAngle3) / 2;
+
+  // Round off and set live motor angles to the newly calculated ones (in degrees!)
+  *motor1AngleP = fixedAngleToDegrees(demandAngle1);
+  *motor2AngleP = fixedAngleToDegrees(demandAngle2);
+  *motor3AngleP = fixedAngleToDegrees(demandAngle3);
+};
+
+#endif
+
+
+/*!
+ *    @brief  Forward kinematics: finds where the foot is for a set of motor angles. This is the opposite of
+ *            solveFootAngles() and uses the same coordinates (inputY = LIMB_1 is under the shoulder), so
+ *            it can be used to check the angles that a solve gives.
+ *    @param  demandAngle1  Motor 1 angle (degrees)
+ *    @param  demandAngle2  Motor 2 angle (degrees)
+ *    @param  demandAngle3  Motor 3 angle (degrees)
+ *    @param  outputX       The foot's x-axis coordinate (mm)
+ *    @param  outputY       The foot's y-axis coordinate (mm)
+ *    @param  outputZ       The foot's z-axis coordinate (mm)
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::solveForwardKinematics(float demandAngle1, float demandAngle2, float demandAngle3, float *outputX, float *outputY, float *outputZ) {
+  JointState joints;
+
+  _setJointState(&joints, demandAngle1, demandAngle2, demandAngle3);
+  _solveJointState(&joints, outputX, outputY, outputZ, NULL);
+};
+
+/*!
+ *    @brief  Finds the Jacobian of the leg: how the foot moves for small changes in the motor angles.
+ *            Coordinates are the same as for solveFootAngles().
+ *    @param  demandAngle1  Motor 1 angle (degrees)
+ *    @param  demandAngle2  Motor 2 angle (degrees)
+ *    @param  demandAngle3  Motor 3 angle (degrees)
+ *    @param  jacobian      Output; jacobian[axis][motor] is how far (mm) the foot moves along the
+ *                          x, y or z axis per radian of motor 1, 2 or 3
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::solveJacobian(float demandAngle1, float demandAngle2, float demandAngle3, float jacobian[3][3]) {
+  JointState joints;
+  float footX;
+  float footY;
+  float footZ;
+
+  _setJointState(&joints, demandAngle1, demandAngle2, demandAngle3);
+  _solveJointState(&joints, &footX, &footY, &footZ, jacobian);
+};
+
+#if defined(DIFFERENTIAL_KINEMATICS)
+
+/*!
+ *    @brief  Differential kinematics version of solveFootPosition(). Instead of solving from scratch,
+ *            the angles from the last call are moved towards the new foot position using the
+ *            Jacobian (damped least squares near the leg's full stretch). The full solve is only used
+ *            when the foot jumps more than DIFFERENTIAL_IK_MAX_STEP or the step is off by more than
+ *            DIFFERENTIAL_IK_MAX_ERROR, so the foot should move a little at a time.
+ *    @param  inputX        The desired x-axis coordinate (mm)
+ *    @param  inputY        The desired y-axis coordinate (mm)
+ *    @param  inputZ        The desired z-axis coordinate (mm)
+ *    @param  motor1AngleP  The motor 1 angle output
+ *    @param  motor2AngleP  The motor 2 angle output
+ *    @param  motor3AngleP  The motor 3 angle output
+ */
+template <class Geometry>
+void BasicKinematics<Geometry>::trackFootPosition(int16_t inputX, int16_t inputY, int16_t inputZ, int16_t *motor1AngleP, int16_t *motor2AngleP, int16_t *motor3AngleP) {
+  if (!_trackedJoints.isValid || !_stepTrackedJoints(inputX, inputY, inputZ))
+    _resetTrackedJoints(inputX, inputY, inputZ);
+
+  // In degrees!
+  *motor1AngleP = lrintf(_trackedJoints.angle1 * RAD_TO_DEG_F);
+  *motor2AngleP = lrintf(_trackedJoints.angle2 * RAD_TO_DEG_F);
+  *motor3AngleP = lrintf(_trackedJoints.angle3 * RAD_TO_DEG_F);
+};
+
+
+/*!
+ *    @brief  Velocity level control: finds the motor speeds that move the foot at a given velocity
+ *            from the position that was last passed to trackFootPosition().
+ *    @param  velocityX     x-axis foot velocity (mm per second)
+ *    @param  velocityY     y-axis foot velocity (mm per second)
+ *    @param  velocityZ     z-axis foot velocity (mm per second)
+ *    @param  motor1Speed   Output motor 1 speed (degrees per second)
+ *    @param  motor2Speed   Output motor 2 speed (degrees per second)
+ *    @param  motor3Speed   Output motor 3 speed (degrees per second)
+ *    @return false if the foot isn't being tracked yet or the leg is singular
+ */
+template <class Geometry>
+bool BasicKinematics<Geometry>::solveJointVelocities(float velocityX, float velocityY, float velocityZ, float *motor1Speed, float *motor2Speed, float *motor3Speed) {
+  if (!_trackedJoints.isValid)
+    return false;
+
+  float footX;
+  float footY;
+  float footZ;
+  float jacobian[3][3];
+
+  _solveJointState(&_trackedJoints, &footX, &footY, &footZ, jacobian);
+
+  float velocity[3] = { velocityX, velocityY, velocityZ };
+  float angleRate[3];
+  if (!_solveDampedLeastSquares(jacobian, _trackingDamping(&_trackedJoints), velocity, angleRate))
+    return false;
+
+  *motor1Speed = angleRate[0] * RAD_TO_DEG_F;
+  *motor2Speed = angleRate[1] * RAD_TO_DEG_F;
+  *motor3Speed = angleRate[2] * RAD_TO_DEG_F;
+  return true;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+#include "PCA9685Driver.h"
+
+// Registers
+#define PCA9685_MODE1         0x00
+#define PCA9685_MODE2         0x01
+#define PCA9685_LED0_ON_L     0x06
+#define PCA9685_ALL_LED_ON_L  0xFA
+#define PCA9685_ALL_LED_ON_H  0xFB
+#define PCA9685_PRESCALE      0xFE
+
+#define PCA9685_MODE1_RESTART   0x80
+#define PCA9685_MODE1_AI        0x20    // register auto-increment
+#define PCA9685_MODE1_SLEEP     0x10
+#define PCA9685_MODE2_OUTDRV    0x04    // totem pole outputs
+
+#define PCA9685_OSCILLATOR  25000000UL  // internal oscillator (Hz)
+#define PCA9685_COUNTS      4096        // counts per PWM period
+
+PCA9685Driver::PCA9685Driver(void) {};
+
+/*!
+ *    @brief  Sets up the PCA9685 for driving servos
+ *    @param  address   I2C address of the board
+ *    @param  frequency PWM frequency (Hz); 50 for most servos
+ *    @param  wire      The I2C bus that the board is on
+ */
+void PCA9685Driver::init(uint8_t address, uint16_t frequency, TwoWire *wire) {
+  _wire = wire;
+  _address = address;
+  transmissionCount = 0;
+
+  uint8_t prescale = ((PCA9685_OSCILLATOR + (PCA9685_COUNTS * (uint32_t)frequency / 2)) / (PCA9685_COUNTS * (uint32_t)frequency)) - 1;
+
+  // The prescaler can only be set while the oscillator is asleep
+  _writeRegister(PCA9685_MODE1, PCA9685_MODE1_SLEEP);
+  _writeRegister(PCA9685_PRESCALE, prescale);
+  _writeRegister(PCA9685_MODE2, PCA9685_MODE2_OUTDRV);
+  _writeRegister(PCA9685_MODE1, PCA9685_MODE1_AI);
+  delayMicroseconds(500);   // the oscillator takes 500us to start
+  _writeRegister(PCA9685_MODE1, PCA9685_MODE1_AI | PCA9685_MODE1_RESTART);
+
+  // Pulses start at count 0 on every channel, so that single channel updates only need the OFF count
+  _writeRegister(PCA9685_ALL_LED_ON_L, 0);
+  _writeRegister(PCA9685_ALL_LED_ON_H, 0);
+
+  // Counts per microsecond at the frequency the prescaler actually gives
+  _countsPerMicrosecond = ((uint64_t)PCA9685_OSCILLATOR << 16) / ((uint32_t)(prescale + 1) * 1000000UL);
+}
+
+/*!
+ *    @brief  Converts the changed pulse widths to PWM counts and writes them; each run of neighbouring
+ *            channels is one burst.
+ *    @param  channels      The channel of each motor
+ *    @param  pulseWidths   The pulse width of each motor (microseconds)
+ *    @param  changedMotors Bit mask of the motors to write
+ */
+void PCA9685Driver::writePulseWidths(const uint8_t channels[], const uint16_t pulseWidths[], uint16_t changedMotors) {
+  uint16_t changedChannels = 0;
+
+  for (uint8_t motor = 0; changedMotors != 0; motor++, changedMotors >>= 1) {
+    if (!(changedMotors & 1) || (channels[motor] >= PCA9685_CHANNELS))
+      continue;
+
+    _counts[channels[motor]] = ((uint32_t)pulseWidths[motor] * _countsPerMicrosecond) >> 16;
+    changedChannels |= (1U << channels[motor]);
+  }
+
+  uint8_t channel = 0;
+  while (changedChannels != 0) {
+    if (!(changedChannels & 1)) {
+      channel++;
+      changedChannels >>= 1;
+      continue;
+    }
+
+    uint8_t runLength = 0;
+    while ((changedChannels & 1) && (runLength < PCA9685_BURST_CHANNELS)) {
+      runLength++;
+      changedChannels >>= 1;
+    }
+
+    _writeChannels(channel, runLength);
+    channel += runLength;
+  }
+}
+
+void PCA9685Driver::_writeRegister(uint8_t reg, uint8_t value) {
+  _wire->beginTransmission(_address);
+  _wire->write(reg);
+  _wire->write(value);
+  _wire->endTransmission();
+}
+
+/*!
+ *    @brief  Writes neighbouring channels in one transmission. The ON count is always 0, so a single
+ *            channel only needs its OFF registers.
+ *    @param  firstChannel  The first channel
+ *    @param  channelCount  How many channels (at most PCA9685_BURST_CHANNELS)
+ */
+void PCA9685Driver::_writeChannels(uint8_t firstChannel, uint8_t channelCount) {
+  uint8_t reg = PCA9685_LED0_ON_L + (4 * firstChannel);
+
+  _wire->beginTransmission(_address);
+
+  if (channelCount == 1) {
+    _wire->write(reg + 2);
+    _wire->write(_counts[firstChannel] & 0xFF);
+    _wire->write(_counts[firstChannel] >> 8);
+  }
+  else {
+    _wire->write(reg);
+    for (uint8_t channel = firstChannel; channel < firstChannel + channelCount; channel++) {
+      _wire->write(0);
+      _wire->write(0);
+      _wire->write(_counts[channel] & 0xFF);
+      _wire->write(_counts[channel] >> 8);
+    }
+  }
+
+  _wire->endTransmission();
+  transmissionCount++;
+}
@@ -0,0 +1,39 @@
+#ifndef PCA9685_DRIVER_H
+#define PCA9685_DRIVER_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "ServoOutput.h"
+#include "quadruped-config.h"
+
+#define PCA9685_CHANNELS 16
+
+// ServoDriver for a PCA9685 16 channel PWM board over I2C. Changed channels that are next to each other
+// are sent in one auto-incremented burst (up to PCA9685_BURST_CHANNELS per transmission), and a lone
+// channel only gets its two OFF registers written.
+class PCA9685Driver : public ServoDriver {
+
+  public:
+    PCA9685Driver();
+
+    // wire.begin() has to be called first
+    void init(uint8_t address = 0x40, uint16_t frequency = 50, TwoWire *wire = &Wire);
+
+    void writePulseWidths(const uint8_t channels[], const uint16_t pulseWidths[], uint16_t changedMotors);
+
+    uint32_t transmissionCount;   // I2C transmissions made by writePulseWidths()
+
+  private:
+    void _writeRegister(uint8_t reg, uint8_t value);
+    void _writeChannels(uint8_t firstChannel, uint8_t channelCount);
+
+    TwoWire * _wire;
+    uint8_t _address;
+    uint32_t _countsPerMicrosecond;   // Q16
+
+    uint16_t _counts[PCA9685_CHANNELS];   // OFF count of each channel, waiting to be written
+
+};
+
+#endif
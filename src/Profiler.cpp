@@ -0,0 +1,125 @@
+#include "Profiler.h"
+
+#if defined(QUADRUPED_PROFILING)
+
+Profiler profiler;
+
+static const char * const PROBE_NAMES[NUMBER_OF_PROFILE_PROBES] = {
+  "solveYMove", "solveXMove", "solveFtShldrLength", "StepPlanner::update", "Quadruped::walk tick"
+};
+
+#endif
+
+Profiler::Profiler(void) {};
+
+/*!
+ *    @brief  Starts the cycle counter (if it needs to be started) and clears everything
+ */
+void Profiler::init() {
+#if defined(QUADRUPED_PROFILING) && !defined(ESP32) && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+  PROFILER_DEMCR |= (1UL << 24);      // TRCENA: turn on the DWT
+  PROFILER_DWT_CYCCNT = 0;
+  PROFILER_DWT_CTRL |= 1UL;           // CYCCNTENA
+#endif
+
+  for (uint8_t probe = 0; probe < NUMBER_OF_PROFILE_PROBES; probe++)
+    _stats[probe].deadline = 0;
+
+  reset();
+}
+
+/*!
+ *    @brief  Clears the stats and the samples. Deadlines are kept.
+ */
+void Profiler::reset() {
+  for (uint8_t probe = 0; probe < NUMBER_OF_PROFILE_PROBES; probe++) {
+    _stats[probe].count = 0;
+    _stats[probe].minimum = UINT32_MAX;
+    _stats[probe].maximum = 0;
+    _stats[probe].total = 0;
+    _stats[probe].deadlineMisses = 0;
+  }
+  _nextSample = 0;
+  _sampleCount = 0;
+}
+
+/*!
+ *    @brief  Sets the longest time a probe should take; any longer is counted as a deadline miss
+ *    @param  probe The probe
+ *    @param  deadline The deadline in PROFILER_TIMER_UNITS, or 0 for no deadline
+ */
+void Profiler::setDeadline(ProfileProbe probe, uint32_t deadline) {
+  _stats[probe].deadline = deadline;
+}
+
+/*!
+ *    @brief  Records one measurement. This is what PROFILE_END() calls.
+ *    @param  probe The probe that was measured
+ *    @param  time How long it took in PROFILER_TIMER_UNITS
+ */
+void Profiler::record(ProfileProbe probe, uint32_t time) {
+  ProfileStats *stats = &_stats[probe];
+
+  stats->count++;
+  stats->total += time;
+  if (time < stats->minimum)
+    stats->minimum = time;
+  if (time > stats->maximum)
+    stats->maximum = time;
+  if ((stats->deadline != 0) && (time > stats->deadline))
+    stats->deadlineMisses++;
+
+  _samples[_nextSample].probe = probe;
+  _samples[_nextSample].time = time;
+  _nextSample = (_nextSample + 1) % PROFILER_RING_SIZE;
+  if (_sampleCount < PROFILER_RING_SIZE)
+    _sampleCount++;
+}
+
+/*!
+ *    @returns The stats collected for a probe
+ */
+ProfileStats * Profiler::stats(ProfileProbe probe) {
+  return &_stats[probe];
+}
+
+/*!
+ *    @brief  Prints everything that has been collected, i.e. to Serial. This is slow, so do it
+ *            outside of the control loop.
+ *    @param  output Where to print to
+ */
+void Profiler::dump(Print &output) {
+#if defined(QUADRUPED_PROFILING)
+  output.print("probe, count, min, mean, max, deadline misses (");
+  output.print(PROFILER_TIMER_UNITS);
+  output.println(")");
+
+  for (uint8_t probe = 0; probe < NUMBER_OF_PROFILE_PROBES; probe++) {
+    ProfileStats *stats = &_stats[probe];
+    if (stats->count == 0)
+      continue;
+    output.print(PROBE_NAMES[probe]);
+    output.print(", ");
+    output.print(stats->count);
+    output.print(", ");
+    output.print(stats->minimum);
+    output.print(", ");
+    output.print((uint32_t)(stats->total / stats->count));
+    output.print(", ");
+    output.print(stats->maximum);
+    output.print(", ");
+    output.println(stats->deadlineMisses);
+  }
+
+  output.println("recent samples:");
+  uint16_t sample = (_nextSample + PROFILER_RING_SIZE - _sampleCount) % PROFILER_RING_SIZE;
+  for (uint16_t printed = 0; printed < _sampleCount; printed++) {
+    output.print(PROBE_NAMES[_samples[sample].probe]);
+    output.print(", ");
+    output.println(_samples[sample].time);
+    sample = (sample + 1) % PROFILER_RING_SIZE;
+  }
+#else
+  output.println("QUADRUPED_PROFILING is not defined");
+#endif
+}
@@ -0,0 +1,97 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "quadruped-config.h"
+
+// The places in the control loop that can be timed
+typedef enum {
+  PROFILE_SOLVE_Y_MOVE = 0,
+  PROFILE_SOLVE_X_MOVE,
+  PROFILE_SOLVE_FT_SHLDR_LENGTH,
+  PROFILE_STEP_PLANNER_UPDATE,
+  PROFILE_WALK_TICK
+} ProfileProbe;
+#define NUMBER_OF_PROFILE_PROBES 5
+
+#if defined(QUADRUPED_PROFILING)
+
+// Timer used for profiling: the cycle counter where there is one, otherwise micros()
+#if defined(ESP32)
+  #define PROFILER_TIMER_UNITS  "cycles"
+  #define PROFILER_TIMER_PER_MS (getCpuFrequencyMhz() * 1000UL)
+  #define profilerTimer()       ((uint32_t)ESP.getCycleCount())
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+  // Cortex-M3/M4/M7 DWT cycle counter
+  #define PROFILER_DWT_CTRL     (*(volatile uint32_t *)0xE0001000)
+  #define PROFILER_DWT_CYCCNT   (*(volatile uint32_t *)0xE0001004)
+  #define PROFILER_DEMCR        (*(volatile uint32_t *)0xE000EDFC)
+  #define PROFILER_TIMER_UNITS  "cycles"
+  #if defined(F_CPU)
+    #define PROFILER_TIMER_PER_MS (F_CPU / 1000)
+  #else
+    #define PROFILER_TIMER_PER_MS (SystemCoreClock / 1000)
+  #endif
+  #define profilerTimer()       (PROFILER_DWT_CYCCNT)
+#else
+  #define PROFILER_TIMER_UNITS  "us"
+  #define PROFILER_TIMER_PER_MS 1000
+  #define profilerTimer()       ((uint32_t)micros())
+#endif
+
+// Wrap the code to time with these. Both must be in the same scope.
+#define PROFILE_START(probe)  uint32_t _profileStart##probe = profilerTimer()
+#define PROFILE_END(probe)    profiler.record(probe, profilerTimer() - _profileStart##probe)
+
+#else
+
+// Profiling is turned off: these compile to nothing
+#define PROFILE_START(probe)
+#define PROFILE_END(probe)
+
+#endif
+
+typedef struct {
+  uint32_t count;
+  uint32_t minimum;
+  uint32_t maximum;
+  uint64_t total;
+  uint32_t deadline;          // 0 means no deadline
+  uint32_t deadlineMisses;
+} ProfileStats;
+
+typedef struct {
+  uint8_t probe;
+  uint32_t time;
+} ProfileSample;
+
+class Profiler {
+
+  public:
+    Profiler();
+
+    void init();
+    void reset();
+    void setDeadline(ProfileProbe probe, uint32_t deadline);
+
+    void record(ProfileProbe probe, uint32_t time);
+
+    ProfileStats * stats(ProfileProbe probe);
+
+    // prints the stats for every probe and then the most recent samples (oldest first)
+    void dump(Print &output);
+
+  private:
+    ProfileStats _stats[NUMBER_OF_PROFILE_PROBES];
+
+    ProfileSample _samples[PROFILER_RING_SIZE];
+    uint16_t _nextSample;
+    uint16_t _sampleCount;
+
+};
+
+#if defined(QUADRUPED_PROFILING)
+extern Profiler profiler;
+#endif
+
+#endif
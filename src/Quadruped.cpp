@@ -1,5 +1,8 @@
 #include "Quadruped.h"
 
+#include "Profiler.h"
+#include "FixedPointMath.h"
+
 
 Quadruped::Quadruped(void) {};
 
@@ -10,79 +13,780 @@ void Quadruped::_setMode(ROBOT_MODE robotMode) {
 void Quadruped::init(int16_t inputX, int16_t inputY, int16_t inputZ, Motor legMotors[]) {
 
   _robotMode = STATIC_STANDING;
+  _servoOutput = NULL;
+  _motors = legMotors;
+  _trajectoryRecorder = NULL;
+  _trajectoryPlayer = NULL;
+  _controlCoordinateX = 0;
+  _controlCoordinateY = 0;
+
+  _hasBodyPose = false;
+  _isBodyPoseChanged = false;
+
+#if defined(GAIT_LOOKAHEAD)
+  _lookaheadTail = 0;
+  _lookaheadCount = 0;
+  _isLookaheadStale = false;
+#endif
+
+  _stepDirection.controlCoordinateX = 0;
+  _stepDirection.controlCoordinateY = 0;
+  _stepDirection.x = 0;
+  _stepDirection.y = 0;
+
+  // TIME_TO_UPDATE is the update period + 1
+  _scheduler.init(TIME_TO_UPDATE - 1);
+
+#if defined(QUADRUPED_PROFILING)
+  // a tick that takes longer than the tick period is a missed deadline
+  profiler.init();
+  profiler.setDeadline(PROFILE_WALK_TICK, (TIME_TO_UPDATE - 1) * PROFILER_TIMER_PER_MS);
+#endif
+
+  StepPlanner::initGaitParameters(&_gaitParameters, inputX, inputY, inputZ);
+  _requestedGait = _gaitParameters.gaitType;
+
+#if defined(QUADRUPED_DUAL_CORE)
+  _jointFrames.reset();
+#if defined(ESP32)
+  _controlTask = NULL;
+  _outputTask = NULL;
+#endif
+#endif
 
   for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
     LegID LEG = _enumFromIndex(leg);
-    legStepPlanner[leg].init(LEG, inputX, inputY, inputZ);
+    legStepPlanner[leg].init(LEG, &_gaitParameters);
     legKinematics[leg].init(LEG, inputX, inputY, inputZ, legMotors);
+
+    _feet[leg].x = inputX;
+    _feet[leg].y = inputY;
+    _feet[leg].z = inputZ;
   }
+
+#if defined(GAIT_LOOKAHEAD)
+  for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++)
+    _outputAngles[motor] = legMotors[motor].angleDegrees;
+#endif
 };
 
+/*!
+ *    @brief  Runs the gait. Call this every loop with the latest control input; it never waits,
+ *            it only runs the control ticks that are due (see Scheduler).
+ *    @param  controlCoordinateX x direction of the controller (joystick) coordinate
+ *    @param  controlCoordinateY y direction of the controller (joystick) coordinate
+ */
 void Quadruped::walk(int16_t controlCoordinateX, int16_t controlCoordinateY) {
+#if defined(GAIT_LOOKAHEAD)
+  if ((controlCoordinateX != _controlCoordinateX) || (controlCoordinateY != _controlCoordinateY))
+    _isLookaheadStale = true;
+#endif
+  _controlCoordinateX = controlCoordinateX;
+  _controlCoordinateY = controlCoordinateY;
+
+  walk();
+};
 
-#if !defined(STANDING_TROT)
-
-  if ((controlCoordinateX == 0) && (controlCoordinateY == 0) && _robotMode != STATIC_STANDING) {
-    _setMode(STAND_PENDING);
-  }
-  if (((controlCoordinateX != 0) || (controlCoordinateY != 0)) && (_robotMode == STATIC_STANDING)){
-    _setMode(WALKING);
-    for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++)
-      legStepPlanner[leg].reset();
-  }
-
-  if ((_robotMode == WALKING) || (_robotMode == STAND_PENDING)) {
-    for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
-      if (legStepPlanner[leg].footAtOrigin()) {
-        legStepPlanner[leg].setStepEndpoint(controlCoordinateX, controlCoordinateY, _robotMode);
-        if (_robotMode == STAND_PENDING) {
-            while (!legStepPlanner[leg].update(_robotMode))
-              ;
-            int16_t inputX = legStepPlanner[leg].dynamicFootPosition.x;
-            int16_t inputY = legStepPlanner[leg].dynamicFootPosition.y;
-            int16_t inputZ = legStepPlanner[leg].dynamicFootPosition.z;
-            legKinematics[leg].setFootEndpoint(inputX, inputY, inputZ);
-            if (_enumFromIndex(leg) == LEG_4) _setMode(STATIC_STANDING);
-        }
-      }
-      if (legStepPlanner[leg].update(_robotMode)) {
-        int16_t inputX = legStepPlanner[leg].dynamicFootPosition.x;
-        int16_t inputY = legStepPlanner[leg].dynamicFootPosition.y;
-        int16_t inputZ = legStepPlanner[leg].dynamicFootPosition.z;
-
-        legKinematics[leg].setFootEndpoint(inputX, inputY, inputZ);
-      }
+/*!
+ *    @brief  Runs the gait with the latest control input. Call this every loop; it never waits. Commands
+ *            in the command queue are applied at the start of each tick, so a command is acted on
+ *            within one tick period (TIME_TO_UPDATE - 1 ms) of being pushed, as long as this keeps up.
+ *            With GAIT_LOOKAHEAD, the calls between ticks plan the next ones ahead and a due tick sends out
+ *            the oldest planned one; a new command has the planned ticks planned again.
+ */
+void Quadruped::walk() {
+  uint8_t ticksDue = _scheduler.ticksDue();
+
+#if defined(GAIT_LOOKAHEAD)
+  // Commands are taken in here instead of when a tick is planned, so that the ticks that were planned without
+  // them can be planned again
+  if (_popCommands())
+    _isLookaheadStale = true;
+  if (_isLookaheadStale)
+    _flushLookahead();
+
+  if (ticksDue == 0) {
+    // Spare time; plan the next tick ahead, or finish the height table of gait parameters that were changed while walking
+    if (_lookaheadCount < GAIT_LOOKAHEAD_FRAMES)
+      _planFrame();
+    else
+      StepPlanner::buildHeightTable(&_gaitParameters, GAIT_TABLE_BUILD_STEP);
+    return;
+  }
+
+  // Every due tick takes the oldest planned one; it only has to be planned now if none are ready
+  while (ticksDue > 0) {
+#if defined(QUADRUPED_TELEMETRY)
+    unsigned long tickStart = micros();
+#endif
+    if (_lookaheadCount == 0) {
+      lookaheadUnderruns++;
+      _planFrame();
     }
+
+    const LookaheadFrame *planned = &_lookahead[_lookaheadTail];
+    memcpy(_outputAngles, planned->angles, sizeof(_outputAngles));
+    if ((_trajectoryRecorder != NULL) && !_trajectoryRecorder->record(planned->feet, planned->angles))
+      _trajectoryRecorder = NULL;
+#if defined(QUADRUPED_TELEMETRY)
+    if (_telemetry.tick())
+      _recordTelemetry(planned, tickStart);
+#endif
+
+    _lookaheadTail = (_lookaheadTail + 1) % GAIT_LOOKAHEAD_FRAMES;
+    _lookaheadCount--;
+    ticksDue--;
+  }
+#else
+  if (ticksDue == 0) {
+    // Spare time; finish the height table of gait parameters that were changed while walking
+    StepPlanner::buildHeightTable(&_gaitParameters, GAIT_TABLE_BUILD_STEP);
+    return;
+  }
+
+  while (ticksDue > 0) {
+    _runTick();
+    ticksDue--;
+  }
+#endif
+
+#if defined(QUADRUPED_DUAL_CORE)
+  // Hand the angles to the output core; only the final angles of the catch up ticks need to go out
+  JointFrame *frame = _jointFrames.writeFrame();
+  for (uint8_t motor = 0; motor < JOINT_FRAME_ANGLES; motor++) {
+#if defined(GAIT_LOOKAHEAD)
+    frame->angles[motor] = _outputAngles[motor];
+#else
+    frame->angles[motor] = _motors[motor].angleDegrees;
+#endif
+  }
+  _jointFrames.publish();
+
+#if defined(ESP32)
+  if (_outputTask != NULL)
+    xTaskNotifyGive(_outputTask);
+#endif
+#else
+  // Only the final angles of the catch up ticks need to go out
+  if (_servoOutput != NULL) {
+#if defined(GAIT_LOOKAHEAD)
+    _servoOutput->writeAngles(_outputAngles);
+#else
+    _servoOutput->update(STATIC_DEGREES);
+#endif
+  }
+#endif
+};
+
+/*!
+ *    @brief  Runs one control tick: applies the commands, then moves the gait (or the recording that is playing)
+ *            on by one tick and solves it
+ */
+void Quadruped::_runTick() {
+  PROFILE_START(PROFILE_WALK_TICK);
+#if defined(QUADRUPED_TELEMETRY) && !defined(GAIT_LOOKAHEAD)
+  unsigned long tickStart = micros();
+#endif
+  _applyCommands();
+  if (_trajectoryPlayer != NULL)
+    _playTick();
+  else
+    _tick(_controlCoordinateX, _controlCoordinateY);
+
+#if !defined(GAIT_LOOKAHEAD)
+  // With GAIT_LOOKAHEAD, the recorder and the telemetry get the ticks as they go out instead
+  if ((_trajectoryRecorder != NULL) && !_trajectoryRecorder->record(_feet, _motors))
+    _trajectoryRecorder = NULL;
+#if defined(QUADRUPED_TELEMETRY)
+  if (_telemetry.tick())
+    _recordTelemetry(tickStart);
+#endif
+#endif
+  PROFILE_END(PROFILE_WALK_TICK);
+}
+
+#if defined(GAIT_LOOKAHEAD)
+
+/*!
+ *    @brief  Plans the next tick into the lookahead ring, after saving the planner state it starts from
+ */
+void Quadruped::_planFrame() {
+  LookaheadFrame *frame = &_lookahead[(_lookaheadTail + _lookaheadCount) % GAIT_LOOKAHEAD_FRAMES];
+
+  for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++)
+    frame->legs[leg] = legStepPlanner[leg];
+  frame->bodyPhase = _gaitParameters.bodyPhase;
+  frame->robotMode = _robotMode;
+
+  GaitType gaitType = _gaitParameters.gaitType;
+  bool hadStagedGait = _gaitParameters.hasStagedGait;
+  bool isPlaying = (_trajectoryPlayer != NULL);
+
+  _runTick();
+
+  // The gaits aren't part of the saved state, and neither is where the recording is
+  frame->canReplan = !isPlaying && (_gaitParameters.gaitType == gaitType) && (_gaitParameters.hasStagedGait == hadStagedGait);
+
+  for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++)
+    frame->angles[motor] = _motors[motor].angleDegrees;
+  memcpy(frame->feet, _feet, sizeof(_feet));
+#if defined(QUADRUPED_TELEMETRY)
+  frame->tickRobotMode = _robotMode;
+  for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++)
+    frame->legModes[leg] = legStepPlanner[leg].legMode();
+#endif
+
+  _lookaheadCount++;
+}
+
+/*!
+ *    @brief  Throws the planned ticks away and puts the planner back to where it was before the first of them,
+ *            so that they are planned again with the latest commands. Ticks up to the last one that can't be
+ *            planned again (see LookaheadFrame) are kept.
+ */
+void Quadruped::_flushLookahead() {
+  _isLookaheadStale = false;
+
+  uint8_t kept = 0;
+  for (uint8_t index = 0; index < _lookaheadCount; index++) {
+    if (!_lookahead[(_lookaheadTail + index) % GAIT_LOOKAHEAD_FRAMES].canReplan)
+      kept = index + 1;
+  }
+  if (kept == _lookaheadCount)
+    return;
+
+  const LookaheadFrame *frame = &_lookahead[(_lookaheadTail + kept) % GAIT_LOOKAHEAD_FRAMES];
+  for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+    // The ground height input is the latest one from setGroundHeight(), not part of the planning; keep it
+    int16_t groundHeightInput = legStepPlanner[leg].groundHeightInput();
+    legStepPlanner[leg] = frame->legs[leg];
+    legStepPlanner[leg].setGroundHeight(groundHeightInput);
+#else
+    legStepPlanner[leg] = frame->legs[leg];
+#endif
   }
+  _gaitParameters.bodyPhase = frame->bodyPhase;
+  _robotMode = frame->robotMode;
+
+  // The motors go back to the last tick that is kept (or sent), so that anything that takes them before the next
+  // tick is planned, i.e. playTrajectory(), doesn't get the angles of the thrown away ticks
+  const int16_t *angles = (kept > 0) ? _lookahead[(_lookaheadTail + kept - 1) % GAIT_LOOKAHEAD_FRAMES].angles : _outputAngles;
+  for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++)
+    _motors[motor].angleDegrees = angles[motor];
+
+  // The next tick is solved even if the robot is standing, since the feet may be where the thrown away ticks left them
+  _isBodyPoseChanged = true;
+
+  _lookaheadCount = kept;
+  lookaheadFlushes++;
+}
+
+/*!
+ *    @return The motor angles (motor list order) that walk() sent out last
+ */
+const int16_t * Quadruped::outputAngles() {
+  return _outputAngles;
+}
+
+/*!
+ *    @return How many ticks are planned ahead
+ */
+uint8_t Quadruped::lookaheadFrames() {
+  return _lookaheadCount;
+}
+
+#endif
+
+/*!
+ *    @return true once startDualCoreTasks() runs walk() in its own task, where the setters can't safely reach it
+ */
+bool Quadruped::_isControlTaskRunning() {
+#if defined(QUADRUPED_DUAL_CORE) && defined(ESP32)
+  return _controlTask != NULL;
+#else
+  return false;
+#endif
+}
+
+/*!
+ *    @brief  Returns the scheduler that times the control loop, i.e. to read its overrun counters
+ */
+Scheduler * Quadruped::scheduler() {
+  return &_scheduler;
+}
+
+#if defined(QUADRUPED_DUAL_CORE)
+
+/*!
+ *    @brief  Writes the newest angles from walk() to the servos. This is the output half of the dual core
+ *            mode and runs on the other core than walk(); frames that walk() publishes faster than this
+ *            runs are skipped, it never waits for one.
+ *    @return false if there wasn't a new frame (or there is no ServoOutput)
+ */
+bool Quadruped::runOutput() {
+  const JointFrame *frame = _jointFrames.readFrame();
+  if ((frame == NULL) || (_servoOutput == NULL))
+    return false;
+
+  _servoOutput->writeAngles(frame->angles);
+  return true;
+}
+
+/*!
+ *    @brief  Returns the frames passed between the cores
+ */
+JointFrameBuffer * Quadruped::jointFrames() {
+  return &_jointFrames;
+}
+
+#if defined(ESP32)
+
+// Runs the gait at the control rate. Nothing else should call walk() once this is running; send it
+// commands through commandQueue().
+static void controlTask(void *robot) {
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;) {
+    ((Quadruped *)robot)->walk();
+    vTaskDelayUntil(&lastWake, 1);
+  }
+}
+
+// Writes each frame to the servos as soon as walk() has published it
+static void outputTask(void *robot) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    ((Quadruped *)robot)->runOutput();
+  }
+}
 
-#elif defined(STANDING_TROT)
+/*!
+ *    @brief  Starts the dual core mode on the ESP32: walk() (gait planning and kinematics) runs as a task on
+ *            DUAL_CORE_CONTROL_CORE, away from the WiFi/BLE stacks, and runOutput() (servo output) runs on
+ *            DUAL_CORE_OUTPUT_CORE whenever a new frame is ready. Call this after init() and setServoOutput().
+ *            From then on walk() can only be reached through commandQueue(): set the body pose, gait parameters,
+ *            ground heights, trajectories and telemetry settings up before this, since their setters are refused
+ *            (they return false) once the tasks are running.
+ *    @return false if the tasks couldn't be created
+ */
+bool Quadruped::startDualCoreTasks() {
+#if defined(QUADRUPED_TELEMETRY)
+  _telemetry.lockSettings();
+#endif
+  if (xTaskCreatePinnedToCore(outputTask, "quadOutput", DUAL_CORE_TASK_STACK, this,
+                              DUAL_CORE_OUTPUT_PRIORITY, &_outputTask, DUAL_CORE_OUTPUT_CORE) != pdPASS) {
+    _outputTask = NULL;
+    return false;
+  }
 
-  if (((controlCoordinateX != 0) || (controlCoordinateY != 0)) && (_robotMode == STATIC_STANDING)){
-    _setMode(WALKING);
-    for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++)
-      legStepPlanner[leg].reset();
+  if (xTaskCreatePinnedToCore(controlTask, "quadControl", DUAL_CORE_TASK_STACK, this,
+                              DUAL_CORE_CONTROL_PRIORITY, &_controlTask, DUAL_CORE_CONTROL_CORE) != pdPASS) {
+    _controlTask = NULL;
+    return false;
   }
 
-  if ((_robotMode == WALKING)) {
-    for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
-      if (legStepPlanner[leg].footAtOrigin()) {
-        legStepPlanner[leg].setStepEndpoint(controlCoordinateX, controlCoordinateY, _robotMode);
-      }
-      if (legStepPlanner[leg].update(_robotMode)) {
-        int16_t inputX = legStepPlanner[leg].dynamicFootPosition.x;
-        int16_t inputY = legStepPlanner[leg].dynamicFootPosition.y;
-        int16_t inputZ = legStepPlanner[leg].dynamicFootPosition.z;
+  return true;
+}
+
+#endif
+#endif
+
+#if defined(QUADRUPED_TELEMETRY)
+
+/*!
+ *    @brief  Returns the telemetry that walk() writes its snapshots into (see Telemetry), i.e. to drain() it
+ *            or to change the decimation and fields
+ */
+Telemetry * Quadruped::telemetry() {
+  return &_telemetry;
+}
+
+// How long a tick took (us), as the 16 bits telemetry has for it
+static uint16_t telemetryMicrosSince(unsigned long tickStart) {
+  unsigned long tickMicros = micros() - tickStart;
+  return (tickMicros > UINT16_MAX) ? UINT16_MAX : tickMicros;
+}
 
-        legKinematics[leg].setFootEndpoint(inputX, inputY, inputZ);
-      }
+#if defined(GAIT_LOOKAHEAD)
+/*!
+ *    @brief  Writes a telemetry frame for a planned tick as it goes out
+ *    @param  frame The tick
+ *    @param  tickStart micros() when walk() started sending it; the time includes planning it if it wasn't ready
+ */
+void Quadruped::_recordTelemetry(const LookaheadFrame *frame, unsigned long tickStart) {
+  _telemetry.record(frame->tickRobotMode, frame->legModes, frame->feet, frame->angles, telemetryMicrosSince(tickStart), &_scheduler);
+}
+#else
+/*!
+ *    @brief  Writes a telemetry frame for the tick that was just run
+ *    @param  tickStart micros() when the tick started
+ */
+void Quadruped::_recordTelemetry(unsigned long tickStart) {
+  LegMode legModes[ROBOT_LEG_COUNT];
+  for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++)
+    legModes[leg] = legStepPlanner[leg].legMode();
+
+  _telemetry.record(_robotMode, legModes, _feet, _motors, telemetryMicrosSince(tickStart), &_scheduler);
+}
+#endif
+
+#endif
+
+/*!
+ *    @brief  Returns the queue that walk() takes its commands from. Push to it from one place only
+ *            (i.e. the radio interrupt); see CommandQueue.
+ */
+CommandQueue * Quadruped::commandQueue() {
+  return &_commandQueue;
+}
+
+/*!
+ *    @brief  Applies the queued commands (see _popCommands()), then changes the gait if it is time to
+ */
+void Quadruped::_applyCommands() {
+#if !defined(GAIT_LOOKAHEAD)
+  // With GAIT_LOOKAHEAD, walk() takes them in before any tick is planned
+  _popCommands();
+#endif
+
+  StepPlanner::applyGaitChanges(&_gaitParameters, legStepPlanner, _requestedGait, _robotMode);
+}
+
+/*!
+ *    @brief  Takes every queued command off the queue, oldest first. Velocities replace the control input; the
+ *            step planners pick it up the next time each foot gets back to its origin. Gait changes
+ *            wait until the robot is standing.
+ *    @return true if the control input or the requested gait changed
+ */
+bool Quadruped::_popCommands() {
+  MotionCommand command;
+  int16_t controlCoordinateX = _controlCoordinateX;
+  int16_t controlCoordinateY = _controlCoordinateY;
+  GaitType requestedGait = _requestedGait;
+
+  while (_commandQueue.pop(&command)) {
+    switch (command.type) {
+      case COMMAND_VELOCITY:
+        _controlCoordinateX = command.velocity.x;
+        _controlCoordinateY = command.velocity.y;
+        break;
+      case COMMAND_GAIT:
+        if (command.gait < NUMBER_OF_GAITS)
+          _requestedGait = command.gait;
+        break;
+      case COMMAND_STAND:
+        _controlCoordinateX = 0;
+        _controlCoordinateY = 0;
+        break;
     }
   }
 
+  return (_controlCoordinateX != controlCoordinateX) || (_controlCoordinateY != controlCoordinateY) ||
+         (_requestedGait != requestedGait);
+}
+
+/*!
+ *    @brief  Changes the parameters of a gait while the robot runs, i.e. streamed in over serial to tune it. They
+ *            are staged; if the gait is running, every leg changes over at the start of the next gait cycle (a
+ *            new dutyFactor or phaseOffsets waits until the robot is standing), and the height table is built
+ *            for them between ticks. Changing them again before that replaces the staged ones. Call this from
+ *            the same place as walk(), not from an interrupt. With startDualCoreTasks(), walk() runs in its own
+ *            task, so this can only be called before the tasks are started.
+ *    @param  gaitType The gait to change
+ *    @param  gait Its new parameters
+ *    @return false if the gait type doesn't exist, or the dual core tasks are running
+ */
+bool Quadruped::setGaitParameters(GaitType gaitType, const Gait *gait) {
+  if ((gaitType >= NUMBER_OF_GAITS) || _isControlTaskRunning())
+    return false;
+
+  StepPlanner::stageGait(&_gaitParameters, gaitType, gait);
+#if defined(GAIT_LOOKAHEAD)
+  _isLookaheadStale = true;
+#endif
+  return true;
+}
+
+/*!
+ *    @return true while parameters given to setGaitParameters() are waiting to be swapped in
+ */
+bool Quadruped::isGaitParametersPending() {
+  return _gaitParameters.hasStagedGait;
+}
+
+/*!
+ *    @brief  The parameters a gait is running with; staged ones only show up here once they are swapped in
+ *    @param  gaitType The gait
+ *    @return The gait's parameters, or NULL if the gait type doesn't exist
+ */
+const Gait * Quadruped::getGait(GaitType gaitType) {
+  if (gaitType >= NUMBER_OF_GAITS)
+    return NULL;
+  return &_gaitParameters.gaits[gaitType];
+}
+
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+/*!
+ *    @brief  Sets the height of the ground under a leg, i.e. from a contact sensor or a local height map. The leg
+ *            takes it at the top of its next swing and its step is offset from it until the top of the one after
+ *            (see StepPlanner::setGroundHeight()). With GAIT_LOOKAHEAD, ticks that are already planned keep the
+ *            height they were planned with; the ones planned after this, including ticks planned again for a new
+ *            command, have the new one. Call this from the same place as walk(), not from an interrupt; with
+ *            startDualCoreTasks(), only before the tasks are started.
+ *    @param  leg The leg
+ *    @param  groundHeight The height (mm) compared to the ground that the robot height is measured from; positive
+ *            is higher, limited to +/- TERRAIN_MAX_HEIGHT
+ *    @return false if the leg doesn't exist, or the dual core tasks are running
+ */
+bool Quadruped::setGroundHeight(LegID leg, int16_t groundHeight) {
+  if ((leg < LEG_1) || (leg > ROBOT_LEG_COUNT) || _isControlTaskRunning())
+    return false;
+  legStepPlanner[leg - 1].setGroundHeight(groundHeight);
+  return true;
+}
+
+/*!
+ *    @param  leg The leg
+ *    @return The ground height the leg's current step is using (mm)
+ */
+int16_t Quadruped::groundHeight(LegID leg) {
+  if ((leg < LEG_1) || (leg > ROBOT_LEG_COUNT))
+    return 0;
+  return legStepPlanner[leg - 1].groundHeight();
+}
+#endif
+
+/*!
+ *    @brief  Has walk() write the motor angles out through a ServoOutput every time it runs the gait
+ *    @param  servoOutput The output (already set up with the same motors), or NULL to stop
+ */
+void Quadruped::setServoOutput(ServoOutput *servoOutput) {
+  _servoOutput = servoOutput;
+}
+
+/*!
+ *    @brief  Records every control tick from now on: the foot positions that were solved and the motor angles.
+ *            It stops by itself when the recorder is full. Call this from the same place as walk(); with
+ *            startDualCoreTasks(), only before the tasks are started.
+ *    @param  recorder  A recorder that has been begun, or NULL to stop recording
+ *    @return false if the dual core tasks are running
+ */
+bool Quadruped::setTrajectoryRecorder(TrajectoryRecorder *recorder) {
+  if (_isControlTaskRunning())
+    return false;
+  _trajectoryRecorder = recorder;
+  return true;
+}
+
+/*!
+ *    @brief  Plays a recording, one frame every control tick, instead of running the gait. The motor angles come
+ *            straight from the recording so nothing is solved. The gait is paused where it is and carries on when
+ *            the recording ends (the motors go back to where it left them), so recordings should start and end
+ *            in the pose the robot is in when they are played, i.e. standing. Call this from the same place as
+ *            walk(); with startDualCoreTasks(), only before the tasks are started.
+ *    @param  player  A player that has been begun, or NULL to stop playing now
+ *    @return false if the dual core tasks are running
+ */
+bool Quadruped::playTrajectory(TrajectoryPlayer *player) {
+  if (_isControlTaskRunning())
+    return false;
+#if defined(GAIT_LOOKAHEAD)
+  // The recording starts (or stops) with the next tick that goes out, not after the ones planned ahead
+  _flushLookahead();
+#endif
+  _setTrajectoryPlayer(player);
+  return true;
+}
+
+/*!
+ *    @brief  Starts or stops playing a recording from the next tick that is run
+ *    @param  player  A player that has been begun, or NULL to go back to the gait
+ */
+void Quadruped::_setTrajectoryPlayer(TrajectoryPlayer *player) {
+  if ((player != NULL) && (_trajectoryPlayer == NULL)) {
+    for (uint8_t motor = 0; motor < TRAJECTORY_ANGLES; motor++)
+      _gaitAngles[motor] = _motors[motor].angleDegrees;
+  }
+  else if ((player == NULL) && (_trajectoryPlayer != NULL)) {
+    for (uint8_t motor = 0; motor < TRAJECTORY_ANGLES; motor++)
+      _motors[motor].angleDegrees = _gaitAngles[motor];
+  }
+  _trajectoryPlayer = player;
+}
+
+/*!
+ *    @return true while a recording is playing
+ */
+bool Quadruped::isPlayingTrajectory() {
+  return _trajectoryPlayer != NULL;
+}
+
+/*!
+ *    @brief  One tick of playing a recording: moves the motors to the next frame, or back to the gait at the end
+ */
+void Quadruped::_playTick() {
+  int16_t angles[TRAJECTORY_ANGLES];
+  if (!_trajectoryPlayer->next(_feet, angles)) {
+    _setTrajectoryPlayer(NULL);
+    return;
+  }
+
+  for (uint8_t motor = 0; motor < TRAJECTORY_ANGLES; motor++)
+    _motors[motor].angleDegrees = angles[motor];
+}
+
+/*!
+ *    @brief  One tick of the control loop: updates every leg's step by one position and solves it
+ *    @param  controlCoordinateX x direction of the controller (joystick) coordinate
+ *    @param  controlCoordinateY y direction of the controller (joystick) coordinate
+ */
+void Quadruped::_tick(int16_t controlCoordinateX, int16_t controlCoordinateY) {
 
+  _setMode(StepPlanner::changeRobotMode(&_gaitParameters, legStepPlanner, _robotMode, controlCoordinateX, controlCoordinateY));
+
+  // A standing robot only has to move if the body pose changed
+  if ((_robotMode == STATIC_STANDING) && !_isBodyPoseChanged)
+    return;
+  _isBodyPoseChanged = false;
+
+  // Every leg follows the shared body phase; the robot is standing still after this once every leg has stopped
+  ROBOT_MODE robotMode = _robotMode;
+  StepPlanner::stepLegs(&_gaitParameters, legStepPlanner, &_stepDirection, controlCoordinateX, controlCoordinateY, &robotMode);
+  _setMode(robotMode);
+
+  for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++)
+    _feet[leg] = legStepPlanner[leg].dynamicFootPosition;
+
+  // All four feet are moved by the body pose in one pass, then solved
+  if (_hasBodyPose)
+    _applyBodyPose(_feet);
+
+  for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+#if defined(PROJECT_UNREACHABLE_FEET)
+    _projectFoot(&_feet[leg]);
 #endif
+    int16_t inputX = _feet[leg].x;
+    int16_t inputY = _feet[leg].y;
+    int16_t inputZ = _feet[leg].z;
 
+    legKinematics[leg].setFootEndpoint(inputX, inputY, inputZ);
+  }
 };
 
+/*!
+ *    @brief  Tilts, turns and shifts the body while the feet stay where they are. The rotation is worked out
+ *            here, once, and every tick after this moves all four feet by it (standing or walking). Call this from
+ *            the same place as walk(); with startDualCoreTasks(), only before the tasks are started.
+ *    @param  rotation Roll (about the forwards axis), pitch (about the side to side axis) and yaw (about the
+ *            vertical axis) of the body in degrees
+ *    @param  translation How far to move the body (mm): x forwards, y to the left and z up
+ *    @return false if the dual core tasks are running
+ */
+bool Quadruped::setBodyPose(const BodyRotation *rotation, const Coordinate *translation) {
+  if (_isControlTaskRunning())
+    return false;
+
+  float roll = rotation->roll * DEG_TO_RAD_F;
+  float pitch = rotation->pitch * DEG_TO_RAD_F;
+  float yaw = rotation->yaw * DEG_TO_RAD_F;
+
+  float sinRoll = sinf(roll), cosRoll = cosf(roll);
+  float sinPitch = sinf(pitch), cosPitch = cosf(pitch);
+  float sinYaw = sinf(yaw), cosYaw = cosf(yaw);
+
+  // The body rotation is yaw * pitch * roll. The feet stay put, so in body coordinates they move by the
+  // inverse of it, which is the transpose.
+  _bodyRotation[0][0] = cosYaw * cosPitch;
+  _bodyRotation[1][0] = (cosYaw * sinPitch * sinRoll) - (sinYaw * cosRoll);
+  _bodyRotation[2][0] = (cosYaw * sinPitch * cosRoll) + (sinYaw * sinRoll);
+  _bodyRotation[0][1] = sinYaw * cosPitch;
+  _bodyRotation[1][1] = (sinYaw * sinPitch * sinRoll) + (cosYaw * cosRoll);
+  _bodyRotation[2][1] = (sinYaw * sinPitch * cosRoll) - (cosYaw * sinRoll);
+  _bodyRotation[0][2] = -sinPitch;
+  _bodyRotation[1][2] = cosPitch * sinRoll;
+  _bodyRotation[2][2] = cosPitch * cosRoll;
+
+  _bodyTranslation = *translation;
+
+  _hasBodyPose = (rotation->roll != 0) || (rotation->pitch != 0) || (rotation->yaw != 0) ||
+                 (translation->x != 0) || (translation->y != 0) || (translation->z != 0);
+  _isBodyPoseChanged = true;
+#if defined(GAIT_LOOKAHEAD)
+  _isLookaheadStale = true;
+#endif
+  return true;
+}
+
+/*!
+ *    @brief  Moves every foot by the body pose. The feet are turned into body coordinates (from the middle of
+ *            the body: x forwards, y to the left, z up) using where each shoulder is, moved, and turned back.
+ *    @param  feet The foot position for each leg (LEG_1 first) as the step planners give them; changed in place
+ */
+void Quadruped::_applyBodyPose(Coordinate feet[ROBOT_LEG_COUNT]) {
+  // LEG_1 and LEG_2 are at the front, LEG_2 and LEG_3 on the left. A foot's y is outwards from its shoulder
+  // and its z is down from it.
+  static const float shoulderX[ROBOT_LEG_COUNT] = { BODY_LENGTH / 2.0, BODY_LENGTH / 2.0, -BODY_LENGTH / 2.0, -BODY_LENGTH / 2.0 };
+  static const float shoulderY[ROBOT_LEG_COUNT] = { -BODY_WIDTH / 2.0, BODY_WIDTH / 2.0, BODY_WIDTH / 2.0, -BODY_WIDTH / 2.0 };
+  static const int8_t outwards[ROBOT_LEG_COUNT] = { -1, 1, 1, -1 };
+
+  for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+    float bodyX = shoulderX[leg] + feet[leg].x - _bodyTranslation.x;
+    float bodyY = shoulderY[leg] + (outwards[leg] * feet[leg].y) - _bodyTranslation.y;
+    float bodyZ = -feet[leg].z - _bodyTranslation.z;
+
+    float movedX = (_bodyRotation[0][0] * bodyX) + (_bodyRotation[0][1] * bodyY) + (_bodyRotation[0][2] * bodyZ);
+    float movedY = (_bodyRotation[1][0] * bodyX) + (_bodyRotation[1][1] * bodyY) + (_bodyRotation[1][2] * bodyZ);
+    float movedZ = (_bodyRotation[2][0] * bodyX) + (_bodyRotation[2][1] * bodyY) + (_bodyRotation[2][2] * bodyZ);
+
+    feet[leg].x = lrintf(movedX - shoulderX[leg]);
+    feet[leg].y = lrintf(outwards[leg] * (movedY - shoulderY[leg]));
+    feet[leg].z = lrintf(-movedZ);
+  }
+}
+
+/*!
+ *    @brief  Solves the motor angles for all four feet at once without touching the live
+ *            motor angles. Useful when the whole body is moved each frame.
+ *    @param  feet The foot position for each leg (LEG_1 first), in the same coordinates as
+ *            Kinematics::setFootEndpoint()
+ *    @param  anglesOut Output for the 12 motor angles, ordered by leg then by motor
+ *            i.e. anglesOut[(leg - 1) * MOTORS_PER_LEG + (motor - 1)]
+ */
+void Quadruped::solveAllLegs(const Coordinate feet[ROBOT_LEG_COUNT], int16_t anglesOut[ROBOT_LEG_COUNT * MOTORS_PER_LEG]) {
+  for (int8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+    Coordinate foot = feet[leg];
+#if defined(PROJECT_UNREACHABLE_FEET)
+    _projectFoot(&foot);
+#endif
+    int16_t inputX = foot.x;
+    int16_t inputY = foot.y;
+    int16_t inputZ = foot.z;
+
+    // Set inputY = 0 to under the shoulder
+    inputY += LIMB_1;
+
+    int16_t * legAngles = &anglesOut[leg * MOTORS_PER_LEG];
+    legKinematics[leg].solveFootPosition(inputX, inputY, inputZ, &legAngles[M1 - 1], &legAngles[M2 - 1], &legAngles[M3 - 1]);
+  }
+}
+
+#if defined(PROJECT_UNREACHABLE_FEET)
+/*!
+ *    @brief  Moves a foot position that can't be reached to a reachable one close by (PROJECT_UNREACHABLE_FEET)
+ *    @param  foot The foot position (Kinematics::setFootEndpoint() coordinates); changed in place
+ */
+void Quadruped::_projectFoot(Coordinate *foot) {
+  int16_t nearestX, nearestY, nearestZ;
+  if (Kinematics::checkReachability(foot->x, foot->y, foot->z, &nearestX, &nearestY, &nearestZ) == FOOT_REACHABLE)
+    return;
+
+  foot->x = nearestX;
+  foot->y = nearestY;
+  foot->z = nearestZ;
+  unreachableFeet++;
+}
+#endif
+
 LegID Quadruped::_enumFromIndex(int8_t index) {
   if (index == 0) return LEG_1;
   else if (index == 1) return LEG_2;
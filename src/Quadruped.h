@@ -2,10 +2,50 @@
 #define QUADRUPED_H
 
 #include <Arduino.h>
-#include "stepPlanner.h"
+#include "StepPlanner.h"
 #include "Kinematics.h"
+#include "Scheduler.h"
+#include "ServoOutput.h"
+#include "CommandQueue.h"
+#include "JointFrameBuffer.h"
+#include "Trajectory.h"
+#include "Telemetry.h"
 #include "quadruped-config.h"
 
+// Roll, pitch and yaw of the body (degrees); see Quadruped::setBodyPose()
+typedef struct {
+  float roll;
+  float pitch;
+  float yaw;
+} BodyRotation;
+
+// The scheduler runs every TIME_TO_UPDATE - 1 ms, so that has to be at least 1
+#if (TIME_TO_UPDATE < 2)
+#error TIME_TO_UPDATE has to be at least 2
+#endif
+
+#if defined(GAIT_LOOKAHEAD)
+#if (GAIT_LOOKAHEAD_FRAMES < 1) || (GAIT_LOOKAHEAD_FRAMES > 64)
+#error GAIT_LOOKAHEAD_FRAMES has to be from 1 to 64
+#endif
+
+// A control tick that walk() planned ahead of time (GAIT_LOOKAHEAD), along with the planner state from just before
+// it was planned so that it can be planned again
+typedef struct {
+  int16_t angles[ROBOT_LEG_COUNT * MOTORS_PER_LEG];   // the motor angles to send out, in motor list order
+  Coordinate feet[ROBOT_LEG_COUNT];                   // the foot positions that were solved for them
+  bool canReplan;           // false if the gait changed or a recording played in this tick, which can't be undone
+#if defined(QUADRUPED_TELEMETRY)
+  ROBOT_MODE tickRobotMode;                           // the modes the tick left the robot and legs in
+  LegMode legModes[ROBOT_LEG_COUNT];
+#endif
+
+  StepPlanner legs[ROBOT_LEG_COUNT];
+  uint16_t bodyPhase;
+  ROBOT_MODE robotMode;
+} LookaheadFrame;
+#endif
+
 class Quadruped {
   public:
     Quadruped();
@@ -13,18 +53,157 @@ class Quadruped {
     void init(int16_t inputX, int16_t inputY, int16_t inputZ, Motor legMotors[]);
 
     void walk(int16_t controlCoordinateX, int16_t controlCoordinateY);
+
+    // runs the gait with the commands from commandQueue() instead of a control coordinate
+    void walk();
+
+    // queue for motion commands, i.e. pushed from a radio interrupt; walk() applies them at the start of every tick
+    CommandQueue * commandQueue();
+
+    // changes the parameters of a gait, i.e. to tune it over serial; the running gait takes them at the start of its
+    // next cycle without stopping (a new dutyFactor or phaseOffsets waits until it stands)
+    // This and the other setters below that change what walk() runs with return false once startDualCoreTasks()
+    // has started walk() in its own task, since they can't be called from there
+    bool setGaitParameters(GaitType gaitType, const Gait *gait);
+    bool isGaitParametersPending();
+
+    // the parameters a gait is running with
+    const Gait * getGait(GaitType gaitType);
+
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+    // the height of the ground under each leg (mm, up is positive); every leg takes it once per step
+    bool setGroundHeight(LegID leg, int16_t groundHeight);
+    int16_t groundHeight(LegID leg);
+#endif
+
+    // solves all four legs in one pass; anglesOut holds M1, M2, M3 for LEG_1, then LEG_2, etc.
+    void solveAllLegs(const Coordinate feet[ROBOT_LEG_COUNT], int16_t anglesOut[ROBOT_LEG_COUNT * MOTORS_PER_LEG]);
     bool justSetEndpoint = false;
 
+#if defined(PROJECT_UNREACHABLE_FEET)
+    // foot positions that were outside of the workspace and moved into it before solving
+    uint32_t unreachableFeet = 0;
+#endif
+
+    Scheduler * scheduler();
+
+    // tilts, turns and shifts the body from where the gait puts it; the feet stay where they are
+    bool setBodyPose(const BodyRotation *rotation, const Coordinate *translation);
+
+    // after this, walk() writes the motor angles to the servos whenever it has updated them
+    // (with QUADRUPED_DUAL_CORE, runOutput() does instead)
+    void setServoOutput(ServoOutput *servoOutput);
+
+    // records the feet and motor angles of every tick until the recorder is full (NULL to stop)
+    bool setTrajectoryRecorder(TrajectoryRecorder *recorder);
+
+    // plays a recording (already begun) instead of running the gait, then goes back to the gait
+    bool playTrajectory(TrajectoryPlayer *player);
+    bool isPlayingTrajectory();
+
+#if defined(GAIT_LOOKAHEAD)
+    // The motors' angleDegrees are where the planning is, up to GAIT_LOOKAHEAD_FRAMES ticks ahead; these are the
+    // angles that went out last
+    const int16_t * outputAngles();
+    uint8_t lookaheadFrames();          // ticks planned ahead right now
+
+    uint32_t lookaheadUnderruns = 0;    // ticks that had to be planned when they were due because none were ready
+    uint32_t lookaheadFlushes = 0;      // times the planned ticks were thrown away for a new command
+#endif
+
+#if defined(QUADRUPED_TELEMETRY)
+    // the snapshots walk() writes every tick (or every few); read them out from loop() or a DMA transfer
+    Telemetry * telemetry();
+#endif
+
+#if defined(QUADRUPED_DUAL_CORE)
+    // Output side of the dual core mode: writes the newest frame from walk() to the servos. Call this
+    // from the other core (loop1() on the RP2040); false if there was no new frame.
+    bool runOutput();
+
+    // the frames passed from walk() to runOutput(), i.e. to read the skipped frame and latency counters
+    JointFrameBuffer * jointFrames();
+
+#if defined(ESP32)
+    // starts walk() (with the command queue) and runOutput() as tasks pinned to their own cores; set the body pose,
+    // gait parameters, ground heights, trajectories and telemetry settings up before this
+    bool startDualCoreTasks();
+#endif
+#endif
+
   private:
 
     void _setMode(ROBOT_MODE robotMode);
+    void _tick(int16_t controlCoordinateX, int16_t controlCoordinateY);
+    void _applyCommands();
+    bool _popCommands();
+    void _runTick();
+    void _setTrajectoryPlayer(TrajectoryPlayer *player);
+    void _applyBodyPose(Coordinate feet[ROBOT_LEG_COUNT]);
+    void _playTick();
+    bool _isControlTaskRunning();
+#if defined(PROJECT_UNREACHABLE_FEET)
+    void _projectFoot(Coordinate *foot);
+#endif
     LegID _enumFromIndex(int8_t index);
 
+    GaitParameters _gaitParameters;   // shared by every leg's StepPlanner
+
     StepPlanner legStepPlanner[ROBOT_LEG_COUNT];
     Kinematics  legKinematics[ROBOT_LEG_COUNT];
+    Coordinate _feet[ROBOT_LEG_COUNT];   // the foot positions that were solved last
 
     ROBOT_MODE _robotMode;
 
+    Scheduler _scheduler;
+
+    float _bodyRotation[3][3];      // the inverse of the body rotation
+    Coordinate _bodyTranslation;
+    bool _hasBodyPose;              // false if the pose does nothing
+    bool _isBodyPoseChanged;        // the feet have to be solved again, even when standing
+
+    ServoOutput * _servoOutput;
+    Motor * _motors;
+
+    CommandQueue _commandQueue;
+    int16_t _controlCoordinateX;    // the latest control input, from walk() or the command queue
+    int16_t _controlCoordinateY;
+    StepDirection _stepDirection;   // the control input normalized for the step planners
+    GaitType _requestedGait;        // the gait can only change while standing, so a gait command waits here
+
+#if defined(QUADRUPED_TELEMETRY)
+    Telemetry _telemetry;
+#if defined(GAIT_LOOKAHEAD)
+    void _recordTelemetry(const LookaheadFrame *frame, unsigned long tickStart);
+#else
+    void _recordTelemetry(unsigned long tickStart);
+#endif
+#endif
+
+    TrajectoryRecorder * _trajectoryRecorder;
+    TrajectoryPlayer * _trajectoryPlayer;
+    int16_t _gaitAngles[TRAJECTORY_ANGLES];   // where the gait left the motors when the recording started playing
+
+#if defined(GAIT_LOOKAHEAD)
+    LookaheadFrame _lookahead[GAIT_LOOKAHEAD_FRAMES];   // ring of the ticks planned ahead
+    uint8_t _lookaheadTail;         // the next one to go out
+    uint8_t _lookaheadCount;
+    bool _isLookaheadStale;         // a command came in that the planned ticks don't have yet
+    int16_t _outputAngles[ROBOT_LEG_COUNT * MOTORS_PER_LEG];
+
+    void _planFrame();
+    void _flushLookahead();
+#endif
+
+#if defined(QUADRUPED_DUAL_CORE)
+    JointFrameBuffer _jointFrames;
+
+#if defined(ESP32)
+    TaskHandle_t _controlTask;
+    TaskHandle_t _outputTask;
+#endif
+#endif
+
 };
 
 
@@ -0,0 +1,66 @@
+#ifndef ROBOT_GEOMETRY_H
+#define ROBOT_GEOMETRY_H
+
+#include <Arduino.h>
+#include "quadruped-config.h"
+
+// Whether a foot position can be solved (see BasicKinematics::checkReachability())
+typedef enum {
+  FOOT_REACHABLE = 0,
+  FOOT_INSIDE_LIMB_1,   // closer to the motor 1 axis than LIMB_1 on the y-z plane
+  FOOT_TOO_CLOSE,       // the foot-shoulder length is under SHOULDER_FOOT_MIN
+  FOOT_TOO_FAR          // the foot-shoulder length is over SHOULDER_FOOT_MAX
+} Reachability;
+
+// The size of a leg as compile time constants, so that Kinematics (BasicKinematics) can be built for it with
+// every term that only depends on the limbs folded into a constant. The limits are checked when it is used.
+// Lengths are in mm; see quadruped-config.h.
+template <int16_t limb1Length, int16_t limb2Length, int16_t limb3Length, int16_t shoulderFootMinLength, int16_t shoulderFootMaxLength>
+struct RobotGeometry {
+  static constexpr int16_t limb1 = limb1Length;
+  static constexpr int16_t limb2 = limb2Length;
+  static constexpr int16_t limb3 = limb3Length;
+
+  // shoulder to foot length constraints
+  static constexpr int16_t shoulderFootMin = shoulderFootMinLength;
+  static constexpr int16_t shoulderFootMax = shoulderFootMaxLength;
+
+  // Law of Cosines terms for the knee
+  static constexpr float kneeSidesSquared = (float)limb2 * limb2 + (float)limb3 * limb3;
+  static constexpr float kneeSidesProduct = (float)2 * limb2 * limb3;
+  static constexpr float straightSquared = (float)(limb2 + limb3) * (limb2 + limb3);   // foot-shoulder length^2 with the leg straight
+
+  // The same for the fixed point solve (FIXED_POINT_KINEMATICS)
+  static constexpr int32_t fixedLimb1Squared = (int32_t)limb1 * limb1;
+  static constexpr int32_t fixedKneeSidesSquared = (int32_t)limb2 * limb2 + (int32_t)limb3 * limb3;
+  static constexpr int32_t fixedKneeSidesProduct = (int32_t)2 * limb2 * limb3;
+
+  // Squared foot-shoulder length limits for the reachability test (BasicKinematics::checkReachability)
+  static constexpr int32_t shoulderFootMinSquared = (int32_t)shoulderFootMin * shoulderFootMin;
+  static constexpr int32_t shoulderFootMaxSquared = (int32_t)shoulderFootMax * shoulderFootMax;
+
+  static_assert((limb1 > 0) && (limb2 > 0) && (limb3 > 0), "The limb lengths have to be more than 0");
+  static_assert(shoulderFootMin < shoulderFootMax, "SHOULDER_FOOT_MIN has to be less than SHOULDER_FOOT_MAX");
+  static_assert(shoulderFootMax <= limb2 + limb3, "SHOULDER_FOOT_MAX is longer than the leg can stretch (LIMB_2 + LIMB_3)");
+  static_assert(shoulderFootMin >= ((limb2 > limb3) ? (limb2 - limb3) : (limb3 - limb2)), "SHOULDER_FOOT_MIN is shorter than the leg can fold");
+};
+
+// Definitions so that the constants can also be passed by reference
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int16_t RobotGeometry<l1, l2, l3, fMin, fMax>::limb1;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int16_t RobotGeometry<l1, l2, l3, fMin, fMax>::limb2;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int16_t RobotGeometry<l1, l2, l3, fMin, fMax>::limb3;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int16_t RobotGeometry<l1, l2, l3, fMin, fMax>::shoulderFootMin;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int16_t RobotGeometry<l1, l2, l3, fMin, fMax>::shoulderFootMax;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr float RobotGeometry<l1, l2, l3, fMin, fMax>::kneeSidesSquared;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr float RobotGeometry<l1, l2, l3, fMin, fMax>::kneeSidesProduct;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr float RobotGeometry<l1, l2, l3, fMin, fMax>::straightSquared;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int32_t RobotGeometry<l1, l2, l3, fMin, fMax>::fixedLimb1Squared;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int32_t RobotGeometry<l1, l2, l3, fMin, fMax>::fixedKneeSidesSquared;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int32_t RobotGeometry<l1, l2, l3, fMin, fMax>::fixedKneeSidesProduct;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int32_t RobotGeometry<l1, l2, l3, fMin, fMax>::shoulderFootMinSquared;
+template <int16_t l1, int16_t l2, int16_t l3, int16_t fMin, int16_t fMax> constexpr int32_t RobotGeometry<l1, l2, l3, fMin, fMax>::shoulderFootMaxSquared;
+
+// The robot from quadruped-config.h; Kinematics is built for this one
+typedef RobotGeometry<LIMB_1, LIMB_2, LIMB_3, SHOULDER_FOOT_MIN, SHOULDER_FOOT_MAX> DefaultGeometry;
+
+#endif
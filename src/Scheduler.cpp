@@ -0,0 +1,54 @@
+#include "Scheduler.h"
+
+Scheduler::Scheduler(void) {};
+
+/*!
+ *    @brief Sets the period of the scheduler and starts it
+ *    @param period The time between ticks in milliseconds; 0 is taken as 1
+*/
+void Scheduler::init(uint16_t period) {
+  // ticksDue() divides by it
+  _period = (period > 0) ? period : 1;
+  reset();
+}
+
+/*!
+ *    @brief Restarts the scheduler (the first tick is due one period from now) and clears the counters
+*/
+void Scheduler::reset() {
+  _nextDeadline = millis() + _period;
+
+  tickCount = 0;
+  overrunCount = 0;
+  droppedTickCount = 0;
+}
+
+/*!
+ *    @brief Checks how many ticks are due. This never waits, so it should be called as often as possible
+             (every loop) and the returned number of ticks run straight away.
+ *    @returns The number of ticks to run now. If the caller has fallen more than SCHEDULER_MAX_CATCH_UP_TICKS
+             behind, the extra ticks are dropped (and counted) so that it can't get stuck catching up.
+*/
+uint8_t Scheduler::ticksDue() {
+  unsigned long now = millis();
+
+  // this is safe across the millis() overflow as long as it's called at least once every ~24 days
+  if ((long)(now - _nextDeadline) < 0)
+    return 0;
+
+  unsigned long due = ((now - _nextDeadline) / _period) + 1;
+
+  // Keep the deadlines on the same grid even when ticks are dropped
+  _nextDeadline += due * _period;
+
+  if (due > 1)
+    overrunCount++;
+
+  if (due > SCHEDULER_MAX_CATCH_UP_TICKS) {
+    droppedTickCount += due - SCHEDULER_MAX_CATCH_UP_TICKS;
+    due = SCHEDULER_MAX_CATCH_UP_TICKS;
+  }
+
+  tickCount += due;
+  return due;
+}
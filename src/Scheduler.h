@@ -0,0 +1,30 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "quadruped-config.h"
+
+// Fixed rate scheduler for the control loop. Deadlines are kept on a fixed grid (each one is exactly one
+// period after the last), so lateness doesn't accumulate; it never waits, it only reports the ticks that are due.
+class Scheduler {
+
+  public:
+    Scheduler();
+
+    void init(uint16_t period);
+    void reset();
+
+    // how many ticks should be run right now (0 if it isn't time yet)
+    uint8_t ticksDue();
+
+    uint32_t tickCount;         // ticks handed out by ticksDue()
+    uint32_t overrunCount;      // calls to ticksDue() that found a deadline had been missed (more than one tick due)
+    uint32_t droppedTickCount;  // ticks skipped because more than SCHEDULER_MAX_CATCH_UP_TICKS were due
+
+  private:
+    uint16_t _period;
+    unsigned long _nextDeadline;
+
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "ServoOutput.h"
+
+ServoOutput::ServoOutput(void) {};
+
+/*!
+ *    @brief  Sets up the output for a list of motors. Nothing is written until the first update.
+ *    @param  motors      The list of motors (the same one given to Quadruped::init)
+ *    @param  motorCount  How many motors are in the list (at most SERVO_OUTPUT_MAX_MOTORS)
+ *    @param  driver      What writes the pulse widths; the motor's controlPin is its channel
+ */
+void ServoOutput::init(Motor motors[], uint8_t motorCount, ServoDriver *driver) {
+  _motors = motors;
+  _motorCount = min(motorCount, (uint8_t)SERVO_OUTPUT_MAX_MOTORS);
+  _driver = driver;
+
+  for (uint8_t motor = 0; motor < _motorCount; motor++) {
+    _channels[motor] = _motors[motor].controlPin;
+    _pulseWidths[motor] = 0;
+#if defined(SERVO_PULSE_TABLES)
+    _curves[motor] = NULL;
+#endif
+  }
+
+#if defined(SERVO_PULSE_TABLES)
+  recalibrate();
+#endif
+
+  updateCount = 0;
+  motorWriteCount = 0;
+
+  invalidate();
+}
+
+/*!
+ *    @brief  Makes the next update write every motor, whether it changed or not
+ */
+void ServoOutput::invalidate() {
+  _isWritten = false;
+}
+
+/*!
+ *    @brief  Works out the pulse widths for every motor and writes the ones that changed in one go
+ *    @param  source  Whether to send the angleDegrees or the dynamicDegrees of the motors
+ */
+void ServoOutput::update(ServoAngleSource source) {
+  int16_t angles[SERVO_OUTPUT_MAX_MOTORS];
+
+  for (uint8_t motor = 0; motor < _motorCount; motor++)
+    angles[motor] = (source == DYNAMIC_DEGREES) ? _motors[motor].dynamicDegrees : _motors[motor].angleDegrees;
+
+  writeAngles(angles);
+}
+
+/*!
+ *    @brief  Works out the pulse widths for a set of angles and writes the ones that changed in one go.
+ *            Only the offsets and limits of the motors are used, so the angles can come from a copy.
+ *    @param  angles  The calculated angle of each motor (degrees), in the same order as the motor list
+ */
+void ServoOutput::writeAngles(const int16_t angles[]) {
+  uint16_t changedMotors = 0;
+
+  for (uint8_t motor = 0; motor < _motorCount; motor++) {
+    uint16_t pulseWidth = _pulseWidthOf(motor, angles[motor]);
+
+    if (!_isWritten || (pulseWidth != _pulseWidths[motor])) {
+      _pulseWidths[motor] = pulseWidth;
+      changedMotors |= (1U << motor);
+      motorWriteCount++;
+    }
+  }
+
+  _isWritten = true;
+
+  if (changedMotors == 0)
+    return;
+
+  _driver->writePulseWidths(_channels, _pulseWidths, changedMotors);
+  updateCount++;
+}
+
+/*!
+ *    @param  motor The index of the motor in the list
+ *    @return The pulse width that was last written to the motor (microseconds)
+ */
+uint16_t ServoOutput::pulseWidth(uint8_t motor) {
+  return _pulseWidths[motor];
+}
+
+#if defined(SERVO_PULSE_TABLES)
+
+/*!
+ *    @brief  Rebuilds every motor's pulse table from its offsets, limits and correction curve, and
+ *            writes every motor on the next update
+ */
+void ServoOutput::recalibrate() {
+  for (uint8_t motor = 0; motor < _motorCount; motor++)
+    _buildPulseTable(motor);
+
+  invalidate();
+}
+
+/*!
+ *    @brief  Sets the bench measured correction curve of a motor and rebuilds its pulse table
+ *    @param  motor The index of the motor in the list
+ *    @param  curve The measurements (they aren't copied, so they have to stay around), or NULL to use
+ *                  the linear map from SERVO_MIN_PULSE_WIDTH to SERVO_MAX_PULSE_WIDTH
+ */
+void ServoOutput::setCorrectionCurve(uint8_t motor, const ServoCorrectionCurve *curve) {
+  if (motor >= _motorCount)
+    return;
+
+  _curves[motor] = ((curve != NULL) && (curve->pointCount >= 2)) ? curve : NULL;
+  _buildPulseTable(motor);
+
+  invalidate();
+}
+
+/*!
+ *    @brief  Fills in the pulse width for every servo angle of a motor
+ *    @param  motor The index of the motor in the list
+ */
+void ServoOutput::_buildPulseTable(uint8_t motor) {
+  _angleOffsets[motor] = (int16_t)_motors[motor].calibOffset + (int16_t)_motors[motor].applicationOffset;
+
+  for (int16_t servoAngle = 0; servoAngle <= SERVO_RANGE_DEGREES; servoAngle++)
+    _pulseTables[motor][servoAngle] = _calculatePulseWidth(motor, servoAngle);
+}
+
+/*!
+ *    @brief  Looks up the pulse width for a calculated angle
+ *    @param  motor The index of the motor in the list
+ *    @param  angle The calculated angle (degrees)
+ *    @return The pulse width (microseconds)
+ */
+uint16_t ServoOutput::_pulseWidthOf(uint8_t motor, int16_t angle) {
+  int16_t servoAngle = constrain((int16_t)(angle + _angleOffsets[motor]), (int16_t)0, (int16_t)SERVO_RANGE_DEGREES);
+  return _pulseTables[motor][servoAngle];
+}
+
+#else
+
+/*!
+ *    @brief  Converts a calculated angle to a servo pulse width
+ *    @param  motor The index of the motor in the list
+ *    @param  angle The calculated angle (degrees)
+ *    @return The pulse width (microseconds)
+ */
+uint16_t ServoOutput::_pulseWidthOf(uint8_t motor, int16_t angle) {
+  const Motor *output = &_motors[motor];
+  return _calculatePulseWidth(motor, angle + (int16_t)output->calibOffset + (int16_t)output->applicationOffset);
+}
+
+#endif
+
+/*!
+ *    @brief  Converts a servo angle (the calculated angle put in context with the calibration and
+ *            application offsets) to a pulse width. The angle is kept within minPos and maxPos;
+ *            a motor with both limits at 0 only gets limited to the range of the servo. The offsets
+ *            are signed, even though the Motor stores them unsigned.
+ *    @param  motor       The index of the motor in the list
+ *    @param  servoAngle  The angle of the servo (degrees)
+ *    @return The pulse width (microseconds)
+ */
+uint16_t ServoOutput::_calculatePulseWidth(uint8_t motor, int16_t servoAngle) {
+  const Motor *output = &_motors[motor];
+
+  int16_t minimum = 0;
+  int16_t maximum = SERVO_RANGE_DEGREES;
+  if ((output->minPos != 0) || (output->maxPos != 0)) {
+    minimum = max((int16_t)output->minPos, minimum);
+    maximum = min((int16_t)output->maxPos, maximum);
+  }
+  servoAngle = constrain(servoAngle, minimum, maximum);
+
+#if defined(SERVO_PULSE_TABLES)
+  const ServoCorrectionCurve *curve = _curves[motor];
+  if (curve != NULL) {
+    // Interpolate between the measurements either side of the angle (or extend the first/last pair)
+    uint8_t point = 0;
+    while ((point < curve->pointCount - 2) && (servoAngle > curve->angles[point + 1]))
+      point++;
+
+    int32_t angleSpan = curve->angles[point + 1] - curve->angles[point];
+    int32_t pulseSpan = (int32_t)curve->pulseWidths[point + 1] - curve->pulseWidths[point];
+    if (angleSpan == 0)
+      return curve->pulseWidths[point];
+
+    int32_t pulseWidth = curve->pulseWidths[point] + (((servoAngle - curve->angles[point]) * pulseSpan) / angleSpan);
+    return constrain(pulseWidth, (int32_t)0, (int32_t)UINT16_MAX);
+  }
+#endif
+
+  return SERVO_MIN_PULSE_WIDTH + (((int32_t)servoAngle * (SERVO_MAX_PULSE_WIDTH - SERVO_MIN_PULSE_WIDTH)) / SERVO_RANGE_DEGREES);
+}
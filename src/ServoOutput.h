@@ -0,0 +1,87 @@
+#ifndef SERVO_OUTPUT_H
+#define SERVO_OUTPUT_H
+
+#include <Arduino.h>
+#include "Kinematics.h"
+#include "quadruped-config.h"
+
+#define SERVO_OUTPUT_MAX_MOTORS (ROBOT_LEG_COUNT * MOTORS_PER_LEG)
+
+// Which of the Motor angles get sent to the servos
+typedef enum {
+  STATIC_DEGREES = 0, DYNAMIC_DEGREES
+} ServoAngleSource;
+
+// Pulse widths measured on the bench for a servo, i.e. the pulse width that really puts the horn at each
+// angle. The pulse table of the motor is interpolated from these (SERVO_PULSE_TABLES).
+typedef struct {
+  uint8_t pointCount;             // at least 2
+  const uint8_t *angles;          // ascending (degrees)
+  const uint16_t *pulseWidths;    // microseconds
+} ServoCorrectionCurve;
+
+// Something that can set servo pulse widths, i.e. a PCA9685 (see PCA9685Driver.h). It is handed all of
+// the changed channels at once so that it can send them in as few transfers as possible.
+class ServoDriver {
+  public:
+    // channels[motor] and pulseWidths[motor] (microseconds) for every motor; only the motors whose bit
+    // (1 << motor) is set in changedMotors need to be written
+    virtual void writePulseWidths(const uint8_t channels[], const uint16_t pulseWidths[], uint16_t changedMotors) = 0;
+};
+
+// Sends the Motor angles to the servos: applies the offsets, clamps to the motor limits, converts to pulse
+// widths and only writes the motors whose pulse width changed since the last update.
+class ServoOutput {
+
+  public:
+    ServoOutput();
+
+    void init(Motor motors[], uint8_t motorCount, ServoDriver *driver);
+
+    // writes the motors that changed; call this after the angles are updated (Quadruped::walk() does it for you)
+    void update(ServoAngleSource source = STATIC_DEGREES);
+
+    // the same, but with angles from somewhere else (in motor list order), i.e. a JointFrame from the other core
+    void writeAngles(const int16_t angles[]);
+
+    // writes every motor on the next update, i.e. after the servos lost power
+    void invalidate();
+
+#if defined(SERVO_PULSE_TABLES)
+    // rebuilds the pulse tables; call this after changing the offsets or limits of the motors
+    void recalibrate();
+
+    // uses bench measurements instead of the linear map for a motor (NULL to go back to linear)
+    void setCorrectionCurve(uint8_t motor, const ServoCorrectionCurve *curve);
+#endif
+
+    // the pulse width (microseconds) that was last written to a motor
+    uint16_t pulseWidth(uint8_t motor);
+
+    uint32_t updateCount;         // updates that wrote at least one motor
+    uint32_t motorWriteCount;     // motors written in total
+
+  private:
+    uint16_t _pulseWidthOf(uint8_t motor, int16_t angle);
+    uint16_t _calculatePulseWidth(uint8_t motor, int16_t servoAngle);
+
+#if defined(SERVO_PULSE_TABLES)
+    void _buildPulseTable(uint8_t motor);
+
+    // The pulse width for every servo angle, with the motor's limits and correction curve already applied
+    uint16_t _pulseTables[SERVO_OUTPUT_MAX_MOTORS][SERVO_RANGE_DEGREES + 1];
+    int16_t _angleOffsets[SERVO_OUTPUT_MAX_MOTORS];   // calibOffset + applicationOffset
+    const ServoCorrectionCurve * _curves[SERVO_OUTPUT_MAX_MOTORS];
+#endif
+
+    Motor * _motors;
+    uint8_t _motorCount;
+    ServoDriver * _driver;
+
+    uint8_t _channels[SERVO_OUTPUT_MAX_MOTORS];
+    uint16_t _pulseWidths[SERVO_OUTPUT_MAX_MOTORS];   // last written
+    bool _isWritten;                                  // false until everything has been written once
+
+};
+
+#endif
@@ -1,172 +1,476 @@
 #include "StepPlanner.h"
 
+#include "Profiler.h"
+#include "FixedPointMath.h"
+
 StepPlanner::StepPlanner(void) {};
 
 /*!
- *    @brief Initializes the gaits and sets up the leg modes
- *    @param legID The leg this stepPlanner object is used for
+ *    @brief Sets up the gaits that are shared by all of the legs. Call this once before init().
+ *    @param gaitParameters The shared gait parameters to set up
  *    @param offsetX The offset x direction from x = 0... you can have the walking occur further back or further forwards.
  *    @param offsetY The offset y direction from y = 0... you can have the walking occur further right or further left.
  *    @param robotHeight the default hieght of the robot. Every step will end in the leg being this height
 */
-void StepPlanner::init(LegID legID, int16_t offsetX, int16_t offsetY, int16_t robotHeight) {
+void StepPlanner::initGaitParameters(GaitParameters *gaitParameters, int16_t offsetX, int16_t offsetY, int16_t robotHeight) {
+
+  gaitParameters->gaitType = DEFAULT_GAIT;
+  gaitParameters->robotHeight = robotHeight;
+
+  gaitParameters->offsetX = offsetX;
+  gaitParameters->offsetY = offsetY;
+
+  // amplitude, periodHalf, dutyFactor, drawBackAmplitude, phaseOffsets for LEG_1 to LEG_4
+  const Gait gaits[NUMBER_OF_GAITS] = {
+    { 20, 80, 0.5,  20.0 / DRAW_BACK_AMPLITUDE_REDUCTION, { 0, 0.5, 0, 0.5 } },        // TROT
+    { 20, 80, 0.5,  20.0 / DRAW_BACK_AMPLITUDE_REDUCTION, { 0, 0.5, 0.5, 0 } },        // PACE
+    { 20, 80, 0.5,  20.0 / DRAW_BACK_AMPLITUDE_REDUCTION, { 0, 0, 0.5, 0.5 } },        // BOUND
+    { 20, 80, 0.75, 0,                                    { 0, 0.5, 0.25, 0.75 } },    // WALK
+    { 15, 80, 0.9,  0,                                    { 0, 0.5, 0.25, 0.75 } }     // CRAWL
+  };
+
+  for (uint8_t gait = 0; gait < NUMBER_OF_GAITS; gait++)
+    gaitParameters->gaits[gait] = gaits[gait];
+
+  gaitParameters->hasStagedGait = false;
+
+  gaitParameters->heightTableGait.periodHalf = 0;   // not built yet
+  gaitParameters->heightTableSize = 0;
+  gaitParameters->heightTableBuilt = 0;
+  _setTiming(gaitParameters);
+  _buildHeightTable(gaitParameters);
+
+  resetBodyPhase(gaitParameters);
+}
+
+/*!
+ *    @brief Sets up the leg modes
+ *    @param legID The leg this stepPlanner object is used for
+ *    @param gaitParameters The gait parameters shared by all legs (see initGaitParameters())
+*/
+void StepPlanner::init(LegID legID, GaitParameters *gaitParameters) {
 
   _legID = legID;
+  _gaitParameters = gaitParameters;
 
   _legMode = STANDING;
-  _gaitType = DEFAULT_GAIT;
-  _robotHeight = robotHeight;
-
-  _offsetX = offsetX;
-  _offsetY = offsetY;
 
-  _gaits[TROT].amplitude = 20;
-  _gaits[TROT].periodHalf = 80;
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+  _groundHeightInput = 0;
+  _groundHeight = 0;
+#endif
 
   reset();
 }
 
 /*!
- *    @brief Sets the walking giat. Should only be called when the robot is standing
+ *    @brief Sets the walking giat. Should only be called when the robot is standing. The gait is
+             shared, so this changes it for all of the legs.
 */
 void StepPlanner::setGait(GaitType gaitType) {
-  if (_legMode == STANDING)
-    _gaitType = gaitType;
+  if (_legMode == STANDING) {
+    _gaitParameters->gaitType = gaitType;
+    _setTiming(_gaitParameters);
+    _buildHeightTable(_gaitParameters);
+  }
 }
 
 /*!
- *    @brief Updates the position of the foot as the step progresses.
- *    @param robotMode The mode the robot is in i.e. walking, static_standing.
-             used to determine when the first step and the last step are being made
- *    @returns True when the foot position was updated, false if it wasn't.
+ *    @brief Stages new parameters for a gait, i.e. ones streamed in over serial while tuning it. If it is the gait
+             that is running, it changes over for all legs at the same time at the start of the next cycle (see
+             swapStagedGait()); any other gait just takes them. Staging again before then replaces them.
+ *    @param gaitParameters The shared gait parameters
+ *    @param gaitType The gait to change
+ *    @param gait Its new parameters
 */
-bool StepPlanner::update(ROBOT_MODE robotMode) {
-
-  float periodHalf = _gaits[_gaitType].periodHalf;
-
-  if ((millis() - _previousUpdateTime) % TIME_TO_UPDATE == 0) {
-
-    // For legs 2 and 3, the negative and positive parts of the x axis are flipped
-
-    dynamicFootPosition.x = footPosX.update() + _offsetX;
-    dynamicFootPosition.y = footPosY.update() + _offsetY;
-    dynamicFootPosition.z = getStepHeight(_footXYDrop, _legMode);
-
-    switch (_legMode) {
-      case FIRST_STEP_ARC:            
-        _footXYDrop += GAIT_POSITION_INCREMENT; 
-        if (_footXYDrop == (periodHalf/2)) {
-          _legMode = ACTIVE_WALKING_DRAW_BACK;
-        }
-        break;
-      case FIRST_STEP_DRAW_BACK:      
-        _footXYDrop -= GAIT_POSITION_INCREMENT; 
-        if (_footXYDrop == -1*(periodHalf/2)) {
-          _legMode = ACTIVE_WALKING_ARC;
-        }
-        break;
-      case ACTIVE_WALKING_ARC:
-        _footXYDrop += GAIT_POSITION_INCREMENT;
-        if (_footXYDrop == (periodHalf/2)) {
-          _legMode = ACTIVE_WALKING_DRAW_BACK;
-        }
-        break;
-      case ACTIVE_WALKING_DRAW_BACK:
-        _footXYDrop -= GAIT_POSITION_INCREMENT;
-        if (_footXYDrop == -1*(periodHalf/2)) {
-          _legMode = ACTIVE_WALKING_ARC;
-        }
-        break;
-      case STANDING:
-        break;
-    }
-    _previousUpdateTime = (millis() - 1);
-    return true;
+void StepPlanner::stageGait(GaitParameters *gaitParameters, GaitType gaitType, const Gait *gait) {
+  gaitParameters->stagedGait = *gait;
+  gaitParameters->stagedGaitType = gaitType;
+  gaitParameters->hasStagedGait = true;
+}
+
+/*!
+ *    @brief Swaps the staged gait in if it is time to. While walking that is the start of the cycle (body phase 0).
+             Not every leg is at the end of a swing or stance there (in WALK and CRAWL two are in the middle of
+             their stance), but with the same dutyFactor and phaseOffsets each leg is the same part of the way
+             through its step in the new timing (to within a tick), and the foot is at that part of the way along
+             its latched step endpoint, so it carries on from where it is. A new dutyFactor or phaseOffsets would
+             move the legs to other parts of their steps, so those wait until the robot is standing. Call this
+             before the legs are updated for the tick. The height table is built again in the background (see
+             buildHeightTable()).
+ *    @param gaitParameters The shared gait parameters
+ *    @param isStanding true if the robot is standing still
+ *    @returns true if the staged gait was swapped in
+*/
+bool StepPlanner::swapStagedGait(GaitParameters *gaitParameters, bool isStanding) {
+
+  if (!gaitParameters->hasStagedGait)
+    return false;
+
+  Gait *staged = &gaitParameters->stagedGait;
+  Gait *gait = &gaitParameters->gaits[gaitParameters->stagedGaitType];
+  bool isCurrentGait = (gaitParameters->stagedGaitType == gaitParameters->gaitType);
+
+  if (isCurrentGait && !isStanding) {
+    if (gaitParameters->bodyPhase != 0)
+      return false;
+    if ((staged->dutyFactor != gait->dutyFactor) || (memcmp(staged->phaseOffsets, gait->phaseOffsets, sizeof(gait->phaseOffsets)) != 0))
+      return false;
   }
-  return false;
-};
+
+  *gait = *staged;
+  gaitParameters->hasStagedGait = false;
+
+  if (isCurrentGait) {
+    // The body phase stays at 0, which is the start of the new cycle as well
+    _setTiming(gaitParameters);
+    if (isStanding)
+      _buildHeightTable(gaitParameters);
+    else
+      _startHeightTable(gaitParameters);
+  }
+  return true;
+}
 
 /*!
- *    @brief Performs the calculation of the arc itself ONLY... doesn't know where the foot actually is
- *    @param footXYDropL The x drop position of the foot.
- *    @param legMode The mode/phase of walking the leg is in.
- *    @returns The hight that should be written to the legs i.e. foot z distance (foot-should) - curve hight at the given footXYDropL
+ *    @brief Puts the body phase where the leading leg (LEG_1 if RIGHT_FOOTED, LEG_2 if LEFT_FOOTED) is
+             halfway through its swing, so that the first step starts straight away. Call this when the
+             robot starts walking.
+ *    @param gaitParameters The shared gait parameters
+*/
+void StepPlanner::resetBodyPhase(GaitParameters *gaitParameters) {
+
+  GaitTiming *timing = &gaitParameters->timing;
+
+#if defined(RIGHT_FOOTED)
+  uint16_t leadOffset = timing->legOffsets[LEG_1 - 1];
+#elif defined(LEFT_FOOTED)
+  uint16_t leadOffset = timing->legOffsets[LEG_2 - 1];
+#else
+#error You must define whether your robot is RIGHT_FOOTED or LEFT_FOOTED in Config.h
+#endif
+
+  gaitParameters->bodyPhase = (timing->cycleTicks + (timing->swingTicks / 2) - leadOffset) % timing->cycleTicks;
+}
+
+/*!
+ *    @brief Moves the body phase on by one tick. Call this once per tick after updating every leg.
+ *    @param gaitParameters The shared gait parameters
+*/
+void StepPlanner::advanceBodyPhase(GaitParameters *gaitParameters) {
+  gaitParameters->bodyPhase++;
+  if (gaitParameters->bodyPhase >= gaitParameters->timing.cycleTicks)
+    gaitParameters->bodyPhase = 0;
+}
+
+/*!
+ *    @brief The gait changes at the start of a tick: a new gait once the robot is standing (this retries every tick
+             until it does), and staged gait parameters at the start of a cycle (see swapStagedGait())
+ *    @param gaitParameters The shared gait parameters
+ *    @param legs The robot's legs
+ *    @param requestedGait The gait the robot should be running
+ *    @param robotMode The mode the robot is in
+*/
+void StepPlanner::applyGaitChanges(GaitParameters *gaitParameters, StepPlanner legs[], GaitType requestedGait, ROBOT_MODE robotMode) {
+  // The gait is shared by all legs, so it is set through any one of them
+  if ((gaitParameters->gaitType != requestedGait) && (robotMode == STATIC_STANDING))
+    legs[0].setGait(requestedGait);
+
+  swapStagedGait(gaitParameters, robotMode == STATIC_STANDING);
+}
+
+/*!
+ *    @brief Changes the robot's mode for the command: a stopped command (0, 0) starts standing the legs
+             (STAND_PENDING, not with STANDING_TROT), any other starts them walking, from their origins and the
+             leading leg's swing if the robot was standing still
+ *    @param gaitParameters The shared gait parameters
+ *    @param legs The robot's legs
+ *    @param robotMode The mode the robot is in
+ *    @param controlCoordinateX X direction of the controller coordinate
+ *    @param controlCoordinateY Y direction of the controller coordinate
+ *    @returns The mode the robot is in now
+*/
+ROBOT_MODE StepPlanner::changeRobotMode(GaitParameters *gaitParameters, StepPlanner legs[], ROBOT_MODE robotMode, int16_t controlCoordinateX, int16_t controlCoordinateY) {
+
+  bool isStopping = (controlCoordinateX == 0) && (controlCoordinateY == 0);
+
+#if !defined(STANDING_TROT)
+  if (isStopping && (robotMode != STATIC_STANDING))
+    robotMode = STAND_PENDING;
+  if (!isStopping && (robotMode == STAND_PENDING))
+    robotMode = WALKING;
+#endif
+
+  if (!isStopping && (robotMode == STATIC_STANDING)) {
+    robotMode = WALKING;
+    for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++)
+      legs[leg].reset();
+    resetBodyPhase(gaitParameters);
+  }
+  return robotMode;
+}
+
+/*!
+ *    @brief Moves every leg on by one tick for the command, then the body phase. A leg only starts or stops at its
+             origin (and only changes its endpoint there, unless CONTINUOUS_STEP_ENDPOINT). The feet are left in
+             each leg's dynamicFootPosition.
+ *    @param gaitParameters The shared gait parameters
+ *    @param legs The robot's legs
+ *    @param direction The robot's step direction; updated for the command (see setStepDirection())
+ *    @param controlCoordinateX X direction of the controller coordinate
+ *    @param controlCoordinateY Y direction of the controller coordinate
+ *    @param robotMode The mode the robot is in; STAND_PENDING becomes STATIC_STANDING once every leg has stopped
+ *    @returns True if every leg is standing
 */
-int16_t StepPlanner::getStepHeight(int16_t footXYDropL, LegMode legMode) {
+bool StepPlanner::stepLegs(GaitParameters *gaitParameters, StepPlanner legs[], StepDirection *direction, int16_t controlCoordinateX, int16_t controlCoordinateY, ROBOT_MODE *robotMode) {
+
+  // The direction is the same for every leg, so it is only normalized once (and only when it changes)
+  setStepDirection(direction, controlCoordinateX, controlCoordinateY);
+
+  bool isStanding = true;
+  for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+    if (legs[leg].footAtOrigin())
+      legs[leg].setStepEndpoint(direction, *robotMode);
+#if defined(CONTINUOUS_STEP_ENDPOINT)
+    else
+      legs[leg].retargetStepEndpoint(direction);
+#endif
+    legs[leg].update();
+    isStanding = isStanding && legs[leg].isStanding();
+  }
+
+  advanceBodyPhase(gaitParameters);
+
+  if ((*robotMode == STAND_PENDING) && isStanding)
+    *robotMode = STATIC_STANDING;
+  return isStanding;
+}
+
+/*!
+ *    @brief Updates the position of the foot for the current body phase. This should be called once
+             per control loop tick (Quadruped's scheduler handles the timing).
+*/
+void StepPlanner::update() {
+
+  PROFILE_START(PROFILE_STEP_PLANNER_UPDATE);
+
+  if (_legMode == STANDING) {
+    dynamicFootPosition.x = _gaitParameters->offsetX;
+    dynamicFootPosition.y = _gaitParameters->offsetY;
+    dynamicFootPosition.z = getStepHeight(0, STANDING);
+
+    PROFILE_END(PROFILE_STEP_PLANNER_UPDATE);
+    return;
+  }
+
+  GaitTiming *timing = &_gaitParameters->timing;
+  uint16_t legTick = _legTick();
 
-  int16_t stepHeight = 0;
+  // The first step is over once the swing or stance that it joined in is
+  if ((_legMode == FIRST_STEP) && ((legTick == 0) || (legTick == timing->swingTicks)))
+    _legMode = STEPPING;
 
-  float periodHalf = _gaits[_gaitType].periodHalf;
-  float amplitude = _gaits[_gaitType].amplitude;
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+  // The ground height is taken at the top of the swing, where the foot is furthest off the ground, so that the
+  // foot never moves while it is on it; the first step's swing is only the second half, so its top is later
+  int16_t halfSwing = timing->swingTicks / 2;
+  uint16_t swingTop = (_legMode == FIRST_STEP) ? halfSwing + ((halfSwing + 1) / 2) : halfSwing;
+  if (legTick == swingTop)
+    _groundHeight = _groundHeightInput;
+#endif
 
-  switch (legMode) {
-    case FIRST_STEP_ARC:           stepHeight = _robotHeight - lrint( (amplitude/2) * cos(PI * (footXYDropL - (periodHalf/4))/(periodHalf/2) ) ); break;
-    case FIRST_STEP_DRAW_BACK:     stepHeight = _robotHeight - 0; break;
-    case ACTIVE_WALKING_ARC:       stepHeight = _robotHeight - lrint( amplitude * cos( (PI * (footXYDropL)/periodHalf) ) ); break;
-    // case ACTIVE_WALKING_DRAW_BACK: stepHeight = _robotHeight - 0; break;
-    case ACTIVE_WALKING_DRAW_BACK: stepHeight = _robotHeight + lrint( (amplitude/DRAW_BACK_AMPLITUDE_REDUCTION) * cos(PI * (footXYDropL)/periodHalf ) ); break;
-    case STANDING:                 stepHeight = _robotHeight - 0;
+  // The foot moves forwards from the opposite of the step endpoint to the step endpoint during the swing and
+  // draws back during the stance; it is at its origin halfway through each.
+  float stepProgress;
+  if (legTick < timing->swingTicks) {
+    int16_t halfSwing = timing->swingTicks / 2;
+    stepProgress = (int16_t)(legTick - halfSwing) / (float)halfSwing;
+  }
+  else {
+    int16_t halfStance = timing->stanceTicks / 2;
+    stepProgress = (int16_t)(timing->swingTicks + halfStance - legTick) / (float)halfStance;
   }
 
-  return stepHeight;
+  // For legs 2 and 3, the negative and positive parts of the foot's y axis are flipped (see _calculateStepEndpoint())
+  dynamicFootPosition.x = (_stepEndpoint.x * stepProgress) + _gaitParameters->offsetX;
+  dynamicFootPosition.y = (_stepEndpoint.y * stepProgress) + _gaitParameters->offsetY;
+  dynamicFootPosition.z = getStepHeight(legTick, _legMode);
 
+  PROFILE_END(PROFILE_STEP_PLANNER_UPDATE);
 };
 
+/*!
+ *    @brief Finds the height of the arc itself ONLY... doesn't know where the foot actually is. This is a
+             lookup in the gait's height table (see _buildHeightTable()).
+ *    @param legTick Where the leg is in the gait cycle (ticks)
+ *    @param legMode The mode of the leg; the first step has its own curves
+ *    @returns The hight that should be written to the legs i.e. foot z distance (foot-should) - curve hight at the given legTick
+*/
+int16_t StepPlanner::getStepHeight(uint16_t legTick, LegMode legMode) {
+
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+  // z is down from the shoulder, so higher ground is a shorter leg
+  int16_t robotHeight = _gaitParameters->robotHeight - _groundHeight;
+#else
+  int16_t robotHeight = _gaitParameters->robotHeight;
+#endif
+  GaitTiming *timing = &_gaitParameters->timing;
+
+  if (legMode == STANDING)
+    return robotHeight;
+
+  // Fall back to calculating if the gait didn't fit in the table
+  if (_gaitParameters->heightTableGait.periodHalf == 0)
+    return _calculateStepHeight(legTick, legMode == FIRST_STEP, &_gaitParameters->gaits[_gaitParameters->gaitType], timing, robotHeight);
+
+  if (legMode == STEPPING)
+    return robotHeight + _gaitParameters->heightTable[legTick];
+
+  // The first step only ever starts at an origin, so it is either the second half of a swing or flat
+  if (legTick < timing->swingTicks)
+    return robotHeight + _gaitParameters->heightTable[timing->cycleTicks + legTick - (timing->swingTicks / 2)];
+  return robotHeight;
+
+};
+
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+/*!
+ *    @brief Sets the height of the ground under the leg, compared to the ground that robotHeight is measured from.
+             It can be set any time (i.e. every tick from a contact sensor); the leg takes it at the top of its next
+             swing and keeps it until the top of the one after, so a standing leg stays on the ground it is on.
+ *    @param groundHeight The height (mm); positive is higher. It is limited to +/- TERRAIN_MAX_HEIGHT.
+*/
+void StepPlanner::setGroundHeight(int16_t groundHeight) {
+  if (groundHeight > TERRAIN_MAX_HEIGHT)
+    groundHeight = TERRAIN_MAX_HEIGHT;
+  if (groundHeight < -TERRAIN_MAX_HEIGHT)
+    groundHeight = -TERRAIN_MAX_HEIGHT;
+  _groundHeightInput = groundHeight;
+}
+
+/*!
+ *    @returns The ground height the current step is using (mm)
+*/
+int16_t StepPlanner::groundHeight() {
+  return _groundHeight;
+}
+
+/*!
+ *    @returns The latest ground height given to setGroundHeight() (mm), which the next swing takes
+*/
+int16_t StepPlanner::groundHeightInput() {
+  return _groundHeightInput;
+}
+#endif
+
 /*!
  *    @brief Allows you to set the endpoint of the step depending on the direction you command.
             This also handles whether the foot is taking its first or last step. 
  *    @param controllCoordinateX X direction of the controller coordinate 
  *    @param controllCoordinateY Y direction of the controller coordinate 
- *    @returns True if it's time to update the endpoint, false if it's not.
+ *    @param robotMode The mode the robot is in
 */
 void StepPlanner::setStepEndpoint(int16_t controlCoordinateX, int16_t controlCoordinateY, ROBOT_MODE robotMode) {
+  StepDirection direction;
+  direction.controlCoordinateX = 0;
+  direction.controlCoordinateY = 0;
+  direction.x = 0;
+  direction.y = 0;
+
+  setStepDirection(&direction, controlCoordinateX, controlCoordinateY);
+  setStepEndpoint(&direction, robotMode);
+}
 
-  // If this is the first step, it must be determined whether to arc or draw back
-  // and the time of last update must be set.
-  if (_setFirstStep(robotMode)) _previousUpdateTime = (millis() - 1);
+/*!
+ *    @brief The same, with the direction already normalized by setStepDirection() (which Quadruped does
+            once for every leg)
+ *    @param direction The commanded direction
+ *    @param robotMode The mode the robot is in
+*/
+void StepPlanner::setStepEndpoint(const StepDirection *direction, ROBOT_MODE robotMode) {
 
-  float stepEndpointX = 0.0;
-  float stepEndpointY = 0.0;
+  // A standing leg joins the walk at its origin; whether it starts with the second half of a swing or of a
+  // stance depends on where its phase is
+  if ((_legMode == STANDING) && (robotMode == WALKING))
+    _legMode = FIRST_STEP;
 
-  float periodHalf = _gaits[_gaitType].periodHalf;
-  float movementGradient = 0;
+  _calculateStepEndpoint(direction, &_stepEndpoint);
 
   // Check if stopped walking
-  if (controlCoordinateX == 0 && controlCoordinateY == 0) {
-    _stepEndpoint.x = 0.0;
-    _stepEndpoint.y = 0.0;
-    footPosX.go(_stepEndpoint.x);
-    footPosY.go(_stepEndpoint.y);
-
+  if ((direction->controlCoordinateX == 0) && (direction->controlCoordinateY == 0)) {
 #if !defined(STANDING_TROT)
     _legMode = STANDING;
 #endif
+  }
+
+  // The foot reaches this endpoint at the end of the swing and the opposite of it at the end of the stance (see update())
+};
 
+#if defined(CONTINUOUS_STEP_ENDPOINT)
+/*!
+ *    @brief Moves the step endpoint towards the direction you command while the foot is away from its origin,
+            by up to STEP_ENDPOINT_SLEW per axis so that the foot doesn't jump. Call this every tick that
+            setStepEndpoint() isn't called, which still starts and stops the steps at the origin.
+ *    @param direction The commanded direction (see setStepDirection())
+*/
+void StepPlanner::retargetStepEndpoint(const StepDirection *direction) {
+
+  if (_legMode == STANDING)
+    return;
+
+  Coordinate target;
+  _calculateStepEndpoint(direction, &target);
+
+  // The foot is at stepEndpoint * stepProgress (|stepProgress| <= 1), so it moves by at most the slew extra
+  float slew = STEP_ENDPOINT_SLEW;
+  _stepEndpoint.x += constrain(target.x - _stepEndpoint.x, -slew, slew);
+  _stepEndpoint.y += constrain(target.y - _stepEndpoint.y, -slew, slew);
+}
+#endif
+
+/*!
+ *    @brief Normalizes the control coordinate into a direction. The direction keeps the control coordinate
+            that it was made from, so a repeated control coordinate costs one comparison.
+ *    @param direction The direction to update
+ *    @param controllCoordinateX X direction of the controller coordinate 
+ *    @param controllCoordinateY Y direction of the controller coordinate 
+*/
+void StepPlanner::setStepDirection(StepDirection *direction, int16_t controlCoordinateX, int16_t controlCoordinateY) {
+
+  if ((direction->controlCoordinateX == controlCoordinateX) && (direction->controlCoordinateY == controlCoordinateY))
     return;
-  }
 
-  // make sure that math works (vertical lines are undefined)
-  else if (controlCoordinateX == 0) {
-    stepEndpointX = 0;
-    stepEndpointY = periodHalf/2;
+  direction->controlCoordinateX = controlCoordinateX;
+  direction->controlCoordinateY = controlCoordinateY;
+
+  // Straight lines are exact; everything else is scaled by 1/length
+  if (controlCoordinateX == 0) {
+    direction->x = 0;
+    direction->y = (controlCoordinateY > 0) - (controlCoordinateY < 0);
+  }
+  else if (controlCoordinateY == 0) {
+    direction->x = (controlCoordinateX > 0) - (controlCoordinateX < 0);
+    direction->y = 0;
   }
   else {
-    movementGradient = (controlCoordinateY / controlCoordinateX);
-
-    stepEndpointX = ((periodHalf/2) / sqrt(1 + pow(movementGradient, 2)));
-    stepEndpointY = (((periodHalf/2) * abs(movementGradient)) / sqrt(1 + pow(movementGradient, 2)));
+    int32_t lengthSquared = ((int32_t)controlCoordinateX * controlCoordinateX) + ((int32_t)controlCoordinateY * controlCoordinateY);
+    float inverseLength = fastInverseSqrt(lengthSquared);
+    direction->x = controlCoordinateX * inverseLength;
+    direction->y = controlCoordinateY * inverseLength;
   }
+}
+
+/*!
+ *    @brief Finds the endpoint of a step in the direction you command
+ *    @param direction The commanded direction
+ *    @param endpoint Output for the endpoint (0, 0 if stopped)
+*/
+void StepPlanner::_calculateStepEndpoint(const StepDirection *direction, Coordinate *endpoint) {
 
-  // verify that the direction is correct. The quadrant of movement must 
-  // be accounted for in order to match the joystick. 
-  if (controlCoordinateX < 0) stepEndpointX *= -1;
-  if (controlCoordinateY < 0) stepEndpointY *= -1;
+  float stepLengthHalf = _gaitParameters->gaits[_gaitParameters->gaitType].periodHalf / 2;
 
-  // drawback gaits are pushing to a position opposite from the arc position
-  if ((_legMode == ACTIVE_WALKING_DRAW_BACK) || (_legMode == FIRST_STEP_DRAW_BACK)) {
-    stepEndpointX *= -1;
-    stepEndpointY *= -1;
-  }
+  float stepEndpointX = direction->x * stepLengthHalf;
+  float stepEndpointY = direction->y * stepLengthHalf;
 
   // The kinematics engine thinks that specifying a negative y distance
   // means that the foot should move into the robot. If legs 2 or 3 need to 
@@ -177,35 +481,38 @@ void StepPlanner::setStepEndpoint(int16_t controlCoordinateX, int16_t controlCoo
 
   // flip the result (kinematics thinks that x is moving forwards/backwards while looking down the robot)
   // stepPlanner thinks that y is moving forwards/backwards
-  _stepEndpoint.x = stepEndpointY;
-  _stepEndpoint.y = stepEndpointX;
-
-  long completionTime = (long)((TIME_TO_UPDATE - 1) * (periodHalf/(2 * GAIT_POSITION_INCREMENT)));
-
-  // Ideally, the interpolation objects will effectively track the position of footXY drop.
-  // When it reaches its maximum point, so does footXY drop (likewise when they are 0).
-
-  footPosX.go(_stepEndpoint.x, completionTime, LINEAR, FORTHANDBACK);
-  footPosY.go(_stepEndpoint.y, completionTime, LINEAR, FORTHANDBACK);
-};
+  endpoint->x = stepEndpointY;
+  endpoint->y = stepEndpointX;
+}
 
 
-// footAtOrigin updates whenever footXYDrop == 0 since this is the only time that all feet 
-// can be updated with the same endpoint and have the same distance to travel in order to get
-// to the endpoint. While the step could be updated every cycle, this reduces responsivity
-// (the current setup essentially allows for an update every half-cycle).
+// footAtOrigin is true halfway through the swing and the stance since this is the only time that the
+// endpoint can change without the foot jumping (the foot is at the offset whatever the endpoint is).
+// On its own that only lets the step change every half-cycle. With CONTINUOUS_STEP_ENDPOINT the endpoint
+// is only set from scratch here (which is also where steps start and stop); every other tick
+// retargetStepEndpoint() moves it a little towards the command, so the step can change every tick.
 /*!
  *    @brief Used to figure out if it's time to update the step endpoint
  *    @returns True if it's time to update the endpoint, false if it's not.
 */
 bool StepPlanner::footAtOrigin() {
-  if ((_footXYDrop == 0) && (_wasAtOrigin == false)) {
-    _wasAtOrigin = true;
-    return true;
-  }
-  if ((_footXYDrop != 0))
-    _wasAtOrigin = false;
-  return false;
+  GaitTiming *timing = &_gaitParameters->timing;
+  uint16_t legTick = _legTick();
+  return (legTick == (timing->swingTicks / 2)) || (legTick == (timing->swingTicks + (timing->stanceTicks / 2)));
+}
+
+/*!
+ *    @returns True if the leg isn't walking (it is waiting at its origin)
+*/
+bool StepPlanner::isStanding() {
+  return _legMode == STANDING;
+}
+
+/*!
+ *    @returns Whether the leg is standing, taking its first step or stepping
+*/
+LegMode StepPlanner::legMode() {
+  return _legMode;
 }
 
 /*!
@@ -214,49 +521,162 @@ bool StepPlanner::footAtOrigin() {
 void StepPlanner::reset() {
   dynamicFootPosition.x = 0;
   dynamicFootPosition.y = 0;
-  dynamicFootPosition.z = _robotHeight;
+  dynamicFootPosition.z = getStepHeight(0, STANDING);
 
-  _wasAtOrigin = false;
   _legMode = STANDING;
-  _footXYDrop = 0;
 
-  footPosX.go(0);
-  footPosY.go(0);
+  _stepEndpoint.x = 0;
+  _stepEndpoint.y = 0;
 }
 
 /*!
- *    @brief Sets the first step to FIRST_STEP_ARC or FIRST_STEP_DRAW_BACK
- *    @param robotMode the mode of the robot.
- *    @returns true if the first step was set (it was called on the first step),
- *             false if it wasn't.
+ *    @returns Where this leg is in the gait cycle (ticks): the body phase plus the leg's phase offset
 */
-bool StepPlanner::_setFirstStep(ROBOT_MODE robotMode) {
+uint16_t StepPlanner::_legTick() {
+  GaitTiming *timing = &_gaitParameters->timing;
+  uint16_t legTick = _gaitParameters->bodyPhase + timing->legOffsets[_legID - 1];
+  if (legTick >= timing->cycleTicks)
+    legTick -= timing->cycleTicks;
+  return legTick;
+}
 
-  if ((_legMode == STANDING) && (robotMode == WALKING)) {
+/*!
+ *    @brief Performs the calculation of the arc itself ONLY... doesn't know where the foot actually is
+ *    @param legTick Where the leg is in the gait cycle (ticks)
+ *    @param isFirstStep true for the first step: the swing is the second half only, starting from the ground,
+ *           and the stance is flat
+ *    @param gait The gait to calculate the arc for
+ *    @param timing The gait's timing
+ *    @param robotHeight The height of the robot (the height when the arc is 0)
+ *    @returns The hight that should be written to the legs i.e. foot z distance (foot-should) - curve hight at the given legTick
+*/
+int16_t StepPlanner::_calculateStepHeight(uint16_t legTick, bool isFirstStep, const Gait *gait, const GaitTiming *timing, int16_t robotHeight) {
 
-#if defined(RIGHT_FOOTED)
+  float amplitude = gait->amplitude;
 
-    if (_legID == LEG_1 || _legID == LEG_3) {
-      _legMode = FIRST_STEP_ARC;
-    }
-    else if (_legID == LEG_2 || _legID == LEG_4) {
-      _legMode = FIRST_STEP_DRAW_BACK;
-    }
+  // Both curves are centered on the origin of the swing or stance
+  if (legTick < timing->swingTicks) {
+    float swingTicks = timing->swingTicks;
+    int16_t halfSwing = timing->swingTicks / 2;
+    int16_t swingPosition = legTick - halfSwing;
 
-#elif defined(LEFT_FOOTED)
+    if (isFirstStep)
+      return robotHeight - lrintf( (amplitude * 0.5f) * cosf(PI_F * (swingPosition - (halfSwing * 0.5f)) / halfSwing ) );
+    return robotHeight - lrintf( amplitude * cosf( (PI_F * swingPosition) / swingTicks ) );
+  }
 
-    if (_legID == LEG_1 || _legID == LEG_3) {
-      _legMode = FIRST_STEP_DRAW_BACK;
-    }
-    else if (_legID == LEG_2 || _legID == LEG_4) {
-      _legMode = FIRST_STEP_ARC;
-    }
-#else
-#error You must define whether your robot is RIGHT_FOOTED or LEFT_FOOTED in Config.h
-#endif
+  if (isFirstStep)
+    return robotHeight - 0;
+
+  float stanceTicks = timing->stanceTicks;
+  int16_t stancePosition = timing->swingTicks + (timing->stanceTicks / 2) - legTick;
+  return robotHeight + lrintf( gait->drawBackAmplitude * cosf( (PI_F * stancePosition) / stanceTicks ) );
+
+};
+
+/*!
+ *    @brief Works out the timing in ticks of the current gait. One cycle is 2 * periodHalf / GAIT_POSITION_INCREMENT
+             ticks; the swing and the stance are both kept to an even number of ticks so that they have a
+             middle tick (the origin).
+ *    @param gaitParameters The shared gait parameters that hold the gait
+*/
+void StepPlanner::_setTiming(GaitParameters *gaitParameters) {
+
+  Gait *gait = &gaitParameters->gaits[gaitParameters->gaitType];
+  GaitTiming *timing = &gaitParameters->timing;
+
+  int16_t halfCycle = lrintf(gait->periodHalf / GAIT_POSITION_INCREMENT);
+  if (halfCycle < 2)
+    halfCycle = 2;
+
+  int16_t halfSwing = lrintf(halfCycle * (1 - gait->dutyFactor));
+  if (halfSwing < 1)
+    halfSwing = 1;
+  if (halfSwing > halfCycle - 1)
+    halfSwing = halfCycle - 1;
+
+  timing->cycleTicks = 2 * halfCycle;
+  timing->swingTicks = 2 * halfSwing;
+  timing->stanceTicks = timing->cycleTicks - timing->swingTicks;
+
+  for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+    float offset = gait->phaseOffsets[leg] - floorf(gait->phaseOffsets[leg]);
+    timing->legOffsets[leg] = lrintf(offset * timing->cycleTicks) % timing->cycleTicks;
+  }
+}
+
+/*!
+ *    @brief Starts the height table over for the current gait, without building any of it; the heights are
+             calculated until it is finished. This does nothing if the table was already built for the same gait.
+ *    @param gaitParameters The shared gait parameters that hold the gait and its table
+*/
+void StepPlanner::_startHeightTable(GaitParameters *gaitParameters) {
+
+  Gait *gait = &gaitParameters->gaits[gaitParameters->gaitType];
+  Gait *tableGait = &gaitParameters->heightTableGait;
+  GaitTiming *timing = &gaitParameters->timing;
+
+  if ((tableGait->periodHalf != 0) && (memcmp(tableGait, gait, sizeof(Gait)) == 0))
+    return;
 
+  // periodHalf = 0 marks the table as unused so that getStepHeight() calculates the height instead
+  *tableGait = *gait;
+  tableGait->periodHalf = 0;
+  gaitParameters->heightTableBuilt = 0;
+  gaitParameters->heightTableSize = 0;
+
+  uint16_t firstSwingTicks = timing->swingTicks - (timing->swingTicks / 2);
+  if ((timing->cycleTicks + firstSwingTicks > sizeof(gaitParameters->heightTable)) ||
+      (gait->amplitude > INT8_MAX) || (gait->drawBackAmplitude > INT8_MAX))
+    return;
+
+  gaitParameters->heightTableSize = timing->cycleTicks + firstSwingTicks;
+}
+
+/*!
+ *    @brief Precalculates more of the height of the current gait, so that getStepHeight() is just a lookup once the
+             whole table is built. Quadruped calls this from walk() when no tick is due, so a table for gait
+             parameters that were swapped in while walking is built in the spare time between ticks.
+ *    @param gaitParameters The shared gait parameters that hold the gait and its table
+ *    @param entries Most entries to build (one height each)
+ *    @returns true if the table is finished, or the gait doesn't fit in it
+*/
+bool StepPlanner::buildHeightTable(GaitParameters *gaitParameters, uint16_t entries) {
+
+  uint16_t tableSize = gaitParameters->heightTableSize;
+  if (gaitParameters->heightTableBuilt >= tableSize)
     return true;
+
+  Gait *gait = &gaitParameters->gaits[gaitParameters->gaitType];
+  GaitTiming *timing = &gaitParameters->timing;
+
+  // The curves are calculated relative to the robot height
+  int8_t *heightTable = gaitParameters->heightTable;
+
+  while ((entries > 0) && (gaitParameters->heightTableBuilt < tableSize)) {
+    uint16_t entry = gaitParameters->heightTableBuilt;
+    if (entry < timing->cycleTicks)
+      heightTable[entry] = _calculateStepHeight(entry, false, gait, timing, 0);
+    else
+      heightTable[entry] = _calculateStepHeight(entry - timing->cycleTicks + (timing->swingTicks / 2), true, gait, timing, 0);
+
+    gaitParameters->heightTableBuilt++;
+    entries--;
   }
 
-  return false;
-}
\ No newline at end of file
+  if (gaitParameters->heightTableBuilt < tableSize)
+    return false;
+
+  gaitParameters->heightTableGait.periodHalf = gait->periodHalf;
+  return true;
+}
+
+/*!
+ *    @brief Precalculates the height of the current gait for every tick so that getStepHeight() is just a
+             lookup. This does nothing if the table was already built for the same gait.
+ *    @param gaitParameters The shared gait parameters that hold the gait and its table
+*/
+void StepPlanner::_buildHeightTable(GaitParameters *gaitParameters) {
+  _startHeightTable(gaitParameters);
+  buildHeightTable(gaitParameters, gaitParameters->heightTableSize);
+}
@@ -3,70 +3,152 @@
 
 #include <Arduino.h>
 #include "quadruped-config.h"
-#include <Ramp.h>
 
 #define DEFAULT_GAIT  TROT
 
+// The legs are numbered around the body: LEG_1 and LEG_3 are diagonal from each other, LEG_2 and LEG_3 are on the
+// same side, so LEG_1 and LEG_2 are the front (or back) pair.
 typedef enum {
-  TROT = 0
+  TROT = 0,   // diagonal pairs step together
+  PACE,       // the legs on each side step together
+  BOUND,      // the front pair, then the back pair
+  WALK,       // one leg at a time with three on the ground
+  CRAWL       // a slow walk that has all four feet on the ground between steps
 } GaitType;
-#define NUMBER_OF_GAITS 1
+#define NUMBER_OF_GAITS 5
 
 typedef struct {
-  float amplitude;
-  float periodHalf;    // It is assumed that the gait arc is symmetrical across the y axis; half the frequency is the amount it goes forward and backwards
+  float amplitude;            // how high the foot lifts in the middle of the swing
+  float periodHalf;           // It is assumed that the gait arc is symmetrical across the y axis; half the frequency is the amount it goes forwards and backwards
+  float dutyFactor;           // the part of the cycle that each foot is on the ground (0.5 for a trot)
+  float drawBackAmplitude;    // how far the foot presses down in the middle of the stance
+  float phaseOffsets[ROBOT_LEG_COUNT];  // where each leg is in the cycle (0 to 1) compared to the body phase
 } Gait;
 
+// The cycle of the current gait counted in ticks; worked out from the Gait when it is set
+typedef struct {
+  uint16_t cycleTicks;
+  uint16_t swingTicks;        // the foot is in the air, moving forwards; the cycle starts with this
+  uint16_t stanceTicks;       // the foot is on the ground, drawing back
+  uint16_t legOffsets[ROBOT_LEG_COUNT];   // phaseOffsets in ticks
+} GaitTiming;
+
 typedef struct {
   float x;
   float y;
   float z;
 } Coordinate;
 
+// The direction of the control coordinate as a unit vector. Quadruped works this out once for all four legs,
+// and only again when the control coordinate changes.
+typedef struct {
+  int16_t controlCoordinateX;   // the control coordinate it is for
+  int16_t controlCoordinateY;
+  float x;                      // 0, 0 if the control coordinate is (stopped)
+  float y;
+} StepDirection;
+
 typedef enum {
-  FIRST_STEP_ARC, FIRST_STEP_DRAW_BACK,
-  ACTIVE_WALKING_ARC, ACTIVE_WALKING_DRAW_BACK,
-  STANDING
+  STANDING,     // still, at its origin; it joins the walk the next time its phase passes an origin
+  FIRST_STEP,   // it joined halfway through a swing or stance; the rest of that one starts from the ground
+  STEPPING      // following the gait
 } LegMode;
 
+// Everything about the gait that is the same for all four legs. Quadruped owns one of these and every
+// StepPlanner points to it, so the gaits (and the height table) are only stored once for the body. Every leg's
+// step follows from the shared body phase, which keeps the legs in sync.
+typedef struct {
+  Gait gaits[NUMBER_OF_GAITS];
+  GaitType gaitType;
+  GaitTiming timing;          // of the current gait
+
+  uint16_t bodyPhase;         // where the body is in the cycle (ticks)
+
+  int16_t robotHeight;
+  int16_t offsetX;
+  int16_t offsetY;
+
+  // Height of the current gait (relative to robotHeight) for every tick of the cycle, then for the first step
+  // swings (the second half of the swing), indexed by tick - swingTicks/2 after those
+  int8_t heightTable[3 * (GAIT_TABLE_MAX_PERIOD_HALF + 1)];
+  Gait heightTableGait;       // the gait that the table was built with; periodHalf = 0 if it didn't fit or isn't finished
+  uint16_t heightTableSize;   // entries the table needs for the current gait (0 if it doesn't fit)
+  uint16_t heightTableBuilt;  // entries built so far; see StepPlanner::buildHeightTable()
+
+  // New parameters for a gait, waiting to be swapped in (see StepPlanner::stageGait())
+  Gait stagedGait;
+  GaitType stagedGaitType;
+  bool hasStagedGait;
+} GaitParameters;
+
 class StepPlanner {
 
   public:
     StepPlanner();
-    void init(LegID legID, int16_t offsetX, int16_t offsetY, int16_t robotHeight);
+    static void initGaitParameters(GaitParameters *gaitParameters, int16_t offsetX, int16_t offsetY, int16_t robotHeight);
+    void init(LegID legID, GaitParameters *gaitParameters);
     void setGait(GaitType gaitType);
-    bool update(ROBOT_MODE robotMode);
+    void update();
     void setStepEndpoint(int16_t controlCoordinateX, int16_t controlCoordinateY, ROBOT_MODE robotMode);
-    int16_t getStepHeight(int16_t footXYDropL, LegMode movementType);
+    void setStepEndpoint(const StepDirection *direction, ROBOT_MODE robotMode);
+#if defined(CONTINUOUS_STEP_ENDPOINT)
+    void retargetStepEndpoint(const StepDirection *direction);
+#endif
+    int16_t getStepHeight(uint16_t legTick, LegMode legMode);
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+    void setGroundHeight(int16_t groundHeight);
+    int16_t groundHeight();
+    int16_t groundHeightInput();
+#endif
     bool footAtOrigin();
+    bool isStanding();
+    LegMode legMode();
     void reset();
 
-    Coordinate dynamicFootPosition;
+    // normalizes the control coordinate into direction (nothing to do if it is the same as last time)
+    static void setStepDirection(StepDirection *direction, int16_t controlCoordinateX, int16_t controlCoordinateY);
 
-  private: 
+    // The body phase is shared; Quadruped moves it on once per tick after every leg has been updated
+    static void resetBodyPhase(GaitParameters *gaitParameters);
+    static void advanceBodyPhase(GaitParameters *gaitParameters);
 
-    bool _setFirstStep(ROBOT_MODE robotMode);
+    // One control tick of a robot's legs (legs is all ROBOT_LEG_COUNT of them), in this order, so that Quadruped and
+    // the host simulations sequence them the same: the gait changes, the mode changes for the command, the steps
+    static void applyGaitChanges(GaitParameters *gaitParameters, StepPlanner legs[], GaitType requestedGait, ROBOT_MODE robotMode);
+    static ROBOT_MODE changeRobotMode(GaitParameters *gaitParameters, StepPlanner legs[], ROBOT_MODE robotMode, int16_t controlCoordinateX, int16_t controlCoordinateY);
+    static bool stepLegs(GaitParameters *gaitParameters, StepPlanner legs[], StepDirection *direction, int16_t controlCoordinateX, int16_t controlCoordinateY, ROBOT_MODE *robotMode);
 
-    LegID _legID; 
-    int16_t _robotHeight;
-    int16_t _offsetX;
-    int16_t _offsetY;
+    // Gait tuning while walking: the staged gait replaces the running one for every leg at once, at the start of a cycle
+    static void stageGait(GaitParameters *gaitParameters, GaitType gaitType, const Gait *gait);
+    static bool swapStagedGait(GaitParameters *gaitParameters, bool isStanding);
 
-    rampFloat footPosX;
-    rampFloat footPosY;
+    // builds up to entries more of the height table; true once it is done (or isn't used for this gait)
+    static bool buildHeightTable(GaitParameters *gaitParameters, uint16_t entries);
 
-    bool _wasAtOrigin;    
+    Coordinate dynamicFootPosition;
 
-    Gait _gaits[NUMBER_OF_GAITS];
+  private: 
 
-    int16_t _footXYDrop; // the position of the foot on the x/y plane. It moves underneath the foot.
+    uint16_t _legTick();
+    void _calculateStepEndpoint(const StepDirection *direction, Coordinate *endpoint);
 
-    long _previousUpdateTime;
+    static int16_t _calculateStepHeight(uint16_t legTick, bool isFirstStep, const Gait *gait, const GaitTiming *timing, int16_t robotHeight);
+    static void _setTiming(GaitParameters *gaitParameters);
+    static void _startHeightTable(GaitParameters *gaitParameters);
+    static void _buildHeightTable(GaitParameters *gaitParameters);
 
-    Coordinate _stepEndpoint;
+    GaitParameters * _gaitParameters;   // shared by all legs
+
+    LegID _legID; 
+
+    Coordinate _stepEndpoint;   // where the foot is at the end of the swing; the stance draws it back to the opposite
 
     LegMode _legMode; 
-    GaitType _gaitType;
+
+#if defined(TERRAIN_ADAPTIVE_HEIGHT)
+    int16_t _groundHeightInput;   // the latest ground height under the leg (mm, up is positive)
+    int16_t _groundHeight;        // the one the current step is using; taken from the input at the top of each swing
+#endif
 
 
 };
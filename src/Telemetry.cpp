@@ -0,0 +1,299 @@
+#include "Telemetry.h"
+
+#define TELEMETRY_MASK  (TELEMETRY_BUFFER_SIZE - 1)
+
+// The indices are 16 bits, which single core AVRs can't read in one go, so the other side's index is read with
+// the interrupts off there (the reader can be a UART interrupt); everything else uses the compiler's atomics.
+static inline uint16_t loadIndex(uint16_t *index) {
+#if defined(__AVR__)
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t value = *(volatile uint16_t *)index;
+  SREG = oldSREG;
+  return value;
+#else
+  return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void storeIndex(uint16_t *index, uint16_t value) {
+#if defined(__AVR__)
+  uint8_t oldSREG = SREG;
+  cli();
+  *(volatile uint16_t *)index = value;
+  SREG = oldSREG;
+#else
+  __atomic_store_n(index, value, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline uint8_t * writeInt16(uint8_t *frame, int16_t value) {
+  frame[0] = value & 0xFF;
+  frame[1] = (uint16_t)value >> 8;
+  return frame + 2;
+}
+
+Telemetry::Telemetry(void) {
+  _decimation = TELEMETRY_DECIMATION;
+  _fields = TELEMETRY_ALL_FIELDS;
+  _isSettingsLocked = false;
+  reset();
+};
+
+/*!
+ *    @brief  Drops everything in the buffer and clears the counters. Neither side may be using it at the time.
+ */
+void Telemetry::reset() {
+  _head = 0;
+  _tail = 0;
+  _tick = 0;
+  _ticksUntilFrame = 0;
+  frameCount = 0;
+  droppedFrameCount = 0;
+}
+
+/*!
+ *    @brief  Sets how often a frame is written. Call this from the writer's side (where walk() is called).
+ *    @param  decimation A frame every this many ticks; 0 for no frames
+ *    @return false if the settings are locked (see lockSettings())
+ */
+bool Telemetry::setDecimation(uint8_t decimation) {
+  if (_isSettingsLocked)
+    return false;
+  _decimation = decimation;
+  _ticksUntilFrame = 0;
+  return true;
+}
+
+/*!
+ *    @brief  Sets what goes in the frames from the next one on. Call this from the writer's side.
+ *    @param  fields TELEMETRY_ fields or'ed together
+ *    @return false if the settings are locked (see lockSettings())
+ */
+bool Telemetry::setFields(uint8_t fields) {
+  if (_isSettingsLocked)
+    return false;
+  _fields = fields & TELEMETRY_ALL_FIELDS;
+  return true;
+}
+
+/*!
+ *    @brief  Locks the decimation and fields where they are. Quadruped::startDualCoreTasks() does this, since
+ *            walk() writes the frames from its own task after that and nothing else can change them safely.
+ */
+void Telemetry::lockSettings() {
+  _isSettingsLocked = true;
+}
+
+/*!
+ *    @return Bytes per frame with the fields that are set
+ */
+uint8_t Telemetry::frameSize() {
+  uint8_t size = TELEMETRY_HEADER_SIZE + 1;
+  if (_fields & TELEMETRY_MODES)
+    size += 2;
+  if (_fields & TELEMETRY_FEET)
+    size += ROBOT_LEG_COUNT * 3 * 2;
+  if (_fields & TELEMETRY_ANGLES)
+    size += ROBOT_LEG_COUNT * MOTORS_PER_LEG * 2;
+  if (_fields & TELEMETRY_TIMING)
+    size += 3 * 2;
+  return size;
+}
+
+/*!
+ *    @brief  Counts a control tick
+ *    @return true if this tick gets a frame
+ */
+bool Telemetry::tick() {
+  _tick++;
+  if (_decimation == 0)
+    return false;
+
+  if (_ticksUntilFrame > 0) {
+    _ticksUntilFrame--;
+    return false;
+  }
+  _ticksUntilFrame = _decimation - 1;
+  return true;
+}
+
+/*!
+ *    @brief  Writes a frame for the tick that was just run
+ *    @param  robotMode The robot's mode
+ *    @param  legModes The mode of each leg's step planner (LEG_1 first)
+ *    @param  feet The foot position of each leg (LEG_1 first) that was solved
+ *    @param  motors The list of all robot motors
+ *    @param  tickMicros How long the tick took (us)
+ *    @param  scheduler The scheduler that runs the ticks, for its counters
+ *    @return false if the buffer was too full and the frame was dropped
+ */
+bool Telemetry::record(ROBOT_MODE robotMode, const LegMode legModes[ROBOT_LEG_COUNT], const Coordinate feet[ROBOT_LEG_COUNT],
+                       const Motor motors[], uint16_t tickMicros, const Scheduler *scheduler) {
+  int16_t angles[ROBOT_LEG_COUNT * MOTORS_PER_LEG];
+  for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++)
+    angles[motor] = motors[motor].angleDegrees;
+
+  return record(robotMode, legModes, feet, angles, tickMicros, scheduler);
+}
+
+/*!
+ *    @brief  Writes a frame for a tick, with the motor angles from a copy (i.e. a tick that was planned ahead)
+ *    @param  robotMode The robot's mode
+ *    @param  legModes The mode of each leg's step planner (LEG_1 first)
+ *    @param  feet The foot position of each leg (LEG_1 first) that was solved
+ *    @param  angles The angleDegrees of every motor in motor list order
+ *    @param  tickMicros How long the tick took (us)
+ *    @param  scheduler The scheduler that runs the ticks, for its counters
+ *    @return false if the buffer was too full and the frame was dropped
+ */
+bool Telemetry::record(ROBOT_MODE robotMode, const LegMode legModes[ROBOT_LEG_COUNT], const Coordinate feet[ROBOT_LEG_COUNT],
+                       const int16_t angles[ROBOT_LEG_COUNT * MOTORS_PER_LEG], uint16_t tickMicros, const Scheduler *scheduler) {
+  uint8_t frame[TELEMETRY_MAX_FRAME_SIZE];
+  uint8_t *position = frame;
+
+  *position++ = TELEMETRY_SYNC;
+  *position++ = _fields;
+  position = writeInt16(position, _tick);
+
+  if (_fields & TELEMETRY_MODES) {
+    uint8_t packedModes = 0;
+    for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++)
+      packedModes |= (legModes[leg] & 0x03) << (2 * leg);
+    *position++ = robotMode;
+    *position++ = packedModes;
+  }
+
+  if (_fields & TELEMETRY_FEET) {
+    for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+      position = writeInt16(position, feet[leg].x);
+      position = writeInt16(position, feet[leg].y);
+      position = writeInt16(position, feet[leg].z);
+    }
+  }
+
+  if (_fields & TELEMETRY_ANGLES) {
+    for (uint8_t motor = 0; motor < ROBOT_LEG_COUNT * MOTORS_PER_LEG; motor++)
+      position = writeInt16(position, angles[motor]);
+  }
+
+  if (_fields & TELEMETRY_TIMING) {
+    position = writeInt16(position, tickMicros);
+    position = writeInt16(position, (uint16_t)scheduler->overrunCount);
+    position = writeInt16(position, (uint16_t)scheduler->droppedTickCount);
+  }
+
+  uint8_t checksum = 0;
+  for (uint8_t *byte = frame + 1; byte < position; byte++)
+    checksum ^= *byte;
+  *position++ = checksum;
+
+  uint16_t size = position - frame;
+  uint16_t head = _head;
+  uint16_t tail = loadIndex(&_tail);
+
+  // One byte is always kept empty so that a full buffer can be told from an empty one
+  uint16_t space = (tail - head - 1) & TELEMETRY_MASK;
+  if (size > space) {
+    droppedFrameCount++;
+    return false;
+  }
+
+  uint16_t firstPart = TELEMETRY_BUFFER_SIZE - head;
+  if (firstPart > size)
+    firstPart = size;
+  memcpy(&_buffer[head], frame, firstPart);
+  memcpy(_buffer, frame + firstPart, size - firstPart);
+
+  // the frame has to be in the buffer before the reader can see it
+  storeIndex(&_head, (head + size) & TELEMETRY_MASK);
+  frameCount++;
+  return true;
+}
+
+/*!
+ *    @return Bytes waiting to be read
+ */
+uint16_t Telemetry::available() {
+  return (loadIndex(&_head) - _tail) & TELEMETRY_MASK;
+}
+
+/*!
+ *    @brief  Finds the bytes that can be sent in one piece, i.e. for a DMA transfer. They stay in the buffer
+ *            until consume() is called, and the writer doesn't touch them until then.
+ *    @param  data Output for where the oldest byte is
+ *    @return How many bytes there are from data on (more may follow at the start of the buffer)
+ */
+uint16_t Telemetry::peek(const uint8_t **data) {
+  uint16_t head = loadIndex(&_head);
+  uint16_t tail = _tail;
+
+  *data = &_buffer[tail];
+  if (head >= tail)
+    return head - tail;
+  return TELEMETRY_BUFFER_SIZE - tail;
+}
+
+/*!
+ *    @brief  Frees bytes that have been sent
+ *    @param  length How many (no more than available())
+ */
+void Telemetry::consume(uint16_t length) {
+  uint16_t waiting = available();
+  if (length > waiting)
+    length = waiting;
+
+  storeIndex(&_tail, (_tail + length) & TELEMETRY_MASK);
+}
+
+/*!
+ *    @brief  Copies bytes out of the buffer
+ *    @param  buffer Where they go
+ *    @param  length Most bytes to copy
+ *    @return How many were copied
+ */
+uint16_t Telemetry::read(uint8_t *buffer, uint16_t length) {
+  uint16_t copied = 0;
+  while (copied < length) {
+    const uint8_t *data;
+    uint16_t piece = peek(&data);
+    if (piece == 0)
+      break;
+    if (piece > length - copied)
+      piece = length - copied;
+
+    memcpy(buffer + copied, data, piece);
+    consume(piece);
+    copied += piece;
+  }
+  return copied;
+}
+
+/*!
+ *    @brief  Writes as many bytes as the port can take without blocking (its availableForWrite()). Call this
+ *            from loop(); frames may go out over several calls.
+ *    @param  port The port, i.e. Serial
+ *    @return How many bytes were written
+ */
+uint16_t Telemetry::drain(Print *port) {
+  uint16_t written = 0;
+  while (true) {
+    int room = port->availableForWrite();
+    if (room <= 0)
+      break;
+
+    const uint8_t *data;
+    uint16_t piece = peek(&data);
+    if (piece == 0)
+      break;
+    if (piece > (uint16_t)room)
+      piece = room;
+
+    piece = port->write(data, piece);
+    if (piece == 0)
+      break;
+    consume(piece);
+    written += piece;
+  }
+  return written;
+}
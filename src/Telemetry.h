@@ -0,0 +1,90 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "StepPlanner.h"
+#include "Kinematics.h"
+#include "Scheduler.h"
+#include "quadruped-config.h"
+
+#if (TELEMETRY_BUFFER_SIZE < 64) || (TELEMETRY_BUFFER_SIZE > 32768) || ((TELEMETRY_BUFFER_SIZE & (TELEMETRY_BUFFER_SIZE - 1)) != 0)
+#error TELEMETRY_BUFFER_SIZE has to be a power of 2 from 64 to 32768
+#endif
+
+// Fields that can be put in a frame (see setFields()), in the order they are written
+#define TELEMETRY_MODES       0x01    // robot mode, then the LegMode of each leg packed 2 bits each (LEG_1 lowest): 2 bytes
+#define TELEMETRY_FEET        0x02    // x, y, z of each foot (mm) as the kinematics solved them: 12 int16_t
+#define TELEMETRY_ANGLES      0x04    // angleDegrees of every motor in motor list order: 12 int16_t
+#define TELEMETRY_TIMING      0x08    // tick time (us), Scheduler overrunCount and droppedTickCount: 3 uint16_t
+#define TELEMETRY_ALL_FIELDS  0x0F
+
+#define TELEMETRY_SYNC            0xA5
+#define TELEMETRY_HEADER_SIZE     4   // sync, fields, tick (uint16_t)
+#define TELEMETRY_MAX_FRAME_SIZE  (TELEMETRY_HEADER_SIZE + 2 + 24 + 24 + 6 + 1)
+
+/*
+Frame format (all little endian):
+
+  sync      TELEMETRY_SYNC
+  fields    the TELEMETRY_ fields in the frame
+  tick      counts every control tick (not just the ones with frames), so decimation and dropped frames show up
+  ...       each field in fields, in the order of their bits
+  checksum  XOR of every byte after the sync
+
+The layout only depends on fields, so a frame's size is known once its first two bytes are in.
+*/
+
+// Per-tick snapshots of the planner and kinematics state for debugging in the field, without printing from the
+// control loop. Quadruped (QUADRUPED_TELEMETRY) writes frames into a ring buffer as it runs and the other side
+// sends them out whenever it has time: drain() to a serial port from loop(), or peek() and consume() to hand
+// the bytes to a DMA transfer or a UART interrupt. A frame that doesn't fit is dropped whole, so the control
+// loop never waits. One writer and one reader only.
+class Telemetry {
+
+  public:
+    Telemetry();
+
+    void reset();
+
+    // a frame every decimation ticks (0 stops them), with the fields in fields (TELEMETRY_ flags); false once locked
+    bool setDecimation(uint8_t decimation);
+    bool setFields(uint8_t fields);
+
+    // refuses setDecimation() and setFields() from now on, once the writer runs where they can't be called from
+    // (Quadruped::startDualCoreTasks())
+    void lockSettings();
+    uint8_t frameSize();
+
+    // Writer side: call tick() once every control tick, then record() if it returned true
+    bool tick();
+    bool record(ROBOT_MODE robotMode, const LegMode legModes[ROBOT_LEG_COUNT], const Coordinate feet[ROBOT_LEG_COUNT],
+                const Motor motors[], uint16_t tickMicros, const Scheduler *scheduler);
+    bool record(ROBOT_MODE robotMode, const LegMode legModes[ROBOT_LEG_COUNT], const Coordinate feet[ROBOT_LEG_COUNT],
+                const int16_t angles[ROBOT_LEG_COUNT * MOTORS_PER_LEG], uint16_t tickMicros, const Scheduler *scheduler);
+
+    // Reader side
+    uint16_t available();
+    uint16_t peek(const uint8_t **data);    // the bytes that are in one piece from the oldest one on
+    void consume(uint16_t length);
+    uint16_t read(uint8_t *buffer, uint16_t length);
+    uint16_t drain(Print *port);            // as much as the port takes without blocking
+
+    uint32_t frameCount;              // frames written (writer side)
+    uint32_t droppedFrameCount;       // frames that didn't fit (writer side)
+
+  private:
+    uint8_t _buffer[TELEMETRY_BUFFER_SIZE];
+
+    // Each index is only written by one side
+    uint16_t _head;   // next byte to write (writer)
+    uint16_t _tail;   // next byte to read (reader)
+
+    uint8_t _decimation;
+    uint8_t _fields;
+    bool _isSettingsLocked;
+    uint8_t _ticksUntilFrame;
+    uint16_t _tick;
+
+};
+
+#endif
@@ -0,0 +1,275 @@
+#include "Trajectory.h"
+
+#define TRAJECTORY_FRAME_COUNT_OFFSET   4
+
+#define TRAJECTORY_TICK_PERIOD          (TIME_TO_UPDATE - 1)
+
+
+// ******************** TrajectoryRecorder ********************
+
+TrajectoryRecorder::TrajectoryRecorder(void) {
+  _buffer = NULL;
+  _capacity = 0;
+  _length = 0;
+  _frameCount = 0;
+  _isFull = true;
+};
+
+/*!
+ *    @brief  Starts a new recording, writing over anything in the buffer
+ *    @param  buffer    Where the recording goes
+ *    @param  capacity  Size of buffer (bytes)
+ *    @return false if the buffer is too small for the header
+ */
+bool TrajectoryRecorder::begin(uint8_t *buffer, uint16_t capacity) {
+  _buffer = buffer;
+  _capacity = capacity;
+  _frameCount = 0;
+
+  if ((buffer == NULL) || (capacity < TRAJECTORY_HEADER_SIZE)) {
+    _length = 0;
+    _isFull = true;
+    return false;
+  }
+
+  _buffer[0] = 'Q';
+  _buffer[1] = 'T';
+  _buffer[2] = TRAJECTORY_VERSION;
+  _buffer[3] = TRAJECTORY_TICK_PERIOD;
+  _buffer[TRAJECTORY_FRAME_COUNT_OFFSET] = 0;
+  _buffer[TRAJECTORY_FRAME_COUNT_OFFSET + 1] = 0;
+  _buffer[6] = 0;
+  _buffer[7] = 0;
+  _length = TRAJECTORY_HEADER_SIZE;
+  _isFull = false;
+
+  for (uint8_t value = 0; value < TRAJECTORY_VALUES; value++)
+    _values[value] = 0;
+
+  return true;
+}
+
+/*!
+ *    @brief  Writes one change as a zigzag varint
+ *    @param  delta The change of the value since the last frame
+ *    @return false if it didn't fit
+ */
+bool TrajectoryRecorder::_writeValue(int32_t delta) {
+  uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+  do {
+    if (_length >= _capacity)
+      return false;
+    uint8_t byte = zigzag & 0x7F;
+    zigzag >>= 7;
+    _buffer[_length++] = (zigzag != 0) ? (byte | 0x80) : byte;
+  } while (zigzag != 0);
+  return true;
+}
+
+/*!
+ *    @brief  Adds a frame with the foot positions and motor angles of a tick
+ *    @param  feet    The foot position of each leg (LEG_1 first); recorded in whole mm like the kinematics solves it
+ *    @param  motors  The list of all robot motors; their angleDegrees are recorded
+ *    @return false if the buffer is full, and nothing more is recorded after that
+ */
+bool TrajectoryRecorder::record(const Coordinate feet[ROBOT_LEG_COUNT], const Motor motors[]) {
+  int16_t angles[TRAJECTORY_ANGLES];
+  for (uint8_t motor = 0; motor < TRAJECTORY_ANGLES; motor++)
+    angles[motor] = motors[motor].angleDegrees;
+
+  return record(feet, angles);
+}
+
+/*!
+ *    @brief  Adds a frame with the foot positions and motor angles of a tick, with the angles from a copy
+ *    @param  feet    The foot position of each leg (LEG_1 first)
+ *    @param  angles  The angleDegrees of every motor in motor list order
+ *    @return false if the buffer is full, and nothing more is recorded after that
+ */
+bool TrajectoryRecorder::record(const Coordinate feet[ROBOT_LEG_COUNT], const int16_t angles[TRAJECTORY_ANGLES]) {
+  if (_isFull || (_frameCount == UINT16_MAX))
+    return false;
+
+  int16_t values[TRAJECTORY_VALUES];
+  for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+    values[leg * 3] = (int16_t)feet[leg].x;
+    values[leg * 3 + 1] = (int16_t)feet[leg].y;
+    values[leg * 3 + 2] = (int16_t)feet[leg].z;
+  }
+  for (uint8_t motor = 0; motor < TRAJECTORY_ANGLES; motor++)
+    values[ROBOT_LEG_COUNT * 3 + motor] = angles[motor];
+
+  uint16_t frameStart = _length;
+  if (_length + TRAJECTORY_MASK_BYTES > _capacity) {
+    _isFull = true;
+    return false;
+  }
+
+  uint8_t * mask = &_buffer[_length];
+  for (uint8_t maskByte = 0; maskByte < TRAJECTORY_MASK_BYTES; maskByte++)
+    mask[maskByte] = 0;
+  _length += TRAJECTORY_MASK_BYTES;
+
+  for (uint8_t value = 0; value < TRAJECTORY_VALUES; value++) {
+    if (values[value] == _values[value])
+      continue;
+
+    mask[value / 8] |= 1 << (value % 8);
+    if (!_writeValue((int32_t)values[value] - _values[value])) {
+      // Leave the recording as it was before this frame
+      _length = frameStart;
+      _isFull = true;
+      return false;
+    }
+  }
+
+  for (uint8_t value = 0; value < TRAJECTORY_VALUES; value++)
+    _values[value] = values[value];
+
+  _frameCount++;
+  _buffer[TRAJECTORY_FRAME_COUNT_OFFSET] = _frameCount & 0xFF;
+  _buffer[TRAJECTORY_FRAME_COUNT_OFFSET + 1] = _frameCount >> 8;
+  return true;
+}
+
+const uint8_t * TrajectoryRecorder::data() {
+  return _buffer;
+}
+
+/*!
+ *    @return Size of the recording (bytes), including the header
+ */
+uint16_t TrajectoryRecorder::length() {
+  return _length;
+}
+
+uint16_t TrajectoryRecorder::frameCount() {
+  return _frameCount;
+}
+
+bool TrajectoryRecorder::isFull() {
+  return _isFull;
+}
+
+
+// ******************** TrajectoryPlayer ********************
+
+TrajectoryPlayer::TrajectoryPlayer(void) {
+  _data = NULL;
+  _length = 0;
+  _inProgmem = false;
+  _position = 0;
+  _frameCount = 0;
+  _framesPlayed = 0;
+};
+
+uint8_t TrajectoryPlayer::_readByte(uint16_t position) {
+  if (_inProgmem)
+    return pgm_read_byte(&_data[position]);
+  return _data[position];
+}
+
+/*!
+ *    @brief  Checks the header of a recording and gets ready to play it from the start
+ *    @param  data      The recording, i.e. TrajectoryRecorder::data() or a file read back from an SD card
+ *    @param  length    Size of the recording (bytes)
+ *    @param  inProgmem true if data is in program memory (a PROGMEM array)
+ *    @return false if it isn't a recording this can play
+ */
+bool TrajectoryPlayer::begin(const uint8_t *data, uint16_t length, bool inProgmem) {
+  _data = data;
+  _length = length;
+  _inProgmem = inProgmem;
+  _frameCount = 0;
+
+  if ((data == NULL) || (length < TRAJECTORY_HEADER_SIZE)
+   || (_readByte(0) != 'Q') || (_readByte(1) != 'T') || (_readByte(2) != TRAJECTORY_VERSION)
+   || (_readByte(3) != TRAJECTORY_TICK_PERIOD)) {
+    _length = 0;
+    rewind();
+    return false;
+  }
+
+  _frameCount = _readByte(TRAJECTORY_FRAME_COUNT_OFFSET) | ((uint16_t)_readByte(TRAJECTORY_FRAME_COUNT_OFFSET + 1) << 8);
+  rewind();
+  return true;
+}
+
+/*!
+ *    @brief  Starts playing from the first frame again
+ */
+void TrajectoryPlayer::rewind() {
+  _position = TRAJECTORY_HEADER_SIZE;
+  _framesPlayed = 0;
+  for (uint8_t value = 0; value < TRAJECTORY_VALUES; value++)
+    _values[value] = 0;
+}
+
+/*!
+ *    @brief  Reads one zigzag varint
+ *    @param  delta Output for the change of the value
+ *    @return false if the recording ended in the middle of it
+ */
+bool TrajectoryPlayer::_readValue(int32_t *delta) {
+  uint32_t zigzag = 0;
+  uint8_t shift = 0;
+  uint8_t byte;
+  do {
+    if ((_position >= _length) || (shift > 28))
+      return false;
+    byte = _readByte(_position++);
+    zigzag |= (uint32_t)(byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+
+  *delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+  return true;
+}
+
+/*!
+ *    @brief  Reads the next frame of the recording
+ *    @param  feet    Output for the foot position of each leg (LEG_1 first), or NULL
+ *    @param  angles  Output for the motor angles (degrees) in motor list order
+ *    @return false if there are no frames left; the outputs aren't changed then
+ */
+bool TrajectoryPlayer::next(Coordinate feet[ROBOT_LEG_COUNT], int16_t angles[TRAJECTORY_ANGLES]) {
+  if ((_framesPlayed >= _frameCount) || (_position + TRAJECTORY_MASK_BYTES > _length))
+    return false;
+
+  uint16_t maskPosition = _position;
+  _position += TRAJECTORY_MASK_BYTES;
+
+  for (uint8_t value = 0; value < TRAJECTORY_VALUES; value++) {
+    if (!(_readByte(maskPosition + value / 8) & (1 << (value % 8))))
+      continue;
+
+    int32_t delta;
+    if (!_readValue(&delta)) {
+      // A cut short recording stops here
+      _framesPlayed = _frameCount;
+      return false;
+    }
+    _values[value] += delta;
+  }
+  _framesPlayed++;
+
+  if (feet != NULL) {
+    for (uint8_t leg = 0; leg < ROBOT_LEG_COUNT; leg++) {
+      feet[leg].x = _values[leg * 3];
+      feet[leg].y = _values[leg * 3 + 1];
+      feet[leg].z = _values[leg * 3 + 2];
+    }
+  }
+  for (uint8_t motor = 0; motor < TRAJECTORY_ANGLES; motor++)
+    angles[motor] = _values[ROBOT_LEG_COUNT * 3 + motor];
+
+  return true;
+}
+
+uint16_t TrajectoryPlayer::frameCount() {
+  return _frameCount;
+}
+
+uint16_t TrajectoryPlayer::framesPlayed() {
+  return _framesPlayed;
+}
@@ -0,0 +1,100 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <Arduino.h>
+#include "StepPlanner.h"
+#include "Kinematics.h"
+#include "quadruped-config.h"
+
+#define TRAJECTORY_ANGLES       (ROBOT_LEG_COUNT * MOTORS_PER_LEG)
+#define TRAJECTORY_VALUES       (ROBOT_LEG_COUNT * 3 + TRAJECTORY_ANGLES)   // foot x, y, z of every leg, then the angles
+#define TRAJECTORY_MASK_BYTES   ((TRAJECTORY_VALUES + 7) / 8)
+
+#define TRAJECTORY_HEADER_SIZE  8
+#define TRAJECTORY_VERSION      1
+
+// Most bytes a frame can take: the change mask and 3 bytes for every value
+#define TRAJECTORY_MAX_FRAME_SIZE   (TRAJECTORY_MASK_BYTES + 3 * TRAJECTORY_VALUES)
+
+/*
+Recording format (all little endian):
+
+  header    'Q', 'T', TRAJECTORY_VERSION, tick period (ms), frame count (uint16_t), 2 bytes of 0
+  frames    one per control tick
+
+Every frame starts with a TRAJECTORY_MASK_BYTES bit mask of the values that changed since the frame before it
+(bit n of byte n / 8 for value n). The change of each of those values follows, in order, as a zigzag varint: the
+difference d is stored as (d << 1) ^ (d >> 31), 7 bits per byte with the top bit set on all but the last byte.
+Values start at 0 before the first frame, so the first frame holds the whole pose and a frame where nothing moved
+(standing) is just the mask. Walking frames come to about 11 bytes, against the 48 bytes of the raw values.
+*/
+
+// Writes the feet and motor angles of every control tick into a buffer in the recording format above, i.e. to
+// save to an SD card or to put in flash as a const (PROGMEM) array. Quadruped::setTrajectoryRecorder() feeds it.
+class TrajectoryRecorder {
+
+  public:
+    TrajectoryRecorder();
+
+    // starts a new recording in buffer; capacity has to be at least TRAJECTORY_HEADER_SIZE
+    bool begin(uint8_t *buffer, uint16_t capacity);
+
+    // adds a frame; false (and nothing is added) once the buffer is full
+    bool record(const Coordinate feet[ROBOT_LEG_COUNT], const Motor motors[]);
+    bool record(const Coordinate feet[ROBOT_LEG_COUNT], const int16_t angles[TRAJECTORY_ANGLES]);
+
+    // the recording so far
+    const uint8_t * data();
+    uint16_t length();
+    uint16_t frameCount();
+
+    bool isFull();
+
+  private:
+    bool _writeValue(int32_t delta);
+
+    uint8_t * _buffer;
+    uint16_t _capacity;
+    uint16_t _length;
+    uint16_t _frameCount;
+    bool _isFull;
+
+    int16_t _values[TRAJECTORY_VALUES];   // the values of the last frame
+};
+
+// Reads a recording back one frame at a time; no kinematics or gait planning is done to play it, so it can run
+// choreographed motions on boards that can't keep up with the planner. See Quadruped::playTrajectory().
+class TrajectoryPlayer {
+
+  public:
+    TrajectoryPlayer();
+
+    // false if data isn't a recording (or was recorded with another TIME_TO_UPDATE); set inProgmem if
+    // data is a PROGMEM array
+    bool begin(const uint8_t *data, uint16_t length, bool inProgmem = false);
+
+    // the next frame; feet may be NULL. False at the end of the recording (or if it is cut short).
+    bool next(Coordinate feet[ROBOT_LEG_COUNT], int16_t angles[TRAJECTORY_ANGLES]);
+
+    // goes back to the first frame
+    void rewind();
+
+    uint16_t frameCount();
+    uint16_t framesPlayed();
+
+  private:
+    uint8_t _readByte(uint16_t position);
+    bool _readValue(int32_t *delta);
+
+    const uint8_t * _data;
+    uint16_t _length;
+    bool _inProgmem;
+
+    uint16_t _position;
+    uint16_t _frameCount;
+    uint16_t _framesPlayed;
+
+    int16_t _values[TRAJECTORY_VALUES];   // the values of the last frame
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "WorkspaceTable.h"
+
+// Scale of the interpolated sums: one WORKSPACE_TABLE_STEP per axis
+#define WORKSPACE_TABLE_WEIGHT  ((int32_t)WORKSPACE_TABLE_STEP * WORKSPACE_TABLE_STEP * WORKSPACE_TABLE_STEP)
+
+
+/*!
+ *    @returns True once build() has been called
+ */
+bool WorkspaceTable::isBuilt() {
+  return _built;
+}
+
+
+/*!
+ *    @brief  Finds the motor angles for a foot position by trilinear interpolation
+ *            between the 8 grid points surrounding it.
+ *    @param  inputX        The desired x-axis coordinate (mm)
+ *    @param  inputY        The desired y-axis coordinate (mm), 0 is under the shoulder
+ *    @param  inputZ        The desired z-axis coordinate (mm)
+ *    @param  motor1AngleP  The motor 1 angle output
+ *    @param  motor2AngleP  The motor 2 angle output
+ *    @param  motor3AngleP  The motor 3 angle output
+ *    @returns True if the angles were found, false if the point is outside of the
+ *             table (the outputs are untouched and the position must be solved)
+ */
+bool WorkspaceTable::lookup(int16_t inputX, int16_t inputY, int16_t inputZ, int16_t *motor1AngleP, int16_t *motor2AngleP, int16_t *motor3AngleP) {
+  if (!_built)
+    return false;
+
+  uint8_t indexX, indexY, indexZ;
+  int16_t fractionX, fractionY, fractionZ;
+
+  if (!_cellOf(inputX, WORKSPACE_TABLE_X_MIN, WORKSPACE_TABLE_SIZE_X, &indexX, &fractionX)
+   || !_cellOf(inputY, WORKSPACE_TABLE_Y_MIN, WORKSPACE_TABLE_SIZE_Y, &indexY, &fractionY)
+   || !_cellOf(inputZ, WORKSPACE_TABLE_Z_MIN, WORKSPACE_TABLE_SIZE_Z, &indexZ, &fractionZ))
+    return false;
+
+  const int16_t * corners[8];
+  for (uint8_t corner = 0; corner < 8; corner++) {
+    corners[corner] = _angles[_indexOf(indexX + (corner & 1), indexY + ((corner >> 1) & 1), indexZ + (corner >> 2))];
+    if (corners[corner][M1 - 1] == WORKSPACE_TABLE_UNREACHABLE)
+      return false;
+  }
+
+  int16_t * outputs[MOTORS_PER_LEG] = {motor1AngleP, motor2AngleP, motor3AngleP};
+
+  for (uint8_t motor = 0; motor < MOTORS_PER_LEG; motor++) {
+    // interpolate along x, then y, then z. Each step scales the sum by WORKSPACE_TABLE_STEP.
+    int32_t alongX[4];
+    for (uint8_t edge = 0; edge < 4; edge++)
+      alongX[edge] = (int32_t)corners[2 * edge][motor] * (WORKSPACE_TABLE_STEP - fractionX) + (int32_t)corners[2 * edge + 1][motor] * fractionX;
+
+    int32_t alongY0 = alongX[0] * (WORKSPACE_TABLE_STEP - fractionY) + alongX[1] * fractionY;
+    int32_t alongY1 = alongX[2] * (WORKSPACE_TABLE_STEP - fractionY) + alongX[3] * fractionY;
+
+    int32_t angle = alongY0 * (WORKSPACE_TABLE_STEP - fractionZ) + alongY1 * fractionZ;
+
+    // Round off to whole degrees
+    int32_t divisor = WORKSPACE_TABLE_WEIGHT << WORKSPACE_TABLE_ANGLE_SHIFT;
+    if (angle < 0)
+      *outputs[motor] = -((-angle + (divisor / 2)) / divisor);
+    else
+      *outputs[motor] = (angle + (divisor / 2)) / divisor;
+  }
+
+  return true;
+}
+
+
+// *****************Private Functions*****************
+
+uint16_t WorkspaceTable::_indexOf(uint8_t indexX, uint8_t indexY, uint8_t indexZ) {
+  return ((uint16_t)indexX * WORKSPACE_TABLE_SIZE_Y + indexY) * WORKSPACE_TABLE_SIZE_Z + indexZ;
+}
+
+/*!
+ *    @brief  Finds the grid cell that holds a coordinate along one axis
+ *    @param  input     The coordinate
+ *    @param  minimum   The coordinate of the first grid point on this axis
+ *    @param  size      The number of grid points on this axis
+ *    @param  index     Output for the lower grid point of the cell
+ *    @param  fraction  Output for the distance (mm) from the lower grid point
+ *    @returns false if the coordinate is outside of the grid
+ */
+bool WorkspaceTable::_cellOf(int16_t input, int16_t minimum, uint8_t size, uint8_t *index, int16_t *fraction) {
+  int16_t offset = input - minimum;
+  if ((offset < 0) || (offset > (size - 1) * WORKSPACE_TABLE_STEP))
+    return false;
+
+  *index = offset / WORKSPACE_TABLE_STEP;
+  *fraction = offset % WORKSPACE_TABLE_STEP;
+
+  // the last grid point is the top of the cell below it
+  if (*index == size - 1) {
+    *index -= 1;
+    *fraction = WORKSPACE_TABLE_STEP;
+  }
+  return true;
+}
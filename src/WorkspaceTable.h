@@ -0,0 +1,85 @@
+#ifndef WORKSPACE_TABLE_H
+#define WORKSPACE_TABLE_H
+
+#include <Arduino.h>
+#include "quadruped-config.h"
+#include "RobotGeometry.h"
+
+// Number of grid points along each axis
+#define WORKSPACE_TABLE_SIZE_X  ((WORKSPACE_TABLE_X_MAX - WORKSPACE_TABLE_X_MIN) / WORKSPACE_TABLE_STEP + 1)
+#define WORKSPACE_TABLE_SIZE_Y  ((WORKSPACE_TABLE_Y_MAX - WORKSPACE_TABLE_Y_MIN) / WORKSPACE_TABLE_STEP + 1)
+#define WORKSPACE_TABLE_SIZE_Z  ((WORKSPACE_TABLE_Z_MAX - WORKSPACE_TABLE_Z_MIN) / WORKSPACE_TABLE_STEP + 1)
+#define WORKSPACE_TABLE_POINTS  (WORKSPACE_TABLE_SIZE_X * WORKSPACE_TABLE_SIZE_Y * WORKSPACE_TABLE_SIZE_Z)
+
+#if ((WORKSPACE_TABLE_X_MAX - WORKSPACE_TABLE_X_MIN) % WORKSPACE_TABLE_STEP != 0) \
+ || ((WORKSPACE_TABLE_Y_MAX - WORKSPACE_TABLE_Y_MIN) % WORKSPACE_TABLE_STEP != 0) \
+ || ((WORKSPACE_TABLE_Z_MAX - WORKSPACE_TABLE_Z_MIN) % WORKSPACE_TABLE_STEP != 0)
+#error The workspace table ranges must be multiples of WORKSPACE_TABLE_STEP
+#endif
+
+// Angles are stored in 1/16ths of a degree so that interpolating doesn't add rounding error
+#define WORKSPACE_TABLE_ANGLE_SHIFT   4
+
+// Marks a grid point that has no solution (the point is out of reach)
+#define WORKSPACE_TABLE_UNREACHABLE   INT16_MIN
+
+template <class Geometry> class BasicKinematics;
+
+class WorkspaceTable {
+
+  public:
+
+    // solves every grid point; call once before using lookup()
+    template <class Geometry> void build(BasicKinematics<Geometry> *kinematics);
+
+    bool isBuilt();
+
+    // interpolates the angles for a foot position (same coordinates as Kinematics::setFootEndpoint)
+    bool lookup(int16_t inputX, int16_t inputY, int16_t inputZ, int16_t *motor1AngleP, int16_t *motor2AngleP, int16_t *motor3AngleP);
+
+  private:
+
+    uint16_t _indexOf(uint8_t indexX, uint8_t indexY, uint8_t indexZ);
+    bool _cellOf(int16_t input, int16_t minimum, uint8_t size, uint8_t *index, int16_t *fraction);
+
+    int16_t _angles[WORKSPACE_TABLE_POINTS][MOTORS_PER_LEG];
+
+    bool _built;
+
+};
+
+
+/*!
+ *    @brief  Solves the angles for every point in the grid. This is slow (it is a full
+ *            solve for every point), so it is only done once at startup.
+ *    @param  kinematics Any Kinematics object (of any geometry); only its solving functions are used
+ */
+template <class Geometry>
+void WorkspaceTable::build(BasicKinematics<Geometry> *kinematics) {
+  for (uint8_t indexX = 0; indexX < WORKSPACE_TABLE_SIZE_X; indexX++) {
+    for (uint8_t indexY = 0; indexY < WORKSPACE_TABLE_SIZE_Y; indexY++) {
+      for (uint8_t indexZ = 0; indexZ < WORKSPACE_TABLE_SIZE_Z; indexZ++) {
+
+        int16_t inputX = WORKSPACE_TABLE_X_MIN + indexX * WORKSPACE_TABLE_STEP;
+        int16_t inputY = WORKSPACE_TABLE_Y_MIN + indexY * WORKSPACE_TABLE_STEP;
+        int16_t inputZ = WORKSPACE_TABLE_Z_MIN + indexZ * WORKSPACE_TABLE_STEP;
+
+        // The solve clamps the angles of a point it can't reach rather than failing, so test it first
+        int16_t * angles = _angles[_indexOf(indexX, indexY, indexZ)];
+        if (BasicKinematics<Geometry>::checkReachability(inputX, inputY, inputZ) != FOOT_REACHABLE) {
+          angles[M1 - 1] = WORKSPACE_TABLE_UNREACHABLE;
+          continue;
+        }
+
+        float demandAngle1, demandAngle2, demandAngle3;
+        kinematics->solveFootAngles(inputX, inputY + Geometry::limb1, inputZ, &demandAngle1, &demandAngle2, &demandAngle3);
+        angles[M1 - 1] = lrintf(demandAngle1 * (1 << WORKSPACE_TABLE_ANGLE_SHIFT));
+        angles[M2 - 1] = lrintf(demandAngle2 * (1 << WORKSPACE_TABLE_ANGLE_SHIFT));
+        angles[M3 - 1] = lrintf(demandAngle3 * (1 << WORKSPACE_TABLE_ANGLE_SHIFT));
+      }
+    }
+  }
+  _built = true;
+}
+
+#endif
@@ -10,6 +10,12 @@
 #define LIMB_3  125
 
 
+// distance between the front and back shoulders, and between the left and right ones (where the foot is at y = 0), in mm.
+// Only used to move the feet for Quadruped::setBodyPose().
+#define BODY_LENGTH 200
+#define BODY_WIDTH  100
+
+
 // shoulder to foot length constraints in mm - determined using max/min angles for motors 2 & 3
 #define SHOULDER_FOOT_MAX 230
 #define SHOULDER_FOOT_MIN 100
@@ -18,21 +24,133 @@
 //****************** walking/gait setup *******************
 
 #define TIME_TO_UPDATE          4    // The time between each update of the state machine + 1 i.e. this will update every 10 millis
-#define GAIT_POSITION_INCREMENT 1     // The amount incremented and decremented to footXYDrop
-
-// Uncomment whichever one you want, comment out the other. 
+#define GAIT_POSITION_INCREMENT 1     // Sets the length of a gait cycle: it takes 2 * periodHalf / GAIT_POSITION_INCREMENT ticks
+#define SCHEDULER_MAX_CATCH_UP_TICKS 4  // If walk() gets called late, this is the most updates it will run at once to catch up; the rest are dropped
+#define COMMAND_QUEUE_SIZE      8     // Motion commands that can wait for walk() (see CommandQueue.h); a power of 2, one slot is always kept empty
+
+// Uncomment to plan the gait ahead of time: walk() runs the step planners and the kinematics up to GAIT_LOOKAHEAD_FRAMES
+// ticks ahead, one tick per call in the spare time between ticks, and a due tick only sends out a frame that is already
+// planned, so the time the planning and solving take doesn't show up in the servo timing. A new command throws the
+// planned frames away and plans them again from the tick that goes out next. Each frame takes about 250 bytes.
+// #define GAIT_LOOKAHEAD
+#define GAIT_LOOKAHEAD_FRAMES   4
+
+// Uncomment whichever one you want, comment out the other. RIGHT_FOOTED starts walking with LEG_1's swing, LEFT_FOOTED with LEG_2's.
 #define RIGHT_FOOTED                  
 // #define LEFT_FOOTED
 
 // #define STANDING_TROT
 
+// Uncomment to have a change of direction take effect straight away: the step endpoints follow the control coordinate
+// every tick, slewed by up to STEP_ENDPOINT_SLEW (mm per tick) so that the feet don't jump. Otherwise the endpoints
+// only change when the feet are at their origin, which is once per half step.
+// #define CONTINUOUS_STEP_ENDPOINT
+#define STEP_ENDPOINT_SLEW      2.0
+
 #define DRAW_BACK_AMPLITUDE_REDUCTION 2 // the draw back phase of the step also has an amplitude proportional to the arc amplitude. 
 
+// The step heights of the current gait are precalculated when it is set. This is the longest periodHalf that fits in the table
+// (for a GAIT_POSITION_INCREMENT of 1); it takes 3 * (GAIT_TABLE_MAX_PERIOD_HALF + 1) bytes. Gaits with a longer periodHalf
+// (or an amplitude over 127) are calculated every update instead.
+#define GAIT_TABLE_MAX_PERIOD_HALF    80
+
+// Gait parameters changed while walking (Quadruped::setGaitParameters) have their height table built again in the
+// spare time between ticks, this many entries (one cos() each) every time walk() finds no tick due
+#define GAIT_TABLE_BUILD_STEP         4
+
+// Uncomment for uneven ground: Quadruped::setGroundHeight() gives each leg the height of the ground under it (i.e. from
+// a contact sensor or a local height map). Each step planner takes it once per step, at the top of the swing, and the
+// rest of that swing and the stance after it are offset from it. The input is limited to +/- TERRAIN_MAX_HEIGHT (mm).
+// #define TERRAIN_ADAPTIVE_HEIGHT
+#define TERRAIN_MAX_HEIGHT            40
+
 //******************* kinematics setup *******************
 // Maximum motor speed; milliseconds per 180 degrees factor; NOT DEGREES PER MILLISECONDS I.E. SPEED (determined experimentally) this is 0.6 sec / 180 degrees (actual value is 0.52 sec)
 #define MAX_SPEED_INVERSE 3.5
 // #define MAX_SPEED_INVERSE   25
 
+// updateDynamicFootPosition() moves each motor from where it is to its new angle in joint space: no faster than
+// MAX_SPEED_INVERSE allows, speeding up and slowing down by DYNAMIC_MAX_ACCELERATION. That is a few integer
+// operations per motor. Uncomment to ramp the foot along a straight line instead and solve every point on the
+// way, for motions where the path of the foot matters.
+// #define CARTESIAN_DYNAMIC_INTERPOLATION
+#define DYNAMIC_MAX_ACCELERATION  10000   // degrees/s^2
+
+// Uncomment to check every foot position walk() and solveAllLegs() solve with Kinematics::checkReachability() (a few
+// integer operations) and move the ones outside of the workspace (i.e. from a big body pose) to a reachable position
+// close by, instead of solving them to clamped angles. Quadruped::unreachableFeet counts them.
+// #define PROJECT_UNREACHABLE_FEET
+
+// setFootEndpoint() is only solved again once the endpoint moves more than this (mm) on any axis
+#define KINEMATICS_ENDPOINT_TOLERANCE 0
+
+// Uncomment to solve setFootEndpoint() with differential kinematics: the angles from the last update are moved
+// towards the new foot position using the leg's Jacobian, which needs no trig calls. It only falls back to the full
+// solve when the foot jumps or the error gets too big, so it suits feet that move a little every update (walking).
+// #define DIFFERENTIAL_KINEMATICS
+#define DIFFERENTIAL_IK_MAX_STEP        10                        // mm; bigger jumps are solved from scratch
+#define DIFFERENTIAL_IK_MAX_ERROR       1.0                       // mm; solve from scratch if a step misses by more than this
+#define DIFFERENTIAL_IK_DAMPING         20.0                      // mm; damping when the leg is straight (the singularity)
+#define DIFFERENTIAL_IK_DAMPING_RANGE   20                        // mm; the damping starts this much short of SHOULDER_FOOT_MAX
+
+// Uncomment to solve the kinematics with integer (Q8 fixed point) math and an arctangent lookup table
+// instead of floats. Much faster on boards without an FPU (AVR); angles match the float solve to +/- 1 degree.
+// #define FIXED_POINT_KINEMATICS
+
+// Uncomment to look the motor angles up from a grid of solved foot positions (built once in Kinematics::init)
+// instead of solving every time. Positions outside of the grid are still solved. Coordinates are the same as
+// for Kinematics::setFootEndpoint. The grid takes 6 bytes of RAM per point: the default is 9 * 9 * 14 points (6.8 KB),
+// so it is meant for the bigger boards. A coarser step uses less memory but is less accurate.
+// #define WORKSPACE_ANGLE_TABLE
+#define WORKSPACE_TABLE_STEP    10                  // grid spacing (mm); the ranges must be multiples of this
+#define WORKSPACE_TABLE_X_MIN   -40
+#define WORKSPACE_TABLE_X_MAX   40
+#define WORKSPACE_TABLE_Y_MIN   -40
+#define WORKSPACE_TABLE_Y_MAX   40
+#define WORKSPACE_TABLE_Z_MIN   SHOULDER_FOOT_MIN
+#define WORKSPACE_TABLE_Z_MAX   SHOULDER_FOOT_MAX
+
+
+//******************* servo output *******************
+// See ServoOutput.h. Angles (after the motor offsets) are mapped linearly onto the pulse widths.
+#define SERVO_MIN_PULSE_WIDTH   500     // microseconds at 0 degrees
+#define SERVO_MAX_PULSE_WIDTH   2500    // microseconds at SERVO_RANGE_DEGREES
+#define SERVO_RANGE_DEGREES     180
+#define PCA9685_BURST_CHANNELS  7       // most channels per I2C transmission; Wire's 32 byte buffer fits 1 + 4 * 7 bytes
+
+// Uncomment to build a table of the pulse width for every servo angle of each motor when the ServoOutput is set up,
+// so that an update is a lookup per motor. This also allows per-servo correction curves measured on the bench
+// (ServoOutput::setCorrectionCurve). The tables take 2 * (SERVO_RANGE_DEGREES + 1) bytes per motor (4.3 KB for 12).
+// #define SERVO_PULSE_TABLES
+
+
+//******************* dual core (ESP32 / RP2040) *******************
+// Uncomment to split the control loop in two: walk() does the gait planning and kinematics and passes the angles
+// on through a JointFrameBuffer, and Quadruped::runOutput() writes them to the servos from the other core.
+// On the ESP32 Quadruped::startDualCoreTasks() starts both as pinned tasks; on the RP2040 call walk() from loop()
+// and runOutput() from loop1().
+// #define QUADRUPED_DUAL_CORE
+#define DUAL_CORE_CONTROL_CORE      1     // ESP32: the WiFi/BLE stacks run on core 0
+#define DUAL_CORE_OUTPUT_CORE       0
+#define DUAL_CORE_CONTROL_PRIORITY  20    // FreeRTOS priorities; loop() runs at 1
+#define DUAL_CORE_OUTPUT_PRIORITY   19
+#define DUAL_CORE_TASK_STACK        4096  // bytes
+
+
+//******************* profiling *******************
+// Uncomment to time the kinematics, step planner and walk() ticks (see Profiler.h) and print the results
+// with profiler.dump(Serial). When this is commented out the profiling compiles to nothing.
+// #define QUADRUPED_PROFILING
+#define PROFILER_RING_SIZE  32    // how many of the most recent measurements are kept
+
+
+//******************* telemetry *******************
+// Uncomment to have walk() write a binary snapshot of the leg modes, feet, motor angles and tick timing into a
+// ring buffer (see Telemetry.h) every TELEMETRY_DECIMATION ticks. Send it from loop() with
+// Quadruped::telemetry()->drain(&Serial), or hand the bytes to a DMA transfer with peek() and consume().
+// #define QUADRUPED_TELEMETRY
+#define TELEMETRY_BUFFER_SIZE   512   // bytes; a power of 2 from 64 to 32768. A frame with every field is 61 bytes
+#define TELEMETRY_DECIMATION    1     // a frame every this many ticks to start with (Telemetry::setDecimation)
 
 
 // DON'T CHANGE BELOW HERE